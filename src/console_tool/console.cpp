@@ -1,8 +1,10 @@
 #include "console.hpp"
 #include "mos6502.hpp"
+#include "rewind.hpp"
 #include "util.hpp"
 #include <cstring>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string>
 
 #define RAM_SIZE 64 * 1024
@@ -27,6 +29,7 @@ static void mem_callback(void *ram, const uint16_t address,
 
   switch (read_write) {
   case access_mode_t::READ:
+  case access_mode_t::READ_ONLY:
     data = RAM[address];
     return;
 
@@ -70,6 +73,12 @@ int Console::run(int argc, char **argv) {
     return 1;
   }
 
+  // Optional cycles between the rewind snapshots and snapshots kept
+  const uint64_t interval =
+      argc > 2 ? strtoull(argv[2], nullptr, 0) : REWIND_INTERVAL;
+  const size_t snapshots =
+      argc > 3 ? strtoull(argv[3], nullptr, 0) : REWIND_CAPACITY;
+
   file = fopen(argv[1], "rb");
 
   if (file == nullptr) {
@@ -103,11 +112,17 @@ int Console::run(int argc, char **argv) {
   // Initialize the CPU
   MOS6502 cpu(mem_callback, (void *)RAM);
   cpu.set_log_callback(cpu_log);
+  cpu.map_memory(0x00, 256, RAM); // Mapped, so the rewind restores it
   cpu.reset();
 
+  // Snapshots to step back
+  Rewind rewind_buffer(cpu, interval, snapshots);
+  rewind_buffer.record();
+
   // Set the class variables
   mem = RAM;
   mem_size = RAM_SIZE;
+  rewind = &rewind_buffer;
   current_state = cpu.get_status();
 
   // Enter into the main loop
@@ -116,17 +131,29 @@ int Console::run(int argc, char **argv) {
     draw_status();
     draw_exec_log();
     draw_logs();
+    draw_rewind();
 
     show();
 
-    if (!get_input()) {
+    const command_t command = get_input();
+    if (command == command_t::QUIT) {
       break;
     }
 
-    cpu.clock();
+    if (command == command_t::BACK) {
+      if (!rewind_buffer.rewind(cpu.cycles - 1)) {
+        push_log("Can not step back beyond the oldest snapshot");
+      }
+    } else {
+      cpu.clock();
+      rewind_buffer.record();
+    }
+
     current_state = cpu.get_status();
   }
 
+  rewind = nullptr;
+
   return 1;
 }
 
@@ -227,7 +254,7 @@ void Console::draw_status() {
   line += 2;
   col = STATUS_X - 1;
   buff = "OP: [" + uint8_to_bin(current_state.opcode) + "]    " +
-         current_state.opcode_name + "  XXXX";
+         std::string(current_state.opcode_name) + "  XXXX";
   sprintf(&(buff[23]), "0x%02X", current_state.opcode);
   memcpy(&(display[line][col]), &(buff[0]), buff.length());
 
@@ -301,6 +328,17 @@ void Console::draw_logs() {
   }
 }
 
+void Console::draw_rewind() {
+  buff = "REWIND: " + std::to_string(rewind->size()) + " snapshots, " +
+         std::to_string(rewind->memory_usage() / 1024) + " KB";
+  buff.resize(WIDTH - 1 - REWIND_X, EMPTY);
+  memcpy(&(display[1][REWIND_X]), &(buff[0]), buff.length());
+
+  buff = "Last step back:  " + std::to_string(rewind->last_latency()) + " us";
+  buff.resize(WIDTH - 1 - REWIND_X, EMPTY);
+  memcpy(&(display[2][REWIND_X]), &(buff[0]), buff.length());
+}
+
 void Console::set_header_line_2(const char *str, size_t size) {
   memcpy(&(display[1][0]), str, size);
 }
@@ -317,7 +355,7 @@ void Console::show() {
   }
 }
 
-bool Console::get_input() {
+Console::command_t Console::get_input() {
   char in;
   int i = 0;
 
@@ -336,7 +374,7 @@ bool Console::get_input() {
 
     case 'c': // Next clock tick
     case 'C':
-      return true;
+      return command_t::CLOCK;
 
     case 'l':
     case 'L':
@@ -354,9 +392,13 @@ bool Console::get_input() {
 
       break;
 
+    case 'p': // Previous clock tick
+    case 'P':
+      return command_t::BACK;
+
     case 'q': // Quit
     case 'Q':
-      return false;
+      return command_t::QUIT;
 
     default:
       break;
@@ -365,7 +407,7 @@ bool Console::get_input() {
     show();
   }
 
-  return false;
+  return command_t::QUIT;
 }
 
 void Console::push_log(const std::string &str) {
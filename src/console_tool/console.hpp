@@ -3,6 +3,8 @@
 #include <array>
 #include <stdint.h>
 
+class Rewind;
+
 class Console {
 private:
   static const unsigned int LOG_LINES = 6;
@@ -15,6 +17,13 @@ private:
   static const unsigned int MEM_WIDTH = 16;
 
   static const unsigned int STATUS_X = 60;
+  static const unsigned int REWIND_X = 40;
+
+  enum class command_t { // What to do after get_input()
+    QUIT,
+    CLOCK, // Next clock tick
+    BACK   // Back of one clock tick
+  };
 
   char display[HEIGHT][WIDTH];
 
@@ -23,6 +32,7 @@ private:
   uint8_t *mem;
   size_t mem_size;
   std::string buff;
+  const Rewind *rewind = nullptr;
 
   std::array<std::string, LOG_LINES> logs;
   unsigned int log_head = 0;
@@ -31,8 +41,9 @@ private:
   void draw_status();
   void draw_exec_log();
   void draw_logs();
+  void draw_rewind();
   void show();
-  bool get_input();
+  command_t get_input();
 
   void set_header_line_2(const char *str, size_t size);
   void set_header_line_3(const char *str, size_t size);
@@ -0,0 +1,48 @@
+#include "alu.hpp"
+
+static constexpr uint8_t nz(const uint8_t val) {
+  return (val == 0x00 ? ALU_Z : 0x00) | (val & ALU_N);
+}
+
+static constexpr std::array<uint8_t, 256> make_nz_table() {
+  std::array<uint8_t, 256> table = {};
+
+  for (unsigned int val = 0; val < 256; val++) {
+    table[val] = nz(val);
+  }
+
+  return table;
+}
+
+// Build a shift table from the result and the carry out of every [C][M]
+template <typename F> static constexpr shift_table_t make_shift_table(F op) {
+  shift_table_t table = {};
+
+  for (unsigned int carry = 0; carry < 2; carry++) {
+    for (unsigned int val = 0; val < 256; val++) {
+      uint16_t tmp = op(val, carry); // Bit 8 is the carry out
+      uint8_t result = tmp & 0x00FF;
+
+      table[carry][val] = {result, static_cast<uint8_t>(
+                                       nz(result) | ((tmp >> 8) & ALU_C))};
+    }
+  }
+
+  return table;
+}
+
+constexpr std::array<uint8_t, 256> nz_table = make_nz_table();
+
+constexpr shift_table_t asl_table =
+    make_shift_table([](uint16_t val, uint16_t) { return val << 1; });
+
+constexpr shift_table_t lsr_table = make_shift_table(
+    [](uint16_t val, uint16_t) { return (val >> 1) | ((val & 0x01) << 8); });
+
+constexpr shift_table_t rol_table = make_shift_table(
+    [](uint16_t val, uint16_t carry) { return (val << 1) | carry; });
+
+constexpr shift_table_t ror_table =
+    make_shift_table([](uint16_t val, uint16_t carry) {
+      return (val >> 1) | (carry << 7) | ((val & 0x01) << 8);
+    });
@@ -0,0 +1,36 @@
+#pragma once
+#include <array>
+#include <stdint.h>
+
+// Flags of the ALU results, same bits of MOS6502::status_flag_t
+#define ALU_N 0x80
+#define ALU_O 0x40
+#define ALU_Z 0x02
+#define ALU_C 0x01
+
+struct alu_result_t {
+  uint8_t result; // Result byte
+  uint8_t flags;  // N, O, Z and C of the operation, the other bits are 0
+};
+
+// Precomputed results of the ALU operations, used by the cycle-accurate
+// engine (the instruction level engine, the recompiler and the JIT keep the
+// lazy flags). The tables are built at compile time in alu.cpp. ADC and SBC
+// stay arithmetic: a table of [C][A][M] is 128KB and its load is slower than
+// the addition
+
+// N and Z of every byte
+extern const std::array<uint8_t, 256> nz_table;
+
+// Shift and rotate of M, indexed by [C][M]. ASL and LSR ignore the carry in
+typedef std::array<std::array<alu_result_t, 256>, 2> shift_table_t;
+
+extern const shift_table_t asl_table;
+extern const shift_table_t lsr_table;
+extern const shift_table_t rol_table;
+extern const shift_table_t ror_table;
+
+// Flags of the comparison of 'reg' with 'val' (CMP, CPX, CPY), N, Z and C
+inline uint8_t alu_compare(const uint8_t reg, const uint8_t val) {
+  return nz_table[static_cast<uint8_t>(reg - val)] | (reg >= val ? ALU_C : 0);
+}
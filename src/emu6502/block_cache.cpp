@@ -0,0 +1,35 @@
+#include "block_cache.hpp"
+
+BlockCache::BlockCache() : blocks(BLOCK_CACHE_SIZE) {}
+
+void BlockCache::invalidate(const uint8_t page, const unsigned int count) {
+  for (unsigned int i = page; i < page + count && i < versions.size(); i++) {
+    versions[i]++;
+    code[i] = false;
+  }
+}
+
+void BlockCache::fuse(code_block_t &block) {
+  block.fused = true;
+
+  for (unsigned int i = 0; i + 1 < block.length; i++) {
+    decoded_instruction_t *instruction = &block.instructions[i];
+
+    for (unsigned int j = 0; j < fused_pairs.size(); j++) {
+      if (fused_pairs[j].first == instruction[0].opcode &&
+          fused_pairs[j].second == instruction[1].opcode) {
+        instruction->fused = j + 1;
+        i++; // The second instruction is part of the pair
+        break;
+      }
+    }
+  }
+}
+
+void BlockCache::drop_native() {
+  for (code_block_t &block : blocks) {
+    block.executions = 0;
+    block.translated = false;
+    block.native = nullptr;
+  }
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include "opcode.hpp"
+#include <array>
+#include <stdint.h>
+#include <vector>
+
+#define BLOCK_MAX_INSTRUCTIONS 16
+#define BLOCK_CACHE_SIZE 4096 // Blocks in the cache, must be a power of 2
+#define BLOCK_FUSE_THRESHOLD 8 // Block entries before its pairs are fused
+
+struct jit_state_t;
+
+// Native code of the first instructions of a block, see jit.hpp. Return the
+// number of instructions executed
+typedef unsigned int (*native_block_t)(jit_state_t *state);
+
+// Instruction decoded by the block cache
+struct decoded_instruction_t {
+  uint8_t opcode;
+  uint8_t args[2]; // Operands, only the ones of the opcode are valid
+  // 1 + the index in fused_pairs if this and the next instruction run as a
+  // superinstruction, 0 otherwise
+  uint8_t fused;
+};
+
+// Superinstructions: pairs of opcodes frequent in the 6502 code (counted
+// loops, copies, compares and additions) that the cached engine executes
+// with one dispatch. The cycles are still the ones of the two instructions
+struct fused_pair_t {
+  uint8_t first;
+  uint8_t second;
+};
+
+// clang-format off
+constexpr std::array<fused_pair_t, 16> fused_pairs = {{
+  {0xCA, 0xD0}, // DEX       ; BNE
+  {0x88, 0xD0}, // DEY       ; BNE
+  {0xE8, 0xD0}, // INX       ; BNE
+  {0xC8, 0xD0}, // INY       ; BNE
+  {0xE6, 0xD0}, // INC zp    ; BNE
+  {0xC6, 0xD0}, // DEC zp    ; BNE
+  {0xC9, 0xF0}, // CMP #     ; BEQ
+  {0xC9, 0xD0}, // CMP #     ; BNE
+  {0x18, 0x69}, // CLC       ; ADC #
+  {0x18, 0x65}, // CLC       ; ADC zp
+  {0x38, 0xE9}, // SEC       ; SBC #
+  {0xA9, 0x85}, // LDA #     ; STA zp
+  {0xA9, 0x8D}, // LDA #     ; STA abs
+  {0xA5, 0x85}, // LDA zp    ; STA zp
+  {0xAD, 0x8D}, // LDA abs   ; STA abs
+  {0xBD, 0x9D}, // LDA abs,X ; STA abs,X
+}};
+// clang-format on
+
+// Straight-line run of decoded instructions. The block ends with the first
+// instruction that can change the flow (branches, jumps, BRK, RTI, RTS and the
+// illegal opcodes) or after BLOCK_MAX_INSTRUCTIONS. The cycles of every
+// instruction are known from its opcode, see opcode_table
+struct code_block_t {
+  uint16_t pc;          // Address of the first instruction
+  uint8_t length;       // Instructions in the block, 0 if the slot is empty
+  uint8_t pages[2];     // First and last page of the code of the block
+  uint32_t versions[2]; // Versions of the pages when the block was decoded
+  decoded_instruction_t instructions[BLOCK_MAX_INSTRUCTIONS];
+
+  uint32_t executions;    // Entries in the block, see fuse() and the JIT
+  bool fused;             // The superinstructions of the block are selected
+  bool translated;        // The block went through the JIT
+  native_block_t native;  // Native code of the block, nullptr if none
+  uint16_t native_cycles; // Upper bound of the cycles of the native code
+};
+
+// Cache of the decoded blocks of the instruction level engine, indexed by the
+// PC of their first instruction. The blocks are never patched: every page has
+// a version, bumped when a write hits a page with cached code, and a block is
+// valid only if its pages have the same versions it was decoded with.
+//
+// The cache sees only the writes of the cpu (see MOS6502::set_block_cache()),
+// the host must call invalidate() when it changes the code by itself.
+class BlockCache {
+public:
+  BlockCache();
+
+  // Block of the code at 'pc'. It is decoded with 'read(address)' if it is not
+  // in the cache or if its code was modified
+  template <typename F> code_block_t &get(const uint16_t pc, F read);
+
+  // Notify a write at 'address', return true if it modified the code of a
+  // cached block (the blocks of the page are invalidated)
+  bool write(const uint16_t address);
+
+  // Invalidate the blocks with code in the 'count' pages from 'page'
+  void invalidate(const uint8_t page, const unsigned int count);
+
+  // Mark the pairs of 'block' that are in fused_pairs, called when the block
+  // is hot. The pairs do not overlap
+  void fuse(code_block_t &block);
+
+  // Forget the native code of all the blocks, e.g. when it is freed
+  void drop_native();
+
+  // The pages with cached code, indexed by page
+  const bool *code_pages() const { return code.data(); }
+
+private:
+  std::vector<code_block_t> blocks;        // Direct mapped on the PC
+  std::array<uint32_t, 256> versions = {}; // Version of every page
+  std::array<bool, 256> code = {};         // The page has cached code
+
+  bool valid(const code_block_t &block, const uint16_t pc) const;
+};
+
+// The instruction can change the PC, so it is the last one of its block
+constexpr bool ends_block(const operation_t op) {
+  using O = operation_t;
+
+  switch (op) {
+  case O::BCC: case O::BCS: case O::BEQ: case O::BMI: case O::BNE:
+  case O::BPL: case O::BVC: case O::BVS: case O::BRK: case O::JMP:
+  case O::JAM: case O::JSR: case O::RTI: case O::RTS: case O::XXX:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+inline bool BlockCache::write(const uint16_t address) {
+  const uint8_t page = address >> 8;
+
+  if (!code[page]) {
+    return false;
+  }
+
+  invalidate(page, 1);
+  return true;
+}
+
+inline bool BlockCache::valid(const code_block_t &block,
+                              const uint16_t pc) const {
+  return block.length != 0 && block.pc == pc &&
+         versions[block.pages[0]] == block.versions[0] &&
+         versions[block.pages[1]] == block.versions[1];
+}
+
+template <typename F> code_block_t &BlockCache::get(const uint16_t pc, F read) {
+  code_block_t &block = blocks[pc & (BLOCK_CACHE_SIZE - 1)];
+
+  if (valid(block, pc)) {
+    return block;
+  }
+
+  uint16_t address = pc;
+  block.pc = pc;
+  block.length = 0;
+  block.executions = 0;
+  block.fused = false;
+  block.translated = false;
+  block.native = nullptr;
+  block.native_cycles = 0;
+
+  while (block.length < BLOCK_MAX_INSTRUCTIONS) {
+    decoded_instruction_t &instruction = block.instructions[block.length++];
+    instruction.opcode = read(address++);
+    instruction.fused = 0;
+
+    const opcode_t &info = opcode_table[instruction.opcode];
+    for (unsigned int i = 0; i + 1 < info.instruction_bytes; i++) {
+      instruction.args[i] = read(address++);
+    }
+
+    if (ends_block(info.operation)) {
+      break;
+    }
+  }
+
+  // A block is at most 48 bytes, so it spans one or two pages
+  block.pages[0] = pc >> 8;
+  block.pages[1] = static_cast<uint16_t>(address - 1) >> 8;
+
+  for (unsigned int i = 0; i < 2; i++) {
+    block.versions[i] = versions[block.pages[i]];
+    code[block.pages[i]] = true;
+  }
+
+  return block;
+}
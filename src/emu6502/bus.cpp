@@ -0,0 +1,12 @@
+#include "bus.hpp"
+
+void RamBus::mem_access(void *usr_data, const uint16_t address,
+                        const access_mode_t read_write, uint8_t &data) {
+  RamBus *bus = (RamBus *)usr_data;
+
+  if (read_write == access_mode_t::WRITE) {
+    bus->write(address, data);
+  } else {
+    data = bus->read(address);
+  }
+}
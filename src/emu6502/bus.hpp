@@ -0,0 +1,129 @@
+#pragma once
+#include "common.hpp"
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+// The instruction level engine accesses the memory through a Bus, a type
+// passed as template parameter with the methods:
+//
+//   uint8_t read(const uint16_t address);
+//   void write(const uint16_t address, const uint8_t data);
+//
+// The bus calls are resolved at compile time, so the accesses of a simple bus
+// (e.g. RamBus) are inlined in the instruction handlers. See the Bus versions
+// of MOS6502::step() and of the run functions.
+//
+// A bus can also have the method:
+//
+//   uint64_t stable_until(const uint16_t address);
+//
+// Return the cycle until which the reads of 'address' give the same value and
+// have no side effects, 0 if unknown. The engine fast-forwards the idle loops
+// that poll only stable addresses, see StepEngine. The buses without it have
+// no idle loops.
+
+// True if 'Bus' has the stable_until() method
+template <typename Bus, typename = void>
+struct bus_has_stable_until : std::false_type {};
+template <typename Bus>
+struct bus_has_stable_until<
+    Bus, std::void_t<decltype(std::declval<Bus &>().stable_until(0))>>
+    : std::true_type {};
+
+// Bus over a mem_access_callback
+class CallbackBus {
+public:
+  CallbackBus(mem_access_callback mem_acc_clb, void *usr_data)
+      : mem_access(mem_acc_clb), user_data(usr_data) {}
+
+  uint8_t read(const uint16_t address) {
+    uint8_t data = 0;
+    // NOTE: intentionally not checking if function is nullptr
+    mem_access(user_data, address, access_mode_t::READ, data);
+    return data;
+  }
+
+  void write(const uint16_t address, const uint8_t val) {
+    uint8_t data = val;
+    mem_access(user_data, address, access_mode_t::WRITE, data);
+  }
+
+private:
+  mem_access_callback mem_access;
+  void *user_data;
+};
+
+// Page of 256 bytes of the MOS6502 memory map, see MOS6502::map_memory()
+struct mem_page_t {
+  uint8_t *read;  // Host memory of the page, nullptr to use the callback
+  uint8_t *write; // Host memory of the page, nullptr to use the callback
+};
+
+// Bus over the 256 pages table of the MOS6502. The mapped pages are accessed
+// directly, the others through the mem_access_callback. Used by the MOS6502
+// callback API. The mapped pages are stable, the host changes them only
+// between the runs, the others until the cycles in 'stable_reads' (one per
+// page, see MOS6502::set_stable_reads()), if any
+class PageTableBus {
+public:
+  PageTableBus(const mem_page_t *page_table, mem_access_callback mem_acc_clb,
+               void *usr_data, const uint64_t *stable_reads = nullptr)
+      : pages(page_table), callback(mem_acc_clb, usr_data),
+        stable(stable_reads) {}
+
+  const mem_page_t *table() const { return pages; }
+
+  uint64_t stable_until(const uint16_t address) const {
+    if (pages[address >> 8].read) {
+      return UINT64_MAX;
+    }
+
+    return stable ? stable[address >> 8] : 0;
+  }
+
+  uint8_t read(const uint16_t address) {
+    const mem_page_t &page = pages[address >> 8];
+
+    if (page.read) {
+      return page.read[address & 0x00FF];
+    }
+
+    return callback.read(address);
+  }
+
+  void write(const uint16_t address, const uint8_t data) {
+    const mem_page_t &page = pages[address >> 8];
+
+    if (page.write) {
+      page.write[address & 0x00FF] = data;
+    } else {
+      callback.write(address, data);
+    }
+  }
+
+private:
+  const mem_page_t *pages;
+  CallbackBus callback;
+  const uint64_t *stable; // nullptr if no page is stable
+};
+
+// Bus over a flat 64KB memory
+class RamBus {
+public:
+  explicit RamBus(uint8_t *memory) : mem(memory) {}
+
+  uint8_t read(const uint16_t address) { return mem[address]; }
+  void write(const uint16_t address, const uint8_t data) {
+    mem[address] = data;
+  }
+  uint64_t stable_until(const uint16_t) const { return UINT64_MAX; }
+
+  // mem_access_callback on the same memory, to be used with the RamBus as
+  // usr_data by the cycle-accurate engine
+  static void mem_access(void *usr_data, const uint16_t address,
+                         const access_mode_t read_write, uint8_t &data);
+
+private:
+  uint8_t *mem; // 64KB, every address is RAM
+};
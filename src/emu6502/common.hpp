@@ -1,11 +1,12 @@
 #pragma once
 #include <stdint.h>
 #include <string>
+#include <string_view>
 
 enum class access_mode_t { // Access mode type
   READ = 0,                // Read from memory
   WRITE,                   // Write to memory
-  READ_ONLY
+  READ_ONLY                // Read without side effects on the devices
 };
 
 /**
@@ -32,8 +33,9 @@ struct p_state_t {
   uint8_t P;   // Processor stats
   uint16_t PC; // Program counter
 
-  // Mnemonic name of the last executed instruction
-  std::string opcode_name;
+  // Mnemonic name of the last executed instruction, points to the static
+  // opcode table
+  std::string_view opcode_name;
   uint8_t opcode; // Last executed operational code
 
   // The size of byte of the current opcode. Can be 1, 2 or 3
@@ -59,11 +61,48 @@ struct p_state_t {
   // Argument 2 of the last opcode executed. Is valid only if opcode_size > 2
   uint8_t arg2;
 
-  // Total cycles executed by the cpu. NOTE(max): currently not used
-  uint32_t tot_cycles;
-  int64_t time; // Time that this cycle take to execute in ms
+  // Total cycles executed by the cpu
+  uint64_t tot_cycles;
 };
 
+// Host time spent on the emulation, collected only when the profiling is
+// enabled. The times are in host ticks, see host_ticks()
+struct opcode_profile_t {
+  uint64_t count; // Times the opcode was executed
+  uint64_t ticks; // Host ticks spent executing it
+};
+
+struct profile_t {
+  opcode_profile_t opcodes[256]; // Indexed by opcode
+  uint64_t runs;                 // Number of step() and run calls
+  uint64_t run_ticks;            // Host ticks spent inside them
+  uint64_t run_cycles;           // Emulated cycles executed by them
+};
+
+enum class stop_reason_t { // Why a run returned
+  CYCLES = 0,                // The cycle budget is exhausted
+  PC,                        // The program counter reached the target address
+  PREDICATE,                 // The stop predicate returned true
+  HALT                       // The cpu is halted by a JAM opcode
+};
+
+// Data structure returned by the run functions
+struct run_result_t {
+  uint64_t cycles;      // Cycles actually executed
+  stop_reason_t reason; // Why the run stopped
+  uint16_t PC;          // Program counter at the end, e.g. the JAM opcode
+};
+
+// Predicate used by MOS6502::run_until() to decide when to stop. It is checked
+// after every instruction and the cpu registers are up to date when called.
+// Must not modify the cpu
+typedef bool (*stop_predicate)(void *usr_data);
+
+// Callback of an event scheduled with MOS6502::schedule(), 'cycle' is the one
+// at which the event was due. The cpu registers are up to date when called,
+// the callback can change the interrupt lines and schedule or cancel events
+typedef void (*event_callback)(void *usr_data, const uint64_t cycle);
+
 // This is the callback that the cpu use to log. If set the CPU will log, if not
 // the log will be just skipped
 typedef void (*log_callback)(const std::string &log);
\ No newline at end of file
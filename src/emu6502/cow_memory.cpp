@@ -0,0 +1,70 @@
+#include "cow_memory.hpp"
+
+CowMemory::CowMemory() {
+  // Shared by all the memories, never written
+  static const std::shared_ptr<page_data_t> zero_page =
+      std::make_shared<page_data_t>();
+
+  for (unsigned int page = 0; page < pages.size(); page++) {
+    data[page] = zero_page;
+    pages[page] = {zero_page->bytes, nullptr};
+  }
+}
+
+std::unique_ptr<CowMemory> CowMemory::fork() {
+  std::unique_ptr<CowMemory> child = std::make_unique<CowMemory>();
+
+  for (unsigned int page = 0; page < pages.size(); page++) {
+    child->data[page] = data[page];
+    child->pages[page] = {data[page]->bytes, nullptr};
+
+    pages[page].write = nullptr;
+    if (cpu) {
+      cpu->page_table[page].write = nullptr;
+    }
+  }
+
+  return child;
+}
+
+void CowMemory::attach(MOS6502 &cpu) {
+  this->cpu = &cpu;
+  cpu.mem_access = mem_access;
+  cpu.user_data = this;
+  cpu.page_table = pages;
+  cpu.invalidate_code(0x00, pages.size());
+}
+
+void CowMemory::load(const uint16_t address, const uint8_t *buffer,
+                     const size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    write(address + i, buffer[i]);
+  }
+}
+
+void CowMemory::mem_access(void *usr_data, const uint16_t address,
+                           const access_mode_t read_write, uint8_t &data) {
+  CowMemory *memory = (CowMemory *)usr_data;
+
+  if (read_write == access_mode_t::WRITE) {
+    memory->write(address, data);
+  } else {
+    data = memory->read(address);
+  }
+}
+
+uint8_t *CowMemory::own(const uint8_t page) {
+  // The other forks keep the old page
+  if (data[page].use_count() > 1) {
+    data[page] = std::make_shared<page_data_t>(*data[page]);
+    copies++;
+  }
+
+  uint8_t *bytes = data[page]->bytes;
+  pages[page] = {bytes, bytes};
+  if (cpu) {
+    cpu->page_table[page] = pages[page];
+  }
+
+  return bytes;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "mos6502.hpp"
+#include <array>
+#include <memory>
+#include <stdint.h>
+
+// 64KB of RAM that can be forked, e.g. to explore many continuations of a run
+// from the same point. The memory is made of pages of 256 bytes shared
+// copy-on-write between the forks: a page is copied only when a fork writes
+// it, so a fork costs the pages written after it instead of the whole memory.
+//
+// It is a Bus (see bus.hpp) and it can be attached to a MOS6502 for the
+// callback API: its pages are mapped in the page table of the cpu, the shared
+// ones without the write pointer, so the first write of a shared page goes
+// through mem_access(), which copies the page and maps the copy writable.
+// Every address is RAM, like RamBus. The memory must outlive the attached cpu
+class CowMemory {
+public:
+  CowMemory(); // All zeros, without any page allocated
+  CowMemory(const CowMemory &) = delete;
+  CowMemory &operator=(const CowMemory &) = delete;
+
+  // New memory with the same content of this one, sharing all its pages. The
+  // pages of this one become shared too: the next write of either copies them
+  std::unique_ptr<CowMemory> fork();
+
+  // Map the pages in the page table of 'cpu' and make mem_access() its
+  // callback, see MOS6502::clone(). The cached code of the cpu is invalidated
+  void attach(MOS6502 &cpu);
+
+  // Copy 'size' bytes from 'buffer' at 'address', e.g. to load a program.
+  // The code cached by the attached cpu is not invalidated
+  void load(const uint16_t address, const uint8_t *buffer, const size_t size);
+
+  // Pages copied by this memory so far
+  unsigned int copied_pages() const { return copies; }
+
+  uint8_t read(const uint16_t address) const {
+    return pages[address >> 8].read[address & 0x00FF];
+  }
+
+  void write(const uint16_t address, const uint8_t data) {
+    uint8_t *page = pages[address >> 8].write;
+
+    if (!page) {
+      page = own(address >> 8);
+    }
+
+    page[address & 0x00FF] = data;
+  }
+
+  uint64_t stable_until(const uint16_t) const { return UINT64_MAX; }
+
+  // mem_access_callback on the memory, usr_data is the CowMemory. Set by
+  // attach(), it receives only the writes of the shared pages
+  static void mem_access(void *usr_data, const uint16_t address,
+                         const access_mode_t read_write, uint8_t &data);
+
+private:
+  struct page_data_t {
+    uint8_t bytes[0x0100];
+  };
+
+  // Make 'page' private to this memory, copying it if it is still shared
+  // with other forks, and map it writable. Return its bytes
+  uint8_t *own(const uint8_t page);
+
+  std::array<std::shared_ptr<page_data_t>, 256> data;
+  // The bytes of the pages, the write pointer is nullptr while shared
+  std::array<mem_page_t, 256> pages;
+  MOS6502 *cpu = nullptr; // See attach()
+  unsigned int copies = 0;
+};
@@ -0,0 +1,5 @@
+#include "engine.hpp"
+
+// The engines of the MOS6502 callback API, without and with the block cache
+template class StepEngine<PageTableBus>;
+template class StepEngine<PageTableBus, true>;
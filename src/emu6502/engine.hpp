@@ -0,0 +1,1263 @@
+#pragma once
+#include "bus.hpp"
+#include "lazy_alu.hpp"
+#include "mos6502.hpp"
+#include "opcode.hpp"
+#include <algorithm>
+#include <type_traits>
+
+#define IDLE_LOOP_MAX_BYTES 16 // Longest body of an idle loop, jump included
+
+// Instruction level engine used by MOS6502::step() and the run functions.
+//
+// It executes a whole instruction per call and never touches the microcode
+// queue, so the per-cycle bus behaviour is not reproduced (no dummy reads or
+// writes), but the registers, the memory and the cycle count (page crossing
+// and branch penalties included) are the same as the cycle-accurate engine.
+//
+// The engine works on a local copy of the registers and writes them back to
+// the cpu with sync(), so the compiler does not need to reload them after
+// every memory callback.
+//
+// The registers and the flags are the ones of LazyAlu (see lazy_alu.hpp),
+// the P register is composed only when it is observed (PHP, BRK, sync()).
+// The branches and the carry users read the single flag directly.
+//
+// Every opcode has its own handler, instantiated at compile time from the
+// addressing mode and the operation in the opcode table, so the addressing
+// is inlined in the operation. The run loops dispatch the handlers with a
+// threaded code (computed goto) when the compiler supports it.
+//
+// The CACHED instances execute from the block cache (see
+// MOS6502::set_block_cache()): the opcodes and the operands come from the
+// decoded blocks instead of the memory, and the bus state of their fetches is
+// replayed. A write that hits cached code ends the current block, so the next
+// instruction is decoded again. The other instances have no cache code.
+// In run(), without profiling, the CACHED instances also execute the pairs
+// of fused_pairs (see block_cache.hpp) of the hot blocks as
+// superinstructions: one dispatch for both, the second is skipped if the
+// first modified the code or reached the end cycle.
+//
+// The CACHED PageTableBus instances also run the native code of the hot
+// blocks in run(), if the JIT is enabled (see MOS6502::set_jit()) and the
+// profiling is not. The native code runs only when the whole of it fits in
+// the cycles left, so the run stops on the same instruction boundary.
+//
+// In run(), without profiling, the idle loops are fast-forwarded: a short
+// loop closed by a backward branch or JMP, whose body only reads stable
+// addresses (see Bus::stable_until() in bus.hpp) and does not change X, Y or
+// the memory, is a fixed point once two consecutive iterations leave the same
+// registers. Its remaining iterations up to the end of the run (or to the end
+// of the stable reads) are skipped by adding their cycles, so the run stops
+// on the same instruction boundary with the same state.
+//
+// The engine does not know the scheduled events (see MOS6502::schedule()):
+// MOS6502::run_engine() ends every run at the next event, so the idle loops
+// are fast-forwarded up to it. Between the runs it dispatches the events and
+// polls the interrupts, the interrupt sequence is executed as the first
+// instruction of the next run (see interrupt()). A run ends also after CLI,
+// PLP and RTI if they unmask an active IRQ line.
+//
+// The memory is accessed through 'Bus', see bus.hpp. The engine is a
+// template, so a host can instantiate it on its own bus and get the memory
+// accesses inlined. The PageTableBus instances, used by the MOS6502 callback
+// API, are compiled once in engine.cpp.
+template <typename Bus, bool CACHED = false>
+class StepEngine : private LazyAlu {
+public:
+  StepEngine(MOS6502 &cpu, Bus &bus);
+
+  void sync(); // Write the registers back to the cpu
+
+  // Execute instructions until the cycles counter reaches 'end' or the stop
+  // condition is met. The checks are done at the instruction boundaries
+  stop_reason_t run(const uint64_t end);
+  stop_reason_t run_until_pc(const uint16_t pc, const uint64_t end);
+  stop_reason_t run_until(stop_predicate predicate, void *usr_data,
+                          const uint64_t end);
+
+  // Execute the interrupt sequence of the vector at 'vector' (BRK_PCL or
+  // NMI_PCL) like an instruction of 7 cycles, see MOS6502::IRQ
+  void interrupt(const uint16_t vector);
+
+private:
+  // The operations that can unmask the IRQ, a run ends after them if the IRQ
+  // line is active, so the interrupt is polled
+  static constexpr bool unmasks_irq(const operation_t op) {
+    return op == operation_t::CLI || op == operation_t::PLP ||
+           op == operation_t::RTI;
+  }
+  ENGINE_INLINE bool irq_unmasked() const {
+    return cpu.irq_line && !flag(MOS6502::I);
+  }
+
+  MOS6502 &cpu;
+  Bus &bus;
+
+  profile_t *profile; // nullptr if the profiling is disabled
+  BlockCache *cache;  // Used only by the CACHED instances
+  uint64_t *dirty;    // nullptr if the dirty pages are not tracked
+
+  const decoded_instruction_t *next;      // Next instruction of the block
+  const decoded_instruction_t *block_end; // End of the current block
+  bool code_modified; // A write hit cached code, the block is stale
+
+  // The instances that can run the native code of the JIT
+  static constexpr bool JIT = CACHED && std::is_same_v<Bus, PageTableBus>;
+  Jit *jit;         // nullptr if the JIT is disabled
+  uint64_t jit_end; // End cycle of the native code, 0 outside run()
+
+  // The instances that can fast-forward the idle loops
+  static constexpr bool IDLE = bus_has_stable_until<Bus>::value;
+  uint64_t idle_end; // End cycle of the fast-forward, 0 outside run()
+
+  // Candidate idle loop, the registers are the ones after the jump back
+  struct idle_loop_t {
+    uint16_t head;       // Target of the jump back
+    uint16_t tail;       // Address of the jump back
+    unsigned int length; // Cycles of an iteration, 0 if no candidate
+    uint64_t stable;     // End of the stable reads of the body
+    uint64_t cycles;     // Cycles counter after the jump back
+    uint8_t A;
+    uint8_t X;
+    uint8_t Y;
+    uint8_t S;
+    uint8_t P;
+    uint16_t ZN;
+    bool carry;
+    bool overflow;
+  } idle;
+  uint32_t idle_rejected; // Jump back of a loop that can not be idle, or -1
+
+  uint8_t opcode;
+  uint16_t PC_executed;
+  uint8_t args[2];       // Operands of the current instruction
+  unsigned int args_len; // Number of operands fetched so far
+  uint16_t address_bus;  // Last accessed address
+  uint8_t data_bus;      // Last data passed through the bus
+
+  bool page_crossed;     // The last indexed addressing crossed a page
+  unsigned int penalty;  // Extra cycles of the current instruction
+
+  ENGINE_INLINE uint8_t fetch_opcode(); // Fetch and start a new instruction
+  ENGINE_INLINE void exec();            // Fetch, decode and execute
+  // Start a new instruction from the block cache, see fetch_opcode(). If
+  // FUSE, return 256 + the index in fused_pairs for the fused pairs
+  template <bool FUSE = false>
+  ENGINE_INLINE unsigned int fetch_cached_opcode();
+  // Start the decoded 'instruction', replay the bus state of its fetch
+  ENGINE_INLINE void replay(const decoded_instruction_t &instruction);
+  void next_block(); // Move to the block at PC, decode it if needed
+  // Run the native code of 'block' (translate it when hot), if it fits
+  void run_native(code_block_t &block);
+
+  // Called after a jump back to PC from PC_executed, fast-forward the loop
+  // if it is idle
+  void idle_loop();
+  // Cycles of an iteration of the loop from 'head' to the jump back at
+  // 'tail', 0 if it can not be idle. 'stable' is set to the end of the stable
+  // reads of the loop
+  unsigned int idle_iteration(const uint16_t head, const uint16_t tail,
+                              uint64_t &stable);
+  // Read the code at 'address' for idle_iteration(), if stable
+  bool idle_code(const uint16_t address, uint8_t &val, uint64_t &stable);
+
+  template <uint8_t OPCODE> ENGINE_INLINE void exec_opcode();
+  template <addressing_t MODE, operation_t OP> ENGINE_INLINE void execute();
+
+  // Execute instructions until 'end' or until stop() returns true. The
+  // PROFILE instances time every instruction, the others have no overhead.
+  // The FUSE instances execute the fused pairs, stop() is not called between
+  // the two instructions
+  template <bool PROFILE, bool FUSE = false, typename F>
+  stop_reason_t loop(const uint64_t end, F stop, const stop_reason_t reason);
+  template <typename F>
+  stop_reason_t loop(const uint64_t end, F stop, const stop_reason_t reason);
+
+  /********************************************************
+   *                    UTIL FUNCTIONS                    *
+   ********************************************************/
+  uint8_t read(const uint16_t address);
+  void write(const uint16_t address, const uint8_t data);
+  uint8_t fetch(); // Read the next operand byte, increment PC
+  void push(const uint8_t data);
+  uint8_t pull();
+
+  void set_flag(const MOS6502::status_flag_t flag, const bool val);
+  bool flag(const MOS6502::status_flag_t flag) const;
+  friend class LazyAlu; // push() and read() for enter_interrupt()
+
+  /********************************************************
+   *                  ADDRESSING MODES                    *
+   ********************************************************/
+  // Fetch the operands and return the effective address
+  template <addressing_t MODE> ENGINE_INLINE uint16_t address();
+  // Value of the operand for the read instructions
+  template <addressing_t MODE> ENGINE_INLINE uint8_t operand();
+  // Read-Modify-Write the operand with OP, return the new value
+  template <addressing_t MODE, uint8_t (LazyAlu::*OP)(uint8_t)>
+  ENGINE_INLINE uint8_t modify();
+
+  /********************************************************
+   *                   INSTRUCTION SET                    *
+   ********************************************************/
+  // Read instructions, take the operand value. ADC, SBC, BIT and the
+  // Read-Modify-Write operations are the ones of LazyAlu
+  void AND(const uint8_t val);
+  void CMP(const uint8_t val);
+  void CPX(const uint8_t val);
+  void CPY(const uint8_t val);
+  void EOR(const uint8_t val);
+  void LDA(const uint8_t val);
+  void LDX(const uint8_t val);
+  void LDY(const uint8_t val);
+  void ORA(const uint8_t val);
+  void LAX(const uint8_t val);
+  template <addressing_t MODE> ENGINE_INLINE void NOP();
+
+  void branch(const bool taken);
+
+  void BRK();
+  void JAM();
+  void JSR();
+  void RTI();
+  void RTS();
+  void PHA();
+  void PHP();
+  void PLA();
+  void PLP();
+
+  void CLC();
+  void CLD();
+  void CLI();
+  void CLV();
+  void SEC();
+  void SED();
+  void SEI();
+
+  void DEX();
+  void DEY();
+  void INX();
+  void INY();
+
+  void TAX();
+  void TAY();
+  void TSX();
+  void TXA();
+  void TXS();
+  void TYA();
+};
+
+
+#define ADDRESS(hi, lo)                                                        \
+  (static_cast<uint16_t>((static_cast<uint16_t>(hi) << 8) | (lo)))
+
+// Expand M(opcode) for all the 256 opcodes
+#define OPCODE_ROW(M, hi)                                                      \
+  M(0x##hi##0) M(0x##hi##1) M(0x##hi##2) M(0x##hi##3) M(0x##hi##4)             \
+  M(0x##hi##5) M(0x##hi##6) M(0x##hi##7) M(0x##hi##8) M(0x##hi##9)             \
+  M(0x##hi##A) M(0x##hi##B) M(0x##hi##C) M(0x##hi##D) M(0x##hi##E)             \
+  M(0x##hi##F)
+#define FOR_EACH_OPCODE(M)                                                     \
+  OPCODE_ROW(M, 0) OPCODE_ROW(M, 1) OPCODE_ROW(M, 2) OPCODE_ROW(M, 3)          \
+  OPCODE_ROW(M, 4) OPCODE_ROW(M, 5) OPCODE_ROW(M, 6) OPCODE_ROW(M, 7)          \
+  OPCODE_ROW(M, 8) OPCODE_ROW(M, 9) OPCODE_ROW(M, A) OPCODE_ROW(M, B)          \
+  OPCODE_ROW(M, C) OPCODE_ROW(M, D) OPCODE_ROW(M, E) OPCODE_ROW(M, F)
+
+// Expand M(index) for all the fused_pairs
+#define FOR_EACH_FUSED_PAIR(M)                                                 \
+  M(0) M(1) M(2) M(3) M(4) M(5) M(6) M(7) M(8) M(9) M(10) M(11) M(12) M(13)    \
+  M(14) M(15)
+static_assert(fused_pairs.size() == 16, "FOR_EACH_FUSED_PAIR is out of date");
+
+template <typename Bus, bool CACHED>
+StepEngine<Bus, CACHED>::StepEngine(MOS6502 &cpu, Bus &bus)
+    : LazyAlu(), cpu(cpu), bus(bus),
+      profile(cpu.profiling ? &cpu.profile : nullptr),
+      cache(cpu.block_cache.get()),
+      dirty(cpu.dirty_tracking ? cpu.dirty_pages.data() : nullptr),
+      next(nullptr), block_end(nullptr), code_modified(false),
+      jit(JIT ? cpu.jit.get() : nullptr), jit_end(0),
+      idle_end(0), idle(), idle_rejected(UINT32_MAX),
+      opcode(cpu.opcode), PC_executed(cpu.PC_executed),
+      args{cpu.arg1, cpu.arg2}, args_len(0), address_bus(cpu.address_bus),
+      data_bus(cpu.data_bus), page_crossed(false), penalty(0) {
+  A = cpu.A;
+  X = cpu.X;
+  Y = cpu.Y;
+  S = cpu.S;
+  PC = cpu.PC;
+  cycles = cpu.cycles;
+  set_status(cpu.P);
+}
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::sync() {
+  cpu.A = A;
+  cpu.X = X;
+  cpu.Y = Y;
+  cpu.S = S;
+  cpu.P = status();
+  cpu.PC = PC;
+  cpu.cycles = cycles;
+
+  cpu.opcode = opcode;
+  cpu.instruction = &(MOS6502::instruction_table[opcode]);
+  cpu.address_bus = address_bus;
+  cpu.data_bus = data_bus;
+  cpu.accumulator_addressing = false;
+
+  cpu.PC_executed = PC_executed;
+  cpu.arg1 = args[0];
+  cpu.arg2 = args[1];
+}
+
+template <typename Bus, bool CACHED>
+template <bool PROFILE, bool FUSE, typename F>
+stop_reason_t StepEngine<Bus, CACHED>::loop(const uint64_t end, F stop,
+                                            const stop_reason_t reason) {
+  uint64_t ticks = 0;
+
+#ifdef __GNUC__
+  // Threaded code: every handler ends with its own dispatch jump, so the
+  // branch predictor can learn the opcode sequences
+#define HANDLER_ADDRESS(op) &&handler_##op,
+#define FUSED_HANDLER_ADDRESS(i) &&fused_handler_##i,
+  static void *const handlers[256 + fused_pairs.size()] = {
+      FOR_EACH_OPCODE(HANDLER_ADDRESS)
+          FOR_EACH_FUSED_PAIR(FUSED_HANDLER_ADDRESS)};
+#undef FUSED_HANDLER_ADDRESS
+#undef HANDLER_ADDRESS
+
+#define DISPATCH()                                                             \
+  if (cycles >= end) {                                                         \
+    return stop_reason_t::CYCLES;                                              \
+  }                                                                            \
+  if (PROFILE) {                                                               \
+    ticks = host_ticks();                                                      \
+  }                                                                            \
+  goto *handlers[CACHED ? fetch_cached_opcode<FUSE>() : fetch_opcode()]
+
+#define HANDLER(op)                                                            \
+  handler_##op : exec_opcode<op>();                                            \
+  if (PROFILE) {                                                               \
+    profile->opcodes[op].count++;                                              \
+    profile->opcodes[op].ticks += host_ticks() - ticks;                        \
+  }                                                                            \
+  if (opcode_table[op].operation == operation_t::JAM) {                        \
+    return stop_reason_t::HALT;                                                \
+  }                                                                            \
+  if (stop()) {                                                                \
+    return reason;                                                             \
+  }                                                                            \
+  if (unmasks_irq(opcode_table[op].operation) && irq_unmasked()) {            \
+    return stop_reason_t::CYCLES;                                              \
+  }                                                                            \
+  DISPATCH();
+
+// Reached only by the FUSE instances. The second instruction is already in
+// the block, the checks of fetch_cached_opcode() and DISPATCH() are left
+#define FUSED_HANDLER(i)                                                       \
+  fused_handler_##i : if (FUSE) {                                              \
+    exec_opcode<fused_pairs[i].first>();                                       \
+    if (!code_modified && cycles < end) {                                      \
+      replay(*next++);                                                         \
+      exec_opcode<fused_pairs[i].second>();                                    \
+    }                                                                          \
+  }                                                                            \
+  DISPATCH();
+
+  DISPATCH();
+  FOR_EACH_OPCODE(HANDLER)
+  FOR_EACH_FUSED_PAIR(FUSED_HANDLER)
+
+#undef FUSED_HANDLER
+#undef HANDLER
+#undef DISPATCH
+#else
+  while (cycles < end) {
+    if (PROFILE) {
+      ticks = host_ticks();
+      exec();
+      profile->opcodes[opcode].count++;
+      profile->opcodes[opcode].ticks += host_ticks() - ticks;
+    } else {
+      exec();
+    }
+
+    if (cpu.halted) {
+      return stop_reason_t::HALT;
+    }
+
+    if (stop()) {
+      return reason;
+    }
+
+    if (unmasks_irq(opcode_table[opcode].operation) && irq_unmasked()) {
+      return stop_reason_t::CYCLES;
+    }
+  }
+
+  return stop_reason_t::CYCLES;
+#endif
+}
+
+template <typename Bus, bool CACHED>
+template <typename F>
+stop_reason_t StepEngine<Bus, CACHED>::loop(const uint64_t end, F stop,
+                                            const stop_reason_t reason) {
+  if (profile) {
+    return loop<true>(end, stop, reason);
+  }
+
+  return loop<false>(end, stop, reason);
+}
+
+template <typename Bus, bool CACHED>
+stop_reason_t StepEngine<Bus, CACHED>::run(const uint64_t end) {
+  if constexpr (JIT) {
+    // No stop condition, only the cycles, so the native code can run
+    jit_end = (jit && !profile) ? end : 0;
+  }
+  if constexpr (IDLE) {
+    idle_end = profile ? 0 : end;
+  }
+
+  auto never = [] { return false; };
+  stop_reason_t reason;
+  if constexpr (CACHED) {
+    reason = profile ? loop<true>(end, never, stop_reason_t::CYCLES)
+                     : loop<false, true>(end, never, stop_reason_t::CYCLES);
+  } else {
+    reason = loop(end, never, stop_reason_t::CYCLES);
+  }
+  jit_end = 0;
+  idle_end = 0;
+  return reason;
+}
+
+template <typename Bus, bool CACHED>
+stop_reason_t StepEngine<Bus, CACHED>::run_until_pc(const uint16_t pc,
+                                                    const uint64_t end) {
+  return loop(end, [this, pc] { return PC == pc; }, stop_reason_t::PC);
+}
+
+template <typename Bus, bool CACHED>
+stop_reason_t StepEngine<Bus, CACHED>::run_until(stop_predicate predicate,
+                                                 void *usr_data,
+                                                 const uint64_t end) {
+  return loop(
+      end,
+      [this, predicate, usr_data] {
+        sync();
+        return predicate(usr_data);
+      },
+      stop_reason_t::PREDICATE);
+}
+
+template <typename Bus, bool CACHED>
+uint8_t StepEngine<Bus, CACHED>::fetch_opcode() {
+  PC_executed = PC;
+  opcode = read(PC++);
+  args_len = 0;
+  page_crossed = false;
+  penalty = 0;
+
+  return opcode;
+}
+
+template <typename Bus, bool CACHED>
+template <bool FUSE>
+unsigned int StepEngine<Bus, CACHED>::fetch_cached_opcode() {
+  // The native code can run a whole block, then the next one is needed
+  while (next == block_end || code_modified) {
+    next_block();
+  }
+
+  const decoded_instruction_t &instruction = *next++;
+  replay(instruction);
+
+  if (FUSE && instruction.fused) {
+    return 255 + instruction.fused;
+  }
+
+  return opcode;
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::replay(
+    const decoded_instruction_t &instruction) {
+  PC_executed = PC;
+  address_bus = PC++;
+  data_bus = opcode = instruction.opcode;
+  args[0] = instruction.args[0];
+  args[1] = instruction.args[1];
+  args_len = 0;
+  page_crossed = false;
+  penalty = 0;
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::next_block() {
+  code_block_t &block =
+      cache->get(PC, [this](uint16_t address) { return bus.read(address); });
+
+  next = block.instructions;
+  block_end = next + block.length;
+  code_modified = false;
+
+  // The superinstructions are selected once the block is hot
+  block.executions++;
+  if (!block.fused && block.executions >= BLOCK_FUSE_THRESHOLD) {
+    cache->fuse(block);
+  }
+
+  if constexpr (JIT) {
+    if (jit_end) {
+      run_native(block);
+    }
+  }
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::run_native(code_block_t &block) {
+  if (!block.translated && block.executions >= JIT_HOT_THRESHOLD) {
+    jit->compile(*cache, block);
+  }
+
+  if (!block.native || cycles + block.native_cycles >= jit_end) {
+    return;
+  }
+
+  jit_state_t state = {A, X, Y, S, carry, overflow, ZN, PC, cycles,
+                       bus.table(), cache->code_pages(),
+                       cpu.dirty_pages.data()};
+
+  // The instructions left by the native code are interpreted
+  next += block.native(&state);
+
+  A = state.A;
+  X = state.X;
+  Y = state.Y;
+  S = state.S;
+  carry = state.carry;
+  overflow = state.overflow;
+  ZN = state.ZN;
+  PC = state.PC;
+  cycles = state.cycles;
+}
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::exec() {
+  switch (CACHED ? fetch_cached_opcode() : fetch_opcode()) {
+#define OPCODE_CASE(op)                                                        \
+  case op:                                                                     \
+    exec_opcode<op>();                                                         \
+    break;
+
+    FOR_EACH_OPCODE(OPCODE_CASE)
+
+#undef OPCODE_CASE
+  }
+}
+
+template <typename Bus, bool CACHED>
+template <uint8_t OPCODE> void StepEngine<Bus, CACHED>::exec_opcode() {
+  constexpr opcode_t info = opcode_table[OPCODE];
+
+  execute<info.addressing, info.operation>();
+
+  if constexpr (info.page_penalty) {
+    // The high byte of the address must be fixed before the read
+    penalty += page_crossed;
+  }
+
+  if constexpr (info.operation == operation_t::XXX) {
+    cycles += 1; // Only the opcode fetch is performed
+  } else {
+    cycles += info.cycles + penalty;
+  }
+
+  if constexpr (IDLE && (info.addressing == addressing_t::REL ||
+                         OPCODE == 0x4C)) { // Branches and JMP $xxxx
+    if (idle_end && PC <= PC_executed &&
+        PC_executed - PC < IDLE_LOOP_MAX_BYTES) {
+      idle_loop();
+    }
+  }
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::idle_loop() {
+  if (PC_executed == idle_rejected) {
+    return;
+  }
+
+  // The second of two consecutive iterations with the same registers, the
+  // next ones are the same until the reads change
+  if (idle.length && idle.tail == PC_executed && idle.head == PC &&
+      cycles - idle.cycles == idle.length && idle.A == A && idle.X == X &&
+      idle.Y == Y && idle.S == S && idle.P == P && idle.ZN == ZN &&
+      idle.carry == carry && idle.overflow == overflow) {
+    // Skip the iterations that start before the end of the run and whose
+    // reads are before the end of the stable reads
+    uint64_t limit = std::min(idle_end - 1, idle.stable);
+    if (limit > cycles) {
+      cycles += (limit - cycles) / idle.length * idle.length;
+    }
+
+    idle.cycles = cycles;
+    return;
+  }
+
+  idle.length = idle_iteration(PC, PC_executed, idle.stable);
+  if (!idle.length) {
+    idle_rejected = PC_executed;
+    return;
+  }
+
+  idle.head = PC;
+  idle.tail = PC_executed;
+  idle.cycles = cycles;
+  idle.A = A;
+  idle.X = X;
+  idle.Y = Y;
+  idle.S = S;
+  idle.P = P;
+  idle.ZN = ZN;
+  idle.carry = carry;
+  idle.overflow = overflow;
+}
+
+template <typename Bus, bool CACHED>
+unsigned int StepEngine<Bus, CACHED>::idle_iteration(const uint16_t head,
+                                                     const uint16_t tail,
+                                                     uint64_t &stable) {
+  using O = operation_t;
+  using M = addressing_t;
+
+  unsigned int length = 0;
+  uint16_t address = head;
+  stable = UINT64_MAX;
+
+  while (address != tail) {
+    uint8_t bytes[3];
+    if (!idle_code(address, bytes[0], stable)) {
+      return 0;
+    }
+
+    const opcode_t &info = opcode_table[bytes[0]];
+    if (static_cast<uint16_t>(tail - address) < info.instruction_bytes) {
+      return 0; // The body does not end on the jump back
+    }
+
+    // Only the reads of the memory and the changes of A, S and P, which
+    // repeat the same once the registers are a fixed point
+    switch (info.operation) {
+    case O::ADC: case O::AND: case O::BIT: case O::CLC: case O::CLD:
+    case O::CLV: case O::CMP: case O::CPX: case O::CPY: case O::EOR:
+    case O::LDA: case O::NOP: case O::ORA: case O::SBC: case O::SEC:
+    case O::SED: case O::TXA: case O::TYA:
+      break;
+
+    default:
+      return 0;
+    }
+
+    for (unsigned int i = 1; i < info.instruction_bytes; i++) {
+      if (!idle_code(address + i, bytes[i], stable)) {
+        return 0;
+      }
+    }
+
+    // X and Y do not change in the body, so the addresses are known
+    uint16_t base = ADDRESS(bytes[2], bytes[1]);
+    uint16_t effective = base;
+
+    switch (info.addressing) {
+    case M::IMP:
+    case M::IMM:
+    case M::ABS:
+      break;
+    case M::ZPI:
+      base = effective = bytes[1];
+      break;
+    case M::ZPX:
+      base = effective = static_cast<uint8_t>(bytes[1] + X);
+      break;
+    case M::ZPY:
+      base = effective = static_cast<uint8_t>(bytes[1] + Y);
+      break;
+    case M::ABX:
+      effective = base + X;
+      break;
+    case M::ABY:
+      effective = base + Y;
+      break;
+    default:
+      return 0; // The indirect addressing reads pointers
+    }
+
+    length += info.cycles;
+    if (info.page_penalty && ((base ^ effective) & 0xFF00)) {
+      length++;
+    }
+
+    if (info.addressing != M::IMP && info.addressing != M::IMM) {
+      stable = std::min(stable, bus.stable_until(effective));
+      if (stable <= cycles) {
+        return 0;
+      }
+    }
+
+    address += info.instruction_bytes;
+  }
+
+  uint8_t bytes[3];
+  if (!idle_code(tail, bytes[0], stable)) {
+    return 0;
+  }
+
+  const opcode_t &info = opcode_table[bytes[0]];
+  for (unsigned int i = 1; i < info.instruction_bytes; i++) {
+    if (!idle_code(tail + i, bytes[i], stable)) {
+      return 0;
+    }
+  }
+
+  if (info.addressing != M::REL) {
+    return length + info.cycles; // JMP $xxxx
+  }
+
+  // Taken branch, one more cycle if it crosses the page
+  const uint16_t next = tail + info.instruction_bytes;
+  return length + info.cycles + (((head ^ next) & 0xFF00) ? 2 : 1);
+}
+
+template <typename Bus, bool CACHED>
+bool StepEngine<Bus, CACHED>::idle_code(const uint16_t address, uint8_t &val,
+                                        uint64_t &stable) {
+  stable = std::min(stable, bus.stable_until(address));
+  if (stable <= cycles) {
+    return false;
+  }
+
+  val = bus.read(address);
+  return true;
+}
+
+template <typename Bus, bool CACHED>
+template <addressing_t MODE, operation_t OP>
+void StepEngine<Bus, CACHED>::execute() {
+  using O = operation_t;
+
+  // clang-format off
+  if constexpr (OP == O::ADC)      adc(operand<MODE>());
+  else if constexpr (OP == O::AND) AND(operand<MODE>());
+  else if constexpr (OP == O::ASL) modify<MODE, &LazyAlu::asl>();
+  else if constexpr (OP == O::BCC) branch(!flag(MOS6502::C));
+  else if constexpr (OP == O::BCS) branch(flag(MOS6502::C));
+  else if constexpr (OP == O::BEQ) branch(flag(MOS6502::Z));
+  else if constexpr (OP == O::BIT) bit(operand<MODE>());
+  else if constexpr (OP == O::BMI) branch(flag(MOS6502::N));
+  else if constexpr (OP == O::BNE) branch(!flag(MOS6502::Z));
+  else if constexpr (OP == O::BPL) branch(!flag(MOS6502::N));
+  else if constexpr (OP == O::BRK) BRK();
+  else if constexpr (OP == O::BVC) branch(!flag(MOS6502::O));
+  else if constexpr (OP == O::BVS) branch(flag(MOS6502::O));
+  else if constexpr (OP == O::CLC) CLC();
+  else if constexpr (OP == O::CLD) CLD();
+  else if constexpr (OP == O::CLI) CLI();
+  else if constexpr (OP == O::CLV) CLV();
+  else if constexpr (OP == O::CMP) CMP(operand<MODE>());
+  else if constexpr (OP == O::CPX) CPX(operand<MODE>());
+  else if constexpr (OP == O::CPY) CPY(operand<MODE>());
+  else if constexpr (OP == O::DCP) CMP(modify<MODE, &LazyAlu::dec>());
+  else if constexpr (OP == O::DEC) modify<MODE, &LazyAlu::dec>();
+  else if constexpr (OP == O::DEX) DEX();
+  else if constexpr (OP == O::DEY) DEY();
+  else if constexpr (OP == O::EOR) EOR(operand<MODE>());
+  else if constexpr (OP == O::INC) modify<MODE, &LazyAlu::inc>();
+  else if constexpr (OP == O::INX) INX();
+  else if constexpr (OP == O::INY) INY();
+  else if constexpr (OP == O::ISB) sbc(modify<MODE, &LazyAlu::inc>());
+  else if constexpr (OP == O::JAM) JAM();
+  else if constexpr (OP == O::JMP) PC = address<MODE>();
+  else if constexpr (OP == O::JSR) JSR();
+  else if constexpr (OP == O::LAX) LAX(operand<MODE>());
+  else if constexpr (OP == O::LDA) LDA(operand<MODE>());
+  else if constexpr (OP == O::LDX) LDX(operand<MODE>());
+  else if constexpr (OP == O::LDY) LDY(operand<MODE>());
+  else if constexpr (OP == O::LSR) modify<MODE, &LazyAlu::lsr>();
+  else if constexpr (OP == O::NOP) NOP<MODE>();
+  else if constexpr (OP == O::ORA) ORA(operand<MODE>());
+  else if constexpr (OP == O::PHA) PHA();
+  else if constexpr (OP == O::PHP) PHP();
+  else if constexpr (OP == O::PLA) PLA();
+  else if constexpr (OP == O::PLP) PLP();
+  else if constexpr (OP == O::RLA) AND(modify<MODE, &LazyAlu::rol>());
+  else if constexpr (OP == O::ROL) modify<MODE, &LazyAlu::rol>();
+  else if constexpr (OP == O::ROR) modify<MODE, &LazyAlu::ror>();
+  else if constexpr (OP == O::RRA) adc(modify<MODE, &LazyAlu::ror>());
+  else if constexpr (OP == O::RTI) RTI();
+  else if constexpr (OP == O::RTS) RTS();
+  else if constexpr (OP == O::SAX) write(address<MODE>(), A & X);
+  else if constexpr (OP == O::SBC) sbc(operand<MODE>());
+  else if constexpr (OP == O::SEC) SEC();
+  else if constexpr (OP == O::SED) SED();
+  else if constexpr (OP == O::SEI) SEI();
+  else if constexpr (OP == O::SLO) ORA(modify<MODE, &LazyAlu::asl>());
+  else if constexpr (OP == O::SRE) EOR(modify<MODE, &LazyAlu::lsr>());
+  else if constexpr (OP == O::STA) write(address<MODE>(), A);
+  else if constexpr (OP == O::STX) write(address<MODE>(), X);
+  else if constexpr (OP == O::STY) write(address<MODE>(), Y);
+  else if constexpr (OP == O::TAX) TAX();
+  else if constexpr (OP == O::TAY) TAY();
+  else if constexpr (OP == O::TSX) TSX();
+  else if constexpr (OP == O::TXA) TXA();
+  else if constexpr (OP == O::TXS) TXS();
+  else if constexpr (OP == O::TYA) TYA();
+  else if constexpr (OP == O::XXX) cpu.log("Executed illegal opcode");
+  // clang-format on
+}
+
+/********************************************************
+ *                    UTIL FUNCTIONS                    *
+ ********************************************************/
+template <typename Bus, bool CACHED>
+uint8_t StepEngine<Bus, CACHED>::read(const uint16_t address) {
+  address_bus = address;
+  data_bus = bus.read(address);
+  return data_bus;
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::write(const uint16_t address,
+                                   const uint8_t data) {
+  address_bus = address;
+  data_bus = data;
+  bus.write(address, data);
+
+  if (dirty) {
+    mark_dirty(dirty, address);
+  }
+
+  if constexpr (CACHED) {
+    if (cache->write(address)) {
+      code_modified = true;
+    }
+  }
+}
+
+template <typename Bus, bool CACHED> uint8_t StepEngine<Bus, CACHED>::fetch() {
+  if constexpr (CACHED) {
+    // The operand was decoded with the block, only the bus state is replayed
+    address_bus = PC++;
+    data_bus = args[args_len++];
+    return data_bus;
+  }
+
+  uint8_t data = read(PC++);
+  args[args_len++] = data;
+  return data;
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::push(const uint8_t data) {
+  write(STACK_OFFSET + S--, data);
+}
+
+template <typename Bus, bool CACHED>
+uint8_t StepEngine<Bus, CACHED>::pull() { return read(STACK_OFFSET + ++S); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::set_flag(const MOS6502::status_flag_t flag,
+                                       const bool val) {
+  switch (flag) {
+  case MOS6502::C:
+    carry = val;
+    break;
+  case MOS6502::O:
+    overflow = val;
+    break;
+  case MOS6502::Z:
+  case MOS6502::N:
+    set_status(val ? (status() | flag) : (status() & ~flag));
+    break;
+  default:
+    if (val) {
+      P |= flag;
+    } else {
+      P &= ~flag;
+    }
+    break;
+  }
+}
+
+template <typename Bus, bool CACHED>
+bool StepEngine<Bus, CACHED>::flag(const MOS6502::status_flag_t flag) const {
+  switch (flag) {
+  case MOS6502::C:
+    return carry;
+  case MOS6502::O:
+    return overflow;
+  case MOS6502::Z:
+    return zero();
+  case MOS6502::N:
+    return negative();
+  default:
+    return (P & flag);
+  }
+}
+
+/********************************************************
+ *                  ADDRESSING MODES                    *
+ ********************************************************/
+template <typename Bus, bool CACHED>
+template <addressing_t MODE> uint16_t StepEngine<Bus, CACHED>::address() {
+  using A = addressing_t;
+
+  if constexpr (MODE == A::ZPI) {
+    return fetch();
+  } else if constexpr (MODE == A::ZPX) {
+    return (fetch() + X) & 0x00FF;
+  } else if constexpr (MODE == A::ZPY) {
+    return (fetch() + Y) & 0x00FF;
+  } else if constexpr (MODE == A::ABS) {
+    uint8_t lo = fetch();
+    return ADDRESS(fetch(), lo);
+  } else if constexpr (MODE == A::ABX || MODE == A::ABY) {
+    uint16_t base = address<A::ABS>();
+    uint16_t effective = base + (MODE == A::ABX ? X : Y);
+    page_crossed = (base ^ effective) & 0xFF00;
+    return effective;
+  } else if constexpr (MODE == A::IIX) {
+    uint8_t pointer = fetch() + X; // No page crossing, discarding the carry
+    uint8_t lo = read(pointer);
+    return ADDRESS(read(static_cast<uint8_t>(pointer + 1)), lo);
+  } else if constexpr (MODE == A::IIY) {
+    uint8_t pointer = fetch();
+    uint8_t lo = read(pointer);
+    // The effective address is always fetched from zero page
+    uint16_t base = ADDRESS(read(static_cast<uint8_t>(pointer + 1)), lo);
+    uint16_t effective = base + Y;
+    page_crossed = (base ^ effective) & 0xFF00;
+    return effective;
+  } else if constexpr (MODE == A::IND) {
+    uint16_t pointer = address<A::ABS>();
+    uint8_t lo = read(pointer);
+
+    // The PCH will always be fetched from the same page than PCL, i.e. page
+    // boundary crossing is not handled (hardware bug)
+    pointer = ((pointer & 0x00FF) == 0x00FF) ? pointer & 0xFF00 : pointer + 1;
+
+    return ADDRESS(read(pointer), lo);
+  } else {
+    static_assert(MODE != MODE, "The addressing mode has no address");
+  }
+}
+
+template <typename Bus, bool CACHED>
+template <addressing_t MODE> uint8_t StepEngine<Bus, CACHED>::operand() {
+  if constexpr (MODE == addressing_t::IMM) {
+    return fetch();
+  } else {
+    return read(address<MODE>());
+  }
+}
+
+template <typename Bus, bool CACHED>
+template <addressing_t MODE, uint8_t (LazyAlu::*OP)(uint8_t)>
+uint8_t StepEngine<Bus, CACHED>::modify() {
+  if constexpr (MODE == addressing_t::ACC) {
+    A = (this->*OP)(A);
+    return A;
+  } else {
+    uint16_t effective = address<MODE>();
+    uint8_t val = (this->*OP)(read(effective));
+    write(effective, val);
+    return val;
+  }
+}
+
+/********************************************************
+ *                   INSTRUCTION SET                    *
+ ********************************************************/
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::AND(const uint8_t val) {
+  A &= val;
+  set_ZN(A);
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::CMP(const uint8_t val) { compare(A, val); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::CPX(const uint8_t val) { compare(X, val); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::CPY(const uint8_t val) { compare(Y, val); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::EOR(const uint8_t val) {
+  A ^= val;
+  set_ZN(A);
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::LDA(const uint8_t val) {
+  A = val;
+  set_ZN(A);
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::LDX(const uint8_t val) {
+  X = val;
+  set_ZN(X);
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::LDY(const uint8_t val) {
+  Y = val;
+  set_ZN(Y);
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::ORA(const uint8_t val) {
+  A |= val;
+  set_ZN(A);
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::LAX(const uint8_t val) {
+  A = val;
+  X = val;
+  set_ZN(X);
+}
+
+template <typename Bus, bool CACHED>
+template <addressing_t MODE> void StepEngine<Bus, CACHED>::NOP() {
+  if constexpr (MODE == addressing_t::IMM) {
+    fetch();
+  } else if constexpr (MODE != addressing_t::IMP) {
+    // Like the cycle-accurate engine, the NOPs do not read the operand but
+    // still take the page crossing cycle, see opcode_t::page_penalty
+    address<MODE>();
+  }
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::branch(const bool taken) {
+  int8_t offset = static_cast<int8_t>(fetch());
+
+  if (taken) {
+    uint16_t target = PC + offset;
+    // One cycle if the branch is taken and one more if it crosses the page
+    penalty += ((target ^ PC) & 0xFF00) ? 2 : 1;
+    PC = target;
+  }
+}
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::BRK() {
+  PC++; // The byte after BRK is skipped
+
+  push((PC >> 8) & 0x00FF);
+  push(PC & 0x00FF);
+  push(status() | MOS6502::B); // Store P on stack with B flag set
+  set_flag(MOS6502::B, false);
+
+  uint8_t lo = read(BRK_PCL);
+  PC = ADDRESS(read(BRK_PCH), lo);
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::interrupt(const uint16_t vector) {
+  PC_executed = PC;
+  opcode = 0x00; // The hardware executes a BRK, the PC is not incremented
+
+  enter_interrupt(*this, vector);
+}
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::JAM() {
+  PC = PC_executed; // Locked up on the opcode, see MOS6502::halted
+  cpu.halted = true;
+  cpu.log("The cpu is halted by a JAM opcode");
+}
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::JSR() {
+  uint8_t lo = fetch();
+
+  // The pushed address is the one of the last byte of the instruction
+  push((PC >> 8) & 0x00FF);
+  push(PC & 0x00FF);
+
+  PC = ADDRESS(fetch(), lo);
+}
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::RTI() {
+  set_status(pull() | MOS6502::U);
+  uint8_t lo = pull();
+  PC = ADDRESS(pull(), lo);
+}
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::RTS() {
+  uint8_t lo = pull();
+  PC = ADDRESS(pull(), lo) + 1;
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::PHA() { push(A); }
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::PHP() {
+  push(status() | MOS6502::B);
+  set_flag(MOS6502::B, false);
+}
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::PLA() {
+  A = pull();
+  set_ZN(A);
+}
+
+template <typename Bus, bool CACHED> void StepEngine<Bus, CACHED>::PLP() {
+  set_status((pull() & ~MOS6502::B) | MOS6502::U);
+}
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::CLC() { set_flag(MOS6502::C, false); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::CLD() { set_flag(MOS6502::D, false); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::CLI() { set_flag(MOS6502::I, false); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::CLV() { set_flag(MOS6502::O, false); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::SEC() { set_flag(MOS6502::C, true); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::SED() { set_flag(MOS6502::D, true); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::SEI() { set_flag(MOS6502::I, true); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::DEX() { set_ZN(--X); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::DEY() { set_ZN(--Y); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::INX() { set_ZN(++X); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::INY() { set_ZN(++Y); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::TAX() { set_ZN(X = A); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::TAY() { set_ZN(Y = A); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::TSX() { set_ZN(X = S); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::TXA() { set_ZN(A = X); }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::TXS() { S = X; }
+
+template <typename Bus, bool CACHED>
+void StepEngine<Bus, CACHED>::TYA() { set_ZN(A = Y); }
+
+/********************************************************
+ *                  MOS6502 BUS VERSIONS                *
+ ********************************************************/
+// Cycle at which a run that starts now with 'budget' cycles has to stop
+inline uint64_t end_cycle(const uint64_t cycles, const uint64_t budget) {
+  return (budget > UINT64_MAX - cycles) ? UINT64_MAX : cycles + budget;
+}
+
+template <typename Bus, typename F>
+run_result_t MOS6502::run_engine(Bus &bus, const uint64_t budget, F run) {
+  if (halted) {
+    return {0, stop_reason_t::HALT, PC};
+  }
+
+  uint64_t start = cycles;
+  uint64_t ticks = profiling ? host_ticks() : 0;
+
+  complete_instruction();
+
+  // The engine runs up to the next event, then the events due are dispatched
+  // and the interrupts polled on the synced cpu, and it goes on. The
+  // interrupt sequence is the first instruction of the segment
+  const uint64_t end = end_cycle(start, budget);
+  stop_reason_t reason;
+  do {
+    dispatch_events();
+
+    const uint16_t vector = (cycles < end) ? poll_interrupts() : 0;
+    const uint64_t segment_end = std::min(end, scheduler.next());
+    auto segment = [&](auto &&engine) {
+      if (vector) {
+        engine.interrupt(vector);
+      }
+      reason = run(engine, segment_end);
+      engine.sync();
+    };
+
+    if (block_cache) {
+      segment(StepEngine<Bus, true>(*this, bus));
+    } else {
+      segment(StepEngine<Bus>(*this, bus));
+    }
+  } while (reason == stop_reason_t::CYCLES && cycles < end);
+
+  run_result_t res = {cycles - start, reason, PC};
+
+  if (profiling) {
+    profile.runs++;
+    profile.run_ticks += host_ticks() - ticks;
+    profile.run_cycles += res.cycles;
+  }
+
+  return res;
+}
+
+template <typename Bus> unsigned int MOS6502::step(Bus &bus) {
+  // A step is a run that stops at the first instruction boundary
+  return run(bus, 1).cycles;
+}
+
+template <typename Bus>
+run_result_t MOS6502::run(Bus &bus, const uint64_t budget) {
+  return run_engine(bus, budget, [](auto &engine, uint64_t end) {
+    return engine.run(end);
+  });
+}
+
+template <typename Bus>
+run_result_t MOS6502::run_until_pc(Bus &bus, const uint16_t pc,
+                                   const uint64_t budget) {
+  return run_engine(bus, budget, [pc](auto &engine, uint64_t end) {
+    return engine.run_until_pc(pc, end);
+  });
+}
+
+template <typename Bus>
+run_result_t MOS6502::run_until(Bus &bus, stop_predicate predicate,
+                                void *usr_data, const uint64_t budget) {
+  return run_engine(bus, budget, [=](auto &engine, uint64_t end) {
+    return engine.run_until(predicate, usr_data, end);
+  });
+}
+
+#undef FOR_EACH_FUSED_PAIR
+#undef FOR_EACH_OPCODE
+#undef OPCODE_ROW
+#undef ADDRESS
+
+extern template class StepEngine<PageTableBus>;
+extern template class StepEngine<PageTableBus, true>;
@@ -0,0 +1,582 @@
+#include "jit.hpp"
+#include <string.h>
+
+#if JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+// x86-64 registers, by encoding
+enum {
+  RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// Register allocation of the native code. rdi is the jit_state_t, rax, rcx
+// and rdx are scratch
+#define REG_A R8
+#define REG_X R9
+#define REG_Y R10
+#define REG_ZN R11
+#define REG_CARRY R12
+#define REG_OVERFLOW R13
+#define REG_CYCLES R14
+#define REG_PAGES R15 // jit_state_t::pages
+#define REG_CODE RSI  // jit_state_t::code_pages
+#define REG_DIRTY RBX // jit_state_t::dirty_pages, with the dirty tracking
+
+// Condition codes of Jcc and SETcc
+#define CC_O 0x0
+#define CC_C 0x2
+#define CC_NC 0x3
+#define CC_Z 0x4
+#define CC_NZ 0x5
+
+#define STATE(field) static_cast<int32_t>(offsetof(jit_state_t, field))
+
+#if JIT_SUPPORTED
+Jit::Jit() : used(0), cursor(nullptr), jumps_len(0) {
+  void *mem = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  buffer = mem == MAP_FAILED ? nullptr : static_cast<uint8_t *>(mem);
+}
+
+Jit::~Jit() {
+  if (buffer) {
+    munmap(buffer, JIT_CODE_SIZE);
+  }
+}
+#else
+Jit::Jit() : buffer(nullptr), used(0), cursor(nullptr), jumps_len(0) {}
+
+Jit::~Jit() {}
+#endif
+
+/********************************************************
+ *                       EMITTER                        *
+ ********************************************************/
+void Jit::byte(const uint8_t val) { *cursor++ = val; }
+
+void Jit::dword(const uint32_t val) {
+  memcpy(cursor, &val, sizeof(val));
+  cursor += sizeof(val);
+}
+
+void Jit::opcode(const uint16_t op) {
+  if (op > 0xFF) {
+    byte(op >> 8);
+  }
+  byte(op & 0xFF);
+}
+
+void Jit::rex(const bool w, const int reg, const int index, const int base) {
+  // Always emitted, so the byte registers are al, cl, dl, bl and r8b-r15b
+  byte(0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) |
+       (base >> 3));
+}
+
+void Jit::rr(const uint16_t op, const bool w, const int reg, const int rm) {
+  rex(w, reg, 0, rm);
+  opcode(op);
+  byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void Jit::mem(const uint16_t op, const bool w, const int reg, const int base,
+              const int index, const int32_t disp) {
+  rex(w, reg, index < 0 ? 0 : index, base);
+  opcode(op);
+
+  if (index < 0 && (base & 7) != RSP) {
+    byte(0x80 | ((reg & 7) << 3) | (base & 7));
+  } else {
+    // SIB byte, index 100 is no index
+    byte(0x80 | ((reg & 7) << 3) | RSP);
+    byte((((index < 0) ? RSP : index) & 7) << 3 | (base & 7));
+  }
+
+  dword(disp);
+}
+
+void Jit::mov_imm(const int reg, const uint32_t imm) {
+  rex(false, 0, 0, reg);
+  byte(0xB8 + (reg & 7));
+  dword(imm);
+}
+
+void Jit::push(const int reg) {
+  rex(false, 0, 0, reg);
+  byte(0x50 + (reg & 7));
+}
+
+void Jit::pop(const int reg) {
+  rex(false, 0, 0, reg);
+  byte(0x58 + (reg & 7));
+}
+
+void Jit::jump_exit(const uint8_t cc, const unsigned int exit) {
+  byte(0x0F);
+  byte(0x80 | cc);
+  jumps[jumps_len++] = {cursor, exit};
+  dword(0);
+}
+
+/********************************************************
+ *                     TRANSLATION                      *
+ ********************************************************/
+bool Jit::supported(const uint8_t op) {
+  using A = addressing_t;
+  using O = operation_t;
+  const opcode_t &info = opcode_table[op];
+
+  if (info.name[0] == '*' || info.name[0] == '?') { // Unofficial
+    return false;
+  }
+
+  switch (info.addressing) {
+  case A::IMP: case A::ACC: case A::IMM: case A::ZPI: case A::ZPX:
+  case A::ZPY: case A::ABS: case A::ABX: case A::ABY:
+    break;
+
+  default:
+    return false;
+  }
+
+  switch (info.operation) {
+  case O::LDA: case O::LDX: case O::LDY: case O::STA: case O::STX:
+  case O::STY: case O::ADC: case O::SBC: case O::AND: case O::ORA:
+  case O::EOR: case O::CMP: case O::CPX: case O::CPY: case O::BIT:
+  case O::ASL: case O::LSR: case O::ROL: case O::ROR: case O::INC:
+  case O::DEC: case O::INX: case O::INY: case O::DEX: case O::DEY:
+  case O::TAX: case O::TAY: case O::TXA: case O::TYA: case O::TSX:
+  case O::TXS: case O::CLC: case O::SEC: case O::CLV: case O::NOP:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+void Jit::page_access(const decoded_instruction_t &instruction,
+                      const access_t access, const unsigned int exit) {
+  using A = addressing_t;
+  const opcode_t &info = opcode_table[instruction.opcode];
+  const int32_t pointer = access == access_t::READ ? 0 : sizeof(uint8_t *);
+  const int index = (info.addressing == A::ZPY || info.addressing == A::ABY)
+                        ? REG_Y
+                        : REG_X;
+  int page = -1; // The page, if known now
+
+  switch (info.addressing) {
+  case A::ZPI:
+    page = 0;
+    mov_imm(RDX, instruction.args[0]);
+    break;
+
+  case A::ABS:
+    page = instruction.args[1];
+    mov_imm(RDX, instruction.args[0]);
+    break;
+
+  case A::ZPX:
+  case A::ZPY:
+    // No page crossing, the carry is discarded
+    page = 0;
+    rr(0x0FB6, false, RDX, index); // movzx edx, index
+    rr(0x80, false, 0, RDX);       // add dl, lo
+    byte(instruction.args[0]);
+    break;
+
+  default: // ABX and ABY
+    rr(0x0FB6, false, RDX, index); // movzx edx, index
+    rr(0x81, false, 0, RDX);       // add edx, base
+    dword(instruction.args[0] | (instruction.args[1] << 8));
+    rr(0x81, false, 4, RDX); // and edx, 0xFFFF
+    dword(0xFFFF);
+    rr(0x89, false, RDX, RCX); // mov ecx, edx
+    rr(0xC1, false, 5, RCX);   // shr ecx, 8
+    byte(8);
+    rr(0x0FB6, false, RDX, RDX); // movzx edx, dl
+    break;
+  }
+
+  if (page >= 0) {
+    if (access != access_t::READ) { // cmp byte [code + page], 0
+      mem(0x80, false, 7, REG_CODE, -1, page);
+      byte(0);
+      jump_exit(CC_NZ, exit);
+    }
+
+    // mov rax, [pages + page * 16 + pointer]
+    mem(0x8B, true, RAX, REG_PAGES, -1, page * sizeof(mem_page_t) + pointer);
+    rr(0x85, true, RAX, RAX); // test rax, rax
+    jump_exit(CC_Z, exit);
+
+    if (access == access_t::RMW) { // cmp rax, [pages + page * 16]
+      mem(0x3B, true, RAX, REG_PAGES, -1, page * sizeof(mem_page_t));
+      jump_exit(CC_NZ, exit);
+    }
+  } else {
+    if (access != access_t::READ) { // cmp byte [code + rcx], 0
+      mem(0x80, false, 7, REG_CODE, RCX, 0);
+      byte(0);
+      jump_exit(CC_NZ, exit);
+    }
+
+    static_assert(sizeof(mem_page_t) == 16, "The page index is shifted by 4");
+    rr(0xC1, false, 4, RCX); // shl ecx, 4
+    byte(4);
+    mem(0x8B, true, RAX, REG_PAGES, RCX, pointer); // mov rax, [pages + rcx]
+    rr(0x85, true, RAX, RAX);                      // test rax, rax
+    jump_exit(CC_Z, exit);
+
+    if (access == access_t::RMW) { // cmp rax, [pages + rcx]
+      mem(0x3B, true, RAX, REG_PAGES, RCX, 0);
+      jump_exit(CC_NZ, exit);
+    }
+  }
+
+  // The write can not exit anymore, mark its page
+  if (access != access_t::READ && dirty_tracking) {
+    if (page >= 0) { // or byte [dirty + page / 8], 1 << page % 8
+      mem(0x80, false, 1, REG_DIRTY, -1, page >> 3);
+      byte(1 << (page & 7));
+    } else {
+      rr(0xC1, false, 5, RCX); // shr ecx, 4
+      byte(4);
+      mem(0x0FAB, false, RCX, REG_DIRTY, -1, 0); // bts [dirty], ecx
+    }
+  }
+}
+
+void Jit::set_ZN(const int reg) {
+  rr(0x0FB6, false, REG_ZN, reg); // movzx ZN, reg
+}
+
+void Jit::translate(const decoded_instruction_t &instruction,
+                    const unsigned int exit) {
+  using A = addressing_t;
+  using O = operation_t;
+  const opcode_t &info = opcode_table[instruction.opcode];
+
+  // Register of the loads, stores, compares, increments and transfers
+  int reg = REG_A;
+  switch (info.operation) {
+  case O::LDX: case O::STX: case O::CPX: case O::INX: case O::DEX:
+  case O::TXA: case O::TXS:
+    reg = REG_X;
+    break;
+
+  case O::LDY: case O::STY: case O::CPY: case O::INY: case O::DEY:
+  case O::TYA:
+    reg = REG_Y;
+    break;
+
+  default:
+    break;
+  }
+
+  // The operand of the read instructions goes in cl
+  if (info.access == access_t::READ) {
+    if (info.addressing == A::IMM) {
+      mov_imm(RCX, instruction.args[0]);
+    } else {
+      page_access(instruction, access_t::READ, exit);
+      mem(0x0FB6, false, RCX, RAX, RDX, 0); // movzx ecx, byte [rax + rdx]
+    }
+  } else if (info.access == access_t::RMW && info.addressing != A::ACC) {
+    page_access(instruction, access_t::RMW, exit);
+    mem(0x0FB6, false, RCX, RAX, RDX, 0); // movzx ecx, byte [rax + rdx]
+  } else if (info.access == access_t::WRITE) {
+    page_access(instruction, access_t::WRITE, exit);
+  }
+
+  // Target of the Read-Modify-Write operations
+  const int target = info.addressing == A::ACC ? REG_A : RCX;
+
+  switch (info.operation) {
+  case O::LDA:
+  case O::LDX:
+  case O::LDY:
+    rr(0x88, false, RCX, reg); // mov reg, cl
+    set_ZN(reg);
+    break;
+
+  case O::STA:
+  case O::STX:
+  case O::STY:
+    mem(0x88, false, reg, RAX, RDX, 0); // mov [rax + rdx], reg
+    break;
+
+  case O::SBC: // A + ~M + C
+    rr(0xF6, false, 2, RCX); // not cl
+    [[fallthrough]];
+  case O::ADC:
+    rr(0x80, false, 0, REG_CARRY); // add carry, 0xFF sets CF from the carry
+    byte(0xFF);
+    rr(0x10, false, RCX, REG_A);         // adc A, cl
+    rr(0x0F90 | CC_C, false, 0, REG_CARRY);    // setc carry
+    rr(0x0F90 | CC_O, false, 0, REG_OVERFLOW); // seto overflow
+    set_ZN(REG_A);
+    break;
+
+  case O::AND:
+  case O::ORA:
+  case O::EOR: {
+    const uint8_t op = info.operation == O::AND   ? 0x20
+                       : info.operation == O::ORA ? 0x08
+                                                  : 0x30;
+    rr(op, false, RCX, REG_A); // and/or/xor A, cl
+    set_ZN(REG_A);
+    break;
+  }
+
+  case O::CMP:
+  case O::CPX:
+  case O::CPY:
+    rr(0x38, false, RCX, reg);               // cmp reg, cl
+    rr(0x0F90 | CC_NC, false, 0, REG_CARRY); // setae carry
+    rr(0x0FB6, false, RAX, reg);             // movzx eax, reg
+    rr(0x28, false, RCX, RAX);               // sub al, cl
+    set_ZN(RAX);
+    break;
+
+  case O::BIT:
+    // Z from A & M, N from M, see StepEngine::BIT()
+    rr(0x0FB6, false, RAX, RCX); // movzx eax, cl
+    rr(0x20, false, REG_A, RAX); // and al, A
+    rr(0x0FB6, false, RDX, RCX); // movzx edx, cl
+    rr(0x81, false, 4, RDX);     // and edx, 0x80
+    dword(0x80);
+    rr(0xD1, false, 4, RDX);      // shl edx, 1
+    rr(0x09, false, RDX, RAX);    // or eax, edx
+    rr(0x89, false, RAX, REG_ZN); // mov ZN, eax
+    rr(0x0FB6, false, REG_OVERFLOW, RCX); // movzx overflow, cl
+    rr(0xC1, false, 5, REG_OVERFLOW);     // shr overflow, 6
+    byte(6);
+    rr(0x83, false, 4, REG_OVERFLOW); // and overflow, 1
+    byte(1);
+    break;
+
+  case O::ASL:
+  case O::LSR:
+  case O::ROL:
+  case O::ROR: {
+    // Shift by one, the carry goes through CF
+    const int digit = info.operation == O::ASL   ? 4
+                      : info.operation == O::LSR ? 5
+                      : info.operation == O::ROL ? 2
+                                                 : 3;
+    if (info.operation == O::ROL || info.operation == O::ROR) {
+      rr(0x80, false, 0, REG_CARRY); // add carry, 0xFF
+      byte(0xFF);
+    }
+    rr(0xD0, false, digit, target);         // shl/shr/rcl/rcr target, 1
+    rr(0x0F90 | CC_C, false, 0, REG_CARRY); // setc carry
+    set_ZN(target);
+    break;
+  }
+
+  case O::INC:
+  case O::DEC:
+    rr(0xFE, false, info.operation == O::INC ? 0 : 1, target); // inc/dec
+    set_ZN(target);
+    break;
+
+  case O::INX:
+  case O::INY:
+    rr(0xFE, false, 0, reg); // inc reg
+    set_ZN(reg);
+    break;
+
+  case O::DEX:
+  case O::DEY:
+    rr(0xFE, false, 1, reg); // dec reg
+    set_ZN(reg);
+    break;
+
+  case O::TAX:
+    rr(0x88, false, REG_A, REG_X); // mov X, A
+    set_ZN(REG_X);
+    break;
+
+  case O::TAY:
+    rr(0x88, false, REG_A, REG_Y); // mov Y, A
+    set_ZN(REG_Y);
+    break;
+
+  case O::TXA:
+  case O::TYA:
+    rr(0x88, false, reg, REG_A); // mov A, reg
+    set_ZN(REG_A);
+    break;
+
+  case O::TSX:
+    mem(0x0FB6, false, REG_X, RDI, -1, STATE(S)); // movzx X, [state.S]
+    set_ZN(REG_X);
+    break;
+
+  case O::TXS:
+    mem(0x88, false, REG_X, RDI, -1, STATE(S)); // mov [state.S], X
+    break;
+
+  case O::CLC:
+    rr(0x31, false, REG_CARRY, REG_CARRY); // xor carry, carry
+    break;
+
+  case O::SEC:
+    mov_imm(REG_CARRY, 1);
+    break;
+
+  case O::CLV:
+    rr(0x31, false, REG_OVERFLOW, REG_OVERFLOW); // xor overflow, overflow
+    break;
+
+  default: // NOP
+    break;
+  }
+
+  if (info.access == access_t::RMW && info.addressing != A::ACC) {
+    mem(0x88, false, RCX, RAX, RDX, 0); // mov [rax + rdx], cl
+  }
+
+  // The cycles after the last exit of the instruction
+  rr(0x83, true, 0, REG_CYCLES); // add cycles, base cycles
+  byte(info.cycles);
+
+  if (info.page_penalty) {
+    const int index = info.addressing == A::ABY ? REG_Y : REG_X;
+
+    // One more cycle if the low byte of the address overflows
+    rr(0x0FB6, false, RDX, index); // movzx edx, index
+    rr(0x81, false, 0, RDX);       // add edx, lo
+    dword(instruction.args[0]);
+    rr(0xC1, false, 5, RDX); // shr edx, 8
+    byte(8);
+    rr(0x01, true, RDX, REG_CYCLES); // add cycles, rdx
+  }
+}
+
+bool Jit::set_dirty_tracking(const bool enable) {
+  if (dirty_tracking == enable) {
+    return false;
+  }
+
+  dirty_tracking = enable;
+  return true;
+}
+
+void Jit::compile(BlockCache &cache, code_block_t &block) {
+  block.translated = true;
+
+  unsigned int length = 0;
+  unsigned int cycles = 0;
+
+  while (length < block.length &&
+         supported(block.instructions[length].opcode)) {
+    const opcode_t &info = opcode_table[block.instructions[length].opcode];
+    cycles += info.cycles + (info.page_penalty ? 1 : 0);
+    length++;
+  }
+
+  if (length == 0 || !buffer) {
+    return;
+  }
+
+  if (used + JIT_MAX_BLOCK_SIZE > JIT_CODE_SIZE) {
+    cache.drop_native(); // Also the current block, translated again now
+    block.translated = true;
+    used = 0;
+  }
+
+  uint8_t *start = buffer + used;
+  cursor = start;
+  jumps_len = 0;
+
+  // Prologue, load the registers from the state
+  push(R12);
+  push(R13);
+  push(R14);
+  push(R15);
+  if (dirty_tracking) {
+    push(REG_DIRTY);
+    mem(0x8B, true, REG_DIRTY, RDI, -1, STATE(dirty_pages));
+  }
+  mem(0x0FB6, false, REG_A, RDI, -1, STATE(A));
+  mem(0x0FB6, false, REG_X, RDI, -1, STATE(X));
+  mem(0x0FB6, false, REG_Y, RDI, -1, STATE(Y));
+  mem(0x0FB6, false, REG_CARRY, RDI, -1, STATE(carry));
+  mem(0x0FB6, false, REG_OVERFLOW, RDI, -1, STATE(overflow));
+  mem(0x8B, false, REG_ZN, RDI, -1, STATE(ZN));
+  mem(0x8B, true, REG_CYCLES, RDI, -1, STATE(cycles));
+  mem(0x8B, true, REG_PAGES, RDI, -1, STATE(pages));
+  mem(0x8B, true, REG_CODE, RDI, -1, STATE(code_pages));
+
+  // The instructions, then the normal exit after the last one
+  uint16_t pcs[BLOCK_MAX_INSTRUCTIONS + 1];
+  pcs[0] = block.pc;
+
+  for (unsigned int i = 0; i < length; i++) {
+    const decoded_instruction_t &instruction = block.instructions[i];
+
+    translate(instruction, i);
+    pcs[i + 1] = pcs[i] + opcode_table[instruction.opcode].instruction_bytes;
+  }
+
+  mov_imm(RAX, length);
+  mov_imm(RDX, pcs[length]);
+  byte(0xE9); // jmp epilogue
+  uint8_t *to_epilogue = cursor;
+  dword(0);
+
+  // Exits before the instructions: the interpreter executes them
+  uint8_t *exits[BLOCK_MAX_INSTRUCTIONS] = {};
+  uint8_t *exit_jumps[BLOCK_MAX_INSTRUCTIONS] = {};
+  for (unsigned int i = 0; i < jumps_len; i++) {
+    const exit_jump_t &jump = jumps[i];
+
+    if (!exits[jump.exit]) {
+      exits[jump.exit] = cursor;
+      mov_imm(RAX, jump.exit);
+      mov_imm(RDX, pcs[jump.exit]);
+      byte(0xE9); // jmp epilogue, fixed below
+      exit_jumps[jump.exit] = cursor;
+      dword(0);
+    }
+
+    int32_t rel = exits[jump.exit] - (jump.rel + 4);
+    memcpy(jump.rel, &rel, sizeof(rel));
+  }
+
+  // Epilogue, store the registers back. eax is the executed instructions,
+  // edx the PC
+  uint8_t *epilogue = cursor;
+  mem(0x88, false, REG_A, RDI, -1, STATE(A));
+  mem(0x88, false, REG_X, RDI, -1, STATE(X));
+  mem(0x88, false, REG_Y, RDI, -1, STATE(Y));
+  mem(0x88, false, REG_CARRY, RDI, -1, STATE(carry));
+  mem(0x88, false, REG_OVERFLOW, RDI, -1, STATE(overflow));
+  mem(0x89, false, REG_ZN, RDI, -1, STATE(ZN));
+  mem(0x89, false, RDX, RDI, -1, STATE(PC));
+  mem(0x89, true, REG_CYCLES, RDI, -1, STATE(cycles));
+  if (dirty_tracking) {
+    pop(REG_DIRTY);
+  }
+  pop(R15);
+  pop(R14);
+  pop(R13);
+  pop(R12);
+  byte(0xC3); // ret
+
+  int32_t rel = epilogue - (to_epilogue + 4);
+  memcpy(to_epilogue, &rel, sizeof(rel));
+
+  for (unsigned int i = 0; i < length; i++) {
+    if (exit_jumps[i]) {
+      rel = epilogue - (exit_jumps[i] + 4);
+      memcpy(exit_jumps[i], &rel, sizeof(rel));
+    }
+  }
+
+  used = cursor - buffer;
+  block.native = reinterpret_cast<native_block_t>(start);
+  block.native_cycles = cycles;
+}
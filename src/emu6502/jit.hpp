@@ -0,0 +1,117 @@
+#pragma once
+#include "block_cache.hpp"
+#include "bus.hpp"
+#include <stddef.h>
+#include <stdint.h>
+
+// The native code is generated only on x86-64 Linux, elsewhere the JIT is
+// never available and the engine stays on the block cache
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+#define JIT_HOT_THRESHOLD 32                // Block entries before translation
+#define JIT_CODE_SIZE (4 * 1024 * 1024)     // Native code buffer
+#define JIT_MAX_BLOCK_SIZE (8 * 1024)       // Native code of one block, at most
+
+// Registers exchanged between the instruction level engine and the native
+// code. The flags are the lazy ones of the engine, see StepEngine
+struct jit_state_t {
+  uint8_t A;
+  uint8_t X;
+  uint8_t Y;
+  uint8_t S;
+  uint8_t carry;
+  uint8_t overflow;
+  uint32_t ZN;
+  uint32_t PC;
+  uint64_t cycles;
+
+  const mem_page_t *pages; // Page table of the memory, see PageTableBus
+  const bool *code_pages;  // Pages with cached code, see BlockCache
+  uint64_t *dirty_pages;   // See MOS6502::set_dirty_tracking()
+};
+
+// Dynamic recompiler of the hot blocks of the block cache into x86-64 code.
+//
+// A block is translated after JIT_HOT_THRESHOLD entries. The native code
+// covers the leading instructions of the block that the JIT supports (loads,
+// stores, ALU, shifts, increments, transfers and flag instructions with the
+// implied, immediate, zero page and absolute addressing), the rest of the
+// block (at least its last instruction, the one that changes the flow) is
+// left to the interpreter. A/X/Y, the flags and the cycles counter stay in
+// host registers for the whole native code.
+//
+// The memory is accessed through the page table. The native code leaves to
+// the interpreter, before any side effect, the instructions that access a
+// page without host memory (memory mapped devices) or that write a page with
+// cached code (self-modifying code), so the interpreter sees all the
+// callbacks and all the code writes. With the dirty-page tracking the native
+// writes mark their page too.
+class Jit {
+public:
+  Jit();
+  ~Jit();
+
+  // The native code buffer is allocated, false if the host does not support
+  // the JIT
+  bool available() const { return buffer != nullptr; }
+
+  // Translate 'block', set its native code (nullptr if no instruction is
+  // supported). When the buffer is full the native code of all the blocks of
+  // 'cache' is dropped
+  void compile(BlockCache &cache, code_block_t &block);
+
+  // Translate the writes with or without the marking of the dirty pages.
+  // Return true if it changed: the native code already translated must be
+  // dropped, see BlockCache::drop_native()
+  bool set_dirty_tracking(const bool enable);
+
+private:
+  uint8_t *buffer; // JIT_CODE_SIZE bytes of executable memory
+  size_t used;     // Bytes of 'buffer' already used
+  uint8_t *cursor; // Next byte of the native code being emitted
+  bool dirty_tracking = false; // The writes mark jit_state_t::dirty_pages
+
+  // Jumps to the exit of an instruction, patched when the exits are emitted
+  struct exit_jump_t {
+    uint8_t *rel;      // 32-bit displacement of the jump
+    unsigned int exit; // Index of the instruction
+  };
+  exit_jump_t jumps[BLOCK_MAX_INSTRUCTIONS * 8];
+  unsigned int jumps_len;
+
+  /********************************************************
+   *                       EMITTER                        *
+   ********************************************************/
+  void byte(const uint8_t val);
+  void dword(const uint32_t val);
+  void opcode(const uint16_t op); // One or two (0x0F prefixed) bytes
+  void rex(const bool w, const int reg, const int index, const int base);
+
+  // Instruction with register operands (mod 11)
+  void rr(const uint16_t op, const bool w, const int reg, const int rm);
+  // Instruction with the memory operand [base + index + disp]. No index if
+  // 'index' is negative
+  void mem(const uint16_t op, const bool w, const int reg, const int base,
+           const int index, const int32_t disp);
+  void mov_imm(const int reg, const uint32_t imm);
+  void push(const int reg);
+  void pop(const int reg);
+  void jump_exit(const uint8_t cc, const unsigned int exit); // Jcc to exit
+
+  /********************************************************
+   *                     TRANSLATION                      *
+   ********************************************************/
+  static bool supported(const uint8_t op);
+
+  // Leave in rax the host page and in rdx the offset of the operand, exit
+  // before the instruction if the page can not be accessed directly
+  void page_access(const decoded_instruction_t &instruction,
+                   const access_t access, const unsigned int exit);
+  void set_ZN(const int reg);
+  void translate(const decoded_instruction_t &instruction,
+                 const unsigned int exit);
+};
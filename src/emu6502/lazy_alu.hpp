@@ -0,0 +1,137 @@
+#pragma once
+#include "mos6502.hpp"
+
+// The instruction execution must be inlined in the run loops, so the registers
+// copy never leaves the stack frame and can live in host registers
+#define ENGINE_INLINE inline __attribute__((always_inline))
+
+// Registers and ALU with the lazy flags, shared by the instruction level
+// engine (StepEngine) and the recompiled code (RecompiledCpu), which keep a
+// local copy of the registers of the cpu.
+//
+// The flags are evaluated lazily: N and Z are kept as the last result that
+// set them and C and O as booleans, the P register is composed only when it
+// is observed (status()). The native code of the JIT uses the same layout,
+// see jit_state_t.
+class LazyAlu {
+public:
+  uint8_t A;
+  uint8_t X;
+  uint8_t Y;
+  uint8_t S;
+  uint8_t P; // The N, O, Z and C bits are not valid, see status()
+  uint16_t PC;
+  uint64_t cycles;
+
+  // Lazy flags. Z is set if the low byte of ZN is 0, N if bit 7 or bit 8 of ZN
+  // is set. Bit 8 allows to have N and Z set together (BIT, PLP)
+  uint16_t ZN;
+  bool carry;
+  bool overflow;
+
+  ENGINE_INLINE void set_ZN(const uint8_t val) { ZN = val; }
+  ENGINE_INLINE bool zero() const { return (ZN & 0x00FF) == 0x00; }
+  ENGINE_INLINE bool negative() const { return ZN & 0x0180; }
+
+  uint8_t status() const;             // Compose the P register
+  void set_status(const uint8_t val); // Load the P register
+
+  // Operations with an operand
+  ENGINE_INLINE void adc(const uint8_t val) {
+    // add is done in 16bit mode to catch the carry bit
+    uint16_t tmp = static_cast<uint16_t>(A) + val + (carry ? 1 : 0);
+
+    carry = tmp > 0x00FF;
+    overflow = ~(A ^ val) & (A ^ tmp) & 0x0080;
+    A = tmp & 0x00FF;
+    set_ZN(A);
+  }
+  // A - M - (1 - C) is the same as A + ~M + C
+  ENGINE_INLINE void sbc(const uint8_t val) { adc(val ^ 0xFF); }
+  ENGINE_INLINE void bit(const uint8_t val) {
+    // Z from A & val but N from val, see ZN
+    ZN = (A & val) | ((val & (1 << 7)) << 1);
+    overflow = val & (1 << 6);
+  }
+  ENGINE_INLINE void compare(const uint8_t reg, const uint8_t val) {
+    carry = reg >= val;
+    set_ZN(reg - val);
+  }
+
+  // Read-Modify-Write operations, take the old value and return the new one
+  ENGINE_INLINE uint8_t asl(uint8_t val) {
+    carry = val & 0x80;
+    set_ZN(val <<= 1);
+    return val;
+  }
+  ENGINE_INLINE uint8_t lsr(uint8_t val) {
+    carry = val & 0x01;
+    set_ZN(val >>= 1);
+    return val;
+  }
+  ENGINE_INLINE uint8_t rol(uint8_t val) {
+    uint8_t carry_in = carry ? 0x01 : 0x00;
+    carry = val & 0x80;
+    set_ZN(val = (val << 1) | carry_in);
+    return val;
+  }
+  ENGINE_INLINE uint8_t ror(uint8_t val) {
+    uint8_t carry_in = carry ? 0x80 : 0x00;
+    carry = val & 0x01;
+    set_ZN(val = (val >> 1) | carry_in);
+    return val;
+  }
+  ENGINE_INLINE uint8_t inc(uint8_t val) {
+    set_ZN(++val);
+    return val;
+  }
+  ENGINE_INLINE uint8_t dec(uint8_t val) {
+    set_ZN(--val);
+    return val;
+  }
+
+  // Interrupt sequence of the vector at 'vector' (BRK_PCL or NMI_PCL) as an
+  // instruction of 7 cycles: push PC and P (B clear), set I and jump.
+  // 'engine' is the derived object, it provides push() and read()
+  template <typename Engine>
+  ENGINE_INLINE void enter_interrupt(Engine &engine, const uint16_t vector) {
+    engine.push((PC >> 8) & 0x00FF);
+    engine.push(PC & 0x00FF);
+    engine.push((status() & ~MOS6502::B) | MOS6502::U);
+    P |= MOS6502::I;
+
+    uint8_t lo = engine.read(vector);
+    PC = (engine.read(vector + 1) << 8) | lo;
+    cycles += 7;
+  }
+};
+
+inline uint8_t LazyAlu::status() const {
+  uint8_t val = P & ~(MOS6502::N | MOS6502::O | MOS6502::Z | MOS6502::C);
+
+  if (negative()) {
+    val |= MOS6502::N;
+  }
+
+  if (overflow) {
+    val |= MOS6502::O;
+  }
+
+  if (zero()) {
+    val |= MOS6502::Z;
+  }
+
+  if (carry) {
+    val |= MOS6502::C;
+  }
+
+  return val;
+}
+
+inline void LazyAlu::set_status(const uint8_t val) {
+  P = val;
+  ZN = ((val & MOS6502::Z) ? 0x0000 : 0x0001) |
+       ((val & MOS6502::N) ? 0x0100 : 0x0000);
+  carry = val & MOS6502::C;
+  overflow = val & MOS6502::O;
+}
@@ -1,8 +1,8 @@
 #include "mos6502.hpp"
+#include "engine.hpp"
+#include "record.hpp"
 
-#define MICROCODE(code) microcode_q.enqueue(([](MOS6502 *cpu) -> void { code }))
-// #define MICROCODE_IN_FRONT(code) microcode_q.insert_in_front(([](MOS6502 *
-// cpu) -> void { code }))
+#define MICROCODE(code) ([](MOS6502 *cpu) -> void { code })
 #define ADDRESS(hi, lo)                                                        \
   (static_cast<uint16_t>((static_cast<uint16_t>(hi) << 8) | (lo)))
 // #define ADDRESS(hi, lo) (static_cast<uint16_t>(256U * hi + lo))
@@ -12,6 +12,28 @@
 MOS6502::MOS6502(mem_access_callback mem_acc_clb, void *usr_data)
     : mem_access(mem_acc_clb), user_data(usr_data) {}
 
+// Build at compile time the microcode of an addressing mode or operation
+static constexpr MOS6502::microcode_t
+microcode(std::initializer_list<MOS6502::micro_op_t> steps,
+          const bool own_addressing = false) {
+  MOS6502::microcode_t microcode = {};
+
+  for (MOS6502::micro_op_t step : steps) {
+    microcode.steps[microcode.length++] = step;
+  }
+
+  microcode.own_addressing = own_addressing;
+
+  return microcode;
+}
+
+// Microcode of the operations that do not use the addressing mode microcode
+// (e.g. JSR is different from normal abbsolute addressing mode)
+static constexpr MOS6502::microcode_t
+microcode_without_addressing(std::initializer_list<MOS6502::micro_op_t> steps) {
+  return microcode(steps, true);
+}
+
 void MOS6502::set_flag(const status_flag_t flag, const bool val) {
   if (val) {
     P |= flag;
@@ -22,12 +44,70 @@ void MOS6502::set_flag(const status_flag_t flag, const bool val) {
 
 bool MOS6502::read_flag(const status_flag_t flag) { return (P & flag); }
 
+void MOS6502::set_alu_flags(const uint8_t mask, const uint8_t flags) {
+  P = (P & ~mask) | flags;
+}
+
+void MOS6502::set_ZN(const uint8_t val) {
+  set_alu_flags(Z | N, nz_table[val]);
+}
+
+void MOS6502::add(const uint8_t val) {
+  // add is done in 16bit mode to catch the carry bit
+  const uint16_t tmp = static_cast<uint16_t>(A) + val + (P & C);
+  const uint8_t overflow = (~(A ^ val) & (A ^ tmp) & 0x0080) ? O : 0;
+
+  A = tmp & 0x00FF;
+  set_alu_flags(N | O | Z | C, nz_table[A] | overflow | (tmp >> 8));
+}
+
+void MOS6502::shift(const shift_table_t &table) {
+  const alu_result_t &res = table[P & C][data_bus];
+
+  tmp_buff = res.result;
+  set_alu_flags(N | Z | C, res.flags);
+}
+
+void MOS6502::bus_access(const uint16_t address, const access_mode_t read_write,
+                         uint8_t &data) {
+  const mem_page_t &page = page_table[address >> 8];
+
+  if (read_write == access_mode_t::READ && page.read) {
+    data = page.read[address & 0x00FF];
+  } else if (read_write == access_mode_t::WRITE && page.write) {
+    page.write[address & 0x00FF] = data;
+  } else {
+    // NOTE(max): intentionally not checking if function is nullptr
+    mem_access(user_data, address, read_write, data);
+  }
+
+  if (read_write == access_mode_t::WRITE) {
+    if (dirty_tracking) {
+      mark_dirty(dirty_pages.data(), address);
+    }
+
+    if (block_cache) {
+      block_cache->write(address);
+    }
+  }
+}
+
 void MOS6502::mem_read() {
   if (accumulator_addressing) {
     data_bus = A;
   } else {
-    // NOTE(max): intentionally not checking if function is nullptr
-    mem_access(user_data, address_bus, access_mode_t::READ, data_bus);
+    bus_access(address_bus, access_mode_t::READ, data_bus);
+
+    // Keep the operands of the current instruction for the trace, taken from
+    // the operand fetches of the addressing microcode
+    switch (static_cast<uint16_t>(address_bus - PC_executed)) {
+    case 1:
+      arg1 = data_bus;
+      break;
+    case 2:
+      arg2 = data_bus;
+      break;
+    }
   }
 }
 
@@ -35,61 +115,71 @@ void MOS6502::mem_write() {
   if (accumulator_addressing) {
     A = data_bus;
   } else {
-    // NOTE(max): intentionally not checking if function is nullptr
-    mem_access(user_data, address_bus, access_mode_t::WRITE, data_bus);
+    bus_access(address_bus, access_mode_t::WRITE, data_bus);
   }
 }
 
 bool MOS6502::clock() {
-  timeval t1;
-  timeval t2;
-  gettimeofday(&t1, nullptr);
-
-  cycles++;
+  if (halted) {
+    return true;
+  }
 
-  if (microcode_q.is_empty()) { // Fetch and decode next instruction
-    accumulator_addressing = false;
-    address_bus = PC++;
-    mem_read();
-    opcode = data_bus;
-    instruction = &(opcode_table[opcode]);
+  if (cycles >= scheduler.next()) {
+    dispatch_events();
+  }
 
-    // TEST
-    PC_executed = address_bus;
+  cycles++;
 
-    if (instruction->instruction_bytes > 1) {
-      mem_access(user_data, PC_executed + 1, access_mode_t::READ, arg1);
+  if (microcode_step == microcode_len) { // Fetch and decode next instruction
+    if (profiling) {
+      instruction_ticks = host_ticks();
     }
 
-    if (instruction->instruction_bytes > 2) {
-      mem_access(user_data, PC_executed + 2, access_mode_t::READ, arg2);
-    } // TEST END
+    accumulator_addressing = false;
+    PC_executed = PC;
+
+    const uint16_t vector = poll_interrupts();
+    if (vector) {
+      // The opcode is read and discarded, the PC is not incremented and the
+      // hardware executes a BRK
+      address_bus = PC;
+      mem_read();
+      opcode = 0x00;
+      instruction = (vector == NMI_PCL) ? &nmi_instruction : &irq_instruction;
+    } else {
+      address_bus = PC++;
+      mem_read();
+      opcode = data_bus;
+      instruction = &(instruction_table[opcode]);
+    }
 
-    (this->*instruction->addrmode)();
-    (this->*instruction->operation)();
+    addrmode_len = instruction->operation->own_addressing
+                       ? 0
+                       : instruction->addrmode->length;
+    microcode_len = addrmode_len + instruction->operation->length;
+    microcode_step = 0;
 
+    if (instruction->operation == &XXX) {
+      log("Executed illegal opcode");
+    } else if (instruction->operation == &JAM) {
+      halt();
+    }
   } else { // Execute next microcode step
 
     // if we are in accumulator addressing mode we read from accumulator
     // and not from memory so all reads and writes can be executed now
     do {
-      micro_op_t micro_operation;
-
-      if (microcode_q.dequeue(micro_operation)) {
-        // Exec the microcode
-        micro_operation(this);
-      } else {
-        log("Error dequeueing nex microcode instruction");
-      }
-
-    } while (!microcode_q.is_empty() && accumulator_addressing);
+      exec_micro_op();
+    } while (microcode_step < microcode_len && accumulator_addressing);
   }
 
-  gettimeofday(&t2, nullptr);
-  time = time_diff(&t1, &t2);
-
   // TEST
-  if (microcode_q.is_empty()) {
+  if (microcode_step == microcode_len) {
+    if (profiling) {
+      profile.opcodes[opcode].count++;
+      profile.opcodes[opcode].ticks += host_ticks() - instruction_ticks;
+    }
+
     return true;
   }
 
@@ -97,7 +187,90 @@ bool MOS6502::clock() {
   // TEST END
 }
 
+void MOS6502::exec_micro_op() {
+  if (microcode_step == microcode_len) {
+    return;
+  }
+
+  // The addressing mode microcode is executed first, then the operation one
+  micro_op_t micro_operation =
+      (microcode_step < addrmode_len)
+          ? instruction->addrmode->steps[microcode_step]
+          : instruction->operation->steps[microcode_step - addrmode_len];
+
+  microcode_step++;
+  micro_operation(this);
+}
+
+void MOS6502::skip_microcode() { microcode_step = microcode_len; }
+
+PageTableBus MOS6502::page_table_bus() const {
+  // While recording every read of the devices goes in the stream
+  return PageTableBus(page_table.data(), mem_access, user_data,
+                      recorder ? nullptr : stable_reads.data());
+}
+
+unsigned int MOS6502::step() {
+  PageTableBus bus = page_table_bus();
+  return step(bus);
+}
+
+run_result_t MOS6502::run(const uint64_t budget) {
+  PageTableBus bus = page_table_bus();
+  return run(bus, budget);
+}
+
+run_result_t MOS6502::run_until_pc(const uint16_t pc, const uint64_t budget) {
+  PageTableBus bus = page_table_bus();
+  return run_until_pc(bus, pc, budget);
+}
+
+run_result_t MOS6502::run_until_cycle(const uint64_t cycle) {
+  return run(cycle > cycles ? cycle - cycles : 0);
+}
+
+run_result_t MOS6502::run_until(stop_predicate predicate, void *usr_data,
+                                const uint64_t budget) {
+  PageTableBus bus = page_table_bus();
+  return run_until(bus, predicate, usr_data, budget);
+}
+
+void MOS6502::halt() {
+  halted = true;
+  PC = PC_executed;
+  log("The cpu is halted by a JAM opcode");
+}
+
+void MOS6502::dispatch_events() {
+  scheduled_event_t event;
+  while (scheduler.pop(cycles, event)) {
+    event.callback(event.usr_data, event.cycle);
+  }
+}
+
+uint16_t MOS6502::poll_interrupts() {
+  const bool irq = (irq_line || irq_request) && !read_flag(I);
+  irq_request = false;
+
+  if (nmi_pending) {
+    nmi_pending = false;
+    return NMI_PCL;
+  }
+
+  return irq ? BRK_PCL : 0;
+}
+
+void MOS6502::complete_instruction() {
+  while (microcode_step != microcode_len) {
+    clock();
+  }
+}
+
 void MOS6502::reset() {
+  if (recorder) {
+    recorder->input(input_t::RESET);
+  }
+
   // Reset registers
   A = 0x00;
   X = 0x00;
@@ -119,69 +292,61 @@ void MOS6502::reset() {
   address_bus = 0x0000;
   data_bus = 0x00;
   accumulator_addressing = false;
+  halted = false;
+  nmi_pending = false;
+  irq_request = false;
   cycles = 7;
 }
 
-void MOS6502::irq() { // Read from 0xFFFE
-  if (read_flag(I) == false) {
-    // Push PC on the stack
-    // Write first the high because the stack decrease
-    address_bus = STACK_OFFSET + S--;
-    data_bus = (PC >> 8) & 0x00FF;
-    mem_write(); // write high byte
-
-    address_bus = STACK_OFFSET + S--;
-    data_bus = PC & 0x00FF;
-    mem_write(); // write low byte
-
-    // Push status on stack
-    set_flag(B, false);
-    set_flag(U, true);
-    set_flag(I, true);
-
-    data_bus = P;
-    address_bus = STACK_OFFSET + S--;
-    mem_write();
-
-    // Read new PC from the fixed location
-    address_bus = 0xFFFE;
-    mem_read();
-    tmp_buff = data_bus & 0x00FF;
-    address_bus++;
-    mem_read();
-    PC = (((uint16_t)data_bus) << 8) | tmp_buff;
+void MOS6502::irq() {
+  if (recorder) {
+    recorder->input(input_t::IRQ);
+  }
+
+  if (!halted) { // Only the reset restarts the cpu
+    irq_request = true;
   }
 }
 
-void MOS6502::nmi() { // Read from 0xFFFA
-  // Push PC on the stack
-  // Write first the high because the stack decrease
-  address_bus = STACK_OFFSET + S--;
-  data_bus = (PC >> 8) & 0x00FF;
-  mem_write(); // write high byte
+void MOS6502::nmi() {
+  if (recorder) {
+    recorder->input(input_t::NMI);
+  }
 
-  address_bus = STACK_OFFSET + S--;
-  data_bus = PC & 0x00FF;
-  mem_write(); // write low byte
+  if (!halted) {
+    nmi_pending = true;
+  }
+}
 
-  // Push status on stack
-  set_flag(B, false);
-  set_flag(U, true);
-  set_flag(I, true);
+void MOS6502::set_irq_line(const bool active) {
+  if (recorder) {
+    recorder->input(active ? input_t::IRQ_LINE_ON : input_t::IRQ_LINE_OFF);
+  }
 
-  data_bus = P;
-  address_bus = STACK_OFFSET + S--;
-  mem_write();
+  irq_line = active;
+}
 
-  // Read new PC from the fixed location
-  address_bus = 0xFFFA;
-  mem_read();
-  tmp_buff = data_bus & 0x00FF;
-  address_bus++;
-  mem_read();
-  PC = (((uint16_t)data_bus) << 8) | tmp_buff;
+void MOS6502::set_nmi_line(const bool active) {
+  if (recorder) {
+    recorder->input(active ? input_t::NMI_LINE_ON : input_t::NMI_LINE_OFF);
+  }
+
+  if (active && !nmi_line) {
+    nmi_pending = true;
+  }
+
+  nmi_line = active;
 }
 
+uint64_t MOS6502::schedule(const uint64_t cycle, event_callback callback,
+                           void *usr_data) {
+  return scheduler.add(cycle, callback, usr_data);
+}
+
+bool MOS6502::cancel_event(const uint64_t id) { return scheduler.cancel(id); }
+
+uint64_t MOS6502::next_event() const { return scheduler.next(); }
+
 p_state_t MOS6502::get_status() {
   return {A,
           X,
@@ -201,50 +366,142 @@ p_state_t MOS6502::get_status() {
           PC_executed,
           arg1,
           arg2,
-          cycles,
-          time};
+          cycles};
 }
 
 void MOS6502::set_PC(uint16_t address) { PC = address; }
 
-void MOS6502::set_log_callback(log_callback log_clb) { log_func = log_clb; }
+void MOS6502::map_memory(const uint8_t page, const unsigned int count,
+                         uint8_t *mem, const bool writable) {
+  if (page + count > page_table.size()) {
+    log("Can not map the pages beyond the end of the memory");
+    return;
+  }
 
-void MOS6502::log(const std::string &msg) {
-  if (log_func) {
-    log_func(msg);
+  for (unsigned int i = 0; i < count; i++) {
+    page_table[page + i].read = mem + i * 0x0100;
+    page_table[page + i].write = writable ? mem + i * 0x0100 : nullptr;
   }
+
+  invalidate_code(page, count);
 }
 
-bool MOS6502::is_read_instruction() {
-  auto current_op = instruction->operation;
+void MOS6502::unmap_memory(const uint8_t page, const unsigned int count) {
+  if (page + count > page_table.size()) {
+    log("Can not unmap the pages beyond the end of the memory");
+    return;
+  }
 
-  if (current_op == &MOS6502::LDA || current_op == &MOS6502::LDX ||
-      current_op == &MOS6502::LDY || current_op == &MOS6502::EOR ||
-      current_op == &MOS6502::AND || current_op == &MOS6502::ORA ||
-      current_op == &MOS6502::ADC || current_op == &MOS6502::SBC ||
-      current_op == &MOS6502::CMP || current_op == &MOS6502::BIT ||
-      current_op == &MOS6502::LAX || current_op == &MOS6502::NOP) {
+  for (unsigned int i = 0; i < count; i++) {
+    page_table[page + i] = {nullptr, nullptr};
+  }
 
+  invalidate_code(page, count);
+}
+
+void MOS6502::set_stable_reads(const uint8_t page, const unsigned int count,
+                               const uint64_t until) {
+  if (page + count > stable_reads.size()) {
+    log("Can not declare the pages beyond the end of the memory");
+    return;
+  }
+
+  for (unsigned int i = 0; i < count; i++) {
+    stable_reads[page + i] = until;
+  }
+}
+
+void MOS6502::set_block_cache(const bool enable) {
+  if (!enable) {
+    jit.reset(); // The JIT runs the blocks of the cache
+    block_cache.reset();
+  } else if (!block_cache) {
+    block_cache = std::make_unique<BlockCache>();
+  }
+}
+
+bool MOS6502::set_jit(const bool enable) {
+  if (!enable) {
+    if (block_cache) {
+      block_cache->drop_native();
+    }
+    jit.reset();
     return true;
   }
 
-  return false;
+  if (jit) {
+    return true;
+  }
+
+  std::unique_ptr<Jit> native = std::make_unique<Jit>();
+  if (!native->available()) {
+    log("The JIT is not supported on this host");
+    return false;
+  }
+
+  set_block_cache(true);
+  native->set_dirty_tracking(dirty_tracking);
+  jit = std::move(native);
+  return true;
+}
+
+void MOS6502::invalidate_code(const uint8_t page, const unsigned int count) {
+  if (block_cache) {
+    block_cache->invalidate(page, count);
+  }
+}
+
+void MOS6502::set_dirty_tracking(const bool enable) {
+  if (enable && !dirty_tracking) {
+    dirty_pages = {};
+  }
+
+  dirty_tracking = enable;
+
+  // The native code marks the pages only if translated with the tracking
+  if (jit && jit->set_dirty_tracking(enable)) {
+    block_cache->drop_native();
+  }
+}
+
+const std::array<uint64_t, 4> &MOS6502::get_dirty_pages() const {
+  return dirty_pages;
+}
+
+bool MOS6502::is_page_dirty(const uint8_t page) const {
+  return dirty_pages[page >> 6] & (1ull << (page & 63));
+}
+
+void MOS6502::clear_dirty_pages() { dirty_pages = {}; }
+
+void MOS6502::set_log_callback(log_callback log_clb) { log_func = log_clb; }
+
+void MOS6502::set_profiling(const bool enable) { profiling = enable; }
+
+const profile_t &MOS6502::get_profile() const { return profile; }
+
+void MOS6502::clear_profile() { profile = {}; }
+
+void MOS6502::log(const std::string &msg) const {
+  if (log_func) {
+    log_func(msg);
+  }
 }
 
 /********************************************************
  *                  ADDRESSING MODES                    *
  ********************************************************/
-void MOS6502::ACC() {
+const MOS6502::microcode_t MOS6502::ACC = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(
       cpu->address_bus = cpu->PC + 1; cpu->mem_read();
       // Make mem read and write not from memory but from accumulator register
-      cpu->accumulator_addressing = true;);
-}
+      cpu->accumulator_addressing = true;),
+});
 
-void MOS6502::IMM() {
+const MOS6502::microcode_t MOS6502::IMM = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // *INDENT-OFF*
@@ -252,69 +509,65 @@ void MOS6502::IMM() {
   MICROCODE(cpu->address_bus = cpu->PC++;
 
             // Esecute now the next insruction
-            if (!cpu->microcode_q.is_empty()) {
-              micro_op_t micro_operation;
-              cpu->microcode_q.dequeue(micro_operation);
-              micro_operation(cpu);
-            });
+            cpu->exec_micro_op();),
   // *INDENT-ON*
-}
+});
 
-void MOS6502::ABS() {
+const MOS6502::microcode_t MOS6502::ABS = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch low byte of address, increment PC
   MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
-            cpu->lo = cpu->data_bus; cpu->address_bus = cpu->PC++;);
+            cpu->lo = cpu->data_bus; cpu->address_bus = cpu->PC++;),
 
   // TICK(3): Fetch high byte of address, increment PC
   MICROCODE(cpu->mem_read();
-            cpu->address_bus = ADDRESS(cpu->data_bus, cpu->lo););
-}
+            cpu->address_bus = ADDRESS(cpu->data_bus, cpu->lo);),
+});
 
-void MOS6502::ZPI() {
+const MOS6502::microcode_t MOS6502::ZPI = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch address, increment PC
   MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
-            cpu->address_bus = cpu->data_bus & 0x00FF;);
-}
+            cpu->address_bus = cpu->data_bus & 0x00FF;),
+});
 
-void MOS6502::ZPX() {
+const MOS6502::microcode_t MOS6502::ZPX = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch address, increment PC
-  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();),
 
   // TICK(3): Read from address, add index register to it
   MICROCODE(cpu->address_bus = cpu->data_bus & 0x00FF; cpu->mem_read();
-            cpu->address_bus = (cpu->address_bus + cpu->X) & 0x00FF;);
-}
+            cpu->address_bus = (cpu->address_bus + cpu->X) & 0x00FF;),
+});
 
-void MOS6502::ZPY() {
+const MOS6502::microcode_t MOS6502::ZPY = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch address, increment PC
-  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();),
 
   // TICK(3): Read from address, add index register to it
   MICROCODE(cpu->address_bus = cpu->data_bus & 0x00FF; cpu->mem_read();
-            cpu->address_bus = (cpu->address_bus + cpu->Y) & 0x00FF;);
-}
+            cpu->address_bus = (cpu->address_bus + cpu->Y) & 0x00FF;),
+});
 
-void MOS6502::ABX() {
+const MOS6502::microcode_t MOS6502::ABX = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch low byte of address, increment PC
   MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
-            cpu->lo = cpu->data_bus;);
+            cpu->lo = cpu->data_bus;),
 
   // TICK(3): Fetch high byte of address, add index register to low address
   // byte, increment PC
   MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
             cpu->hi = cpu->data_bus; cpu->tmp_buff = cpu->lo + cpu->X;
 
-            cpu->lo = cpu->tmp_buff & 0x00FF;);
+            cpu->lo = cpu->tmp_buff & 0x00FF;),
 
   // *INDENT-OFF*
   // TICK(4): Read from effective address, fix the high byte of effective
@@ -326,7 +579,7 @@ void MOS6502::ABX() {
                                     cpu->mem_read();
                                     cpu->address_bus += 0x0100;
       } else {
-        if (cpu->is_read_instruction()) {
+        if (opcode_table[cpu->opcode].page_penalty) {
           /*                                  NOTE(max):
            *    Check page crossing: if no page boundary was crossed then the
            * address is correct and the re-read can be skiped in the Absolute
@@ -335,31 +588,27 @@ void MOS6502::ABX() {
            */
 
           // Exec immediately the next instruction
-          if (!cpu->microcode_q.is_empty()) {
-            micro_op_t micro_operation;
-            cpu->microcode_q.dequeue(micro_operation);
-            micro_operation(cpu);
-          }
+          cpu->exec_micro_op();
         } else {
           cpu->mem_read();
         }
-      });
+      }),
   // *INDENT-ON*
-}
+});
 
-void MOS6502::ABY() {
+const MOS6502::microcode_t MOS6502::ABY = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch low byte of address, increment PC
   MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
-            cpu->lo = cpu->data_bus;);
+            cpu->lo = cpu->data_bus;),
 
   // TICK(3): Fetch high byte of address, add index register to low address
   // byte, increment PC
   MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
             cpu->hi = cpu->data_bus; cpu->tmp_buff = cpu->lo + cpu->Y;
 
-            cpu->lo = cpu->tmp_buff & 0x00FF;);
+            cpu->lo = cpu->tmp_buff & 0x00FF;),
 
   // *INDENT-OFF*
   // TICK(4): Read from effective address, fix the high byte of effective
@@ -371,7 +620,7 @@ void MOS6502::ABY() {
                                     cpu->mem_read();
                                     cpu->address_bus += 0x0100;
       } else {
-        if (cpu->is_read_instruction()) {
+        if (opcode_table[cpu->opcode].page_penalty) {
           /*                                  NOTE(max):
            *    Check page crossing: if no page boundary was crossed then the
            * address is correct and the re-read can be skiped in the Absolute
@@ -380,36 +629,27 @@ void MOS6502::ABY() {
            */
 
           // Exec immediately the next instruction
-          if (!cpu->microcode_q.is_empty()) {
-            micro_op_t micro_operation;
-            cpu->microcode_q.dequeue(micro_operation);
-            micro_operation(cpu);
-          }
+          cpu->exec_micro_op();
         } else {
           cpu->mem_read();
         }
-      });
+      }),
   // *INDENT-ON*
-}
+});
 
-void MOS6502::IMP() {
-  // TICK(1): Fetch opcode, increment PC
+// TICK(1): Fetch opcode, increment PC
+const MOS6502::microcode_t MOS6502::IMP = microcode({});
 
-  asm("nop");
-}
+// NOTE(max):   This addressing mode is specific for Branching,
+//              all cases are handled inside the instruction
+const MOS6502::microcode_t MOS6502::REL = microcode({});
 
-void MOS6502::REL() {
-  // NOTE(max):   This addressing mode is specific for Branching,
-  //              all cases are handled inside the instruction
-  asm("nop");
-}
-
-void MOS6502::IIX() {
+const MOS6502::microcode_t MOS6502::IIX = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch pointer address, increment PC
   MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
-            cpu->lo = cpu->data_bus;);
+            cpu->lo = cpu->data_bus;),
 
   // TICK(3): Read from the address, add X to it
   MICROCODE(cpu->address_bus = static_cast<uint16_t>(cpu->lo) & 0x00FF;
@@ -417,26 +657,26 @@ void MOS6502::IIX() {
             cpu->address_bus =
                 (cpu->lo + cpu->X) &
                 0x00FF; /* No page crossing, discarding the carry */
-  );
+  ),
 
   // TICK(3): Fetch effective address low
-  MICROCODE(cpu->mem_read(); cpu->lo = cpu->data_bus;);
+  MICROCODE(cpu->mem_read(); cpu->lo = cpu->data_bus;),
 
   // TICK(4): Fetch effective address high
   MICROCODE(
       cpu->address_bus = (cpu->address_bus + 1) & 0x00FF; /* No page crossing */
-      cpu->mem_read(); cpu->address_bus = ADDRESS(cpu->data_bus, cpu->lo););
-}
+      cpu->mem_read(); cpu->address_bus = ADDRESS(cpu->data_bus, cpu->lo);),
+});
 
-void MOS6502::IIY() {
+const MOS6502::microcode_t MOS6502::IIY = microcode({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch pointer address, increment PC
-  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();),
 
   // TICK(3): Fetch effective address low
   MICROCODE(cpu->address_bus = static_cast<uint16_t>(cpu->data_bus) & 0x00FF;
-            cpu->mem_read(); cpu->lo = cpu->data_bus;);
+            cpu->mem_read(); cpu->lo = cpu->data_bus;),
 
   // *INDENT-OFF*
   // TICK(4): Fetch effective address high, add Y to low byte of effective
@@ -448,7 +688,7 @@ void MOS6502::IIY() {
 
       cpu->tmp_buff = static_cast<uint16_t>(cpu->lo) + cpu->Y;
 
-      cpu->address_bus = ADDRESS(cpu->hi, cpu->tmp_buff & 0x00FF););
+      cpu->address_bus = ADDRESS(cpu->hi, cpu->tmp_buff & 0x00FF);),
 
   // TICK(5):     Read from effective address, fix high byte of effective
   // address
@@ -457,343 +697,242 @@ void MOS6502::IIY() {
                                     cpu->mem_read();
                                     cpu->address_bus += 0x0100;
       } else {
-        if (cpu->is_read_instruction()) {
+        if (opcode_table[cpu->opcode].page_penalty) {
           // NOTE(max):   Only in Read instructions (LDA, EOR, AND, ORA, ADC,
           // SBC, CMP)
           //              the next cycle will be executed only if boundary was
           //              crossed
 
           // Exec immediately the next instruction
-          if (!cpu->microcode_q.is_empty()) {
-            micro_op_t micro_operation;
-            cpu->microcode_q.dequeue(micro_operation);
-            micro_operation(cpu);
-          }
+          cpu->exec_micro_op();
         } else {
           cpu->mem_read();
         }
-      });
+      }),
   // *INDENT-ON*
-}
+});
 
-void MOS6502::IND() {
-  // This is just a special JMP
-  asm("nop");
-}
+// This is just a special JMP, see JMP_IND
+const MOS6502::microcode_t MOS6502::IND = microcode({});
 
 /********************************************************
  *                   INSTRUCTION SET                    *
  ********************************************************/
-void MOS6502::ADC() {
+// TICK(3) of the taken branches: add operand to PCL
+static void branch_add_offset(MOS6502 *cpu) {
+  /* Read the memory after the instruction */
+  cpu->address_bus = cpu->PC;
+  cpu->mem_read();
+
+  cpu->tmp_buff = cpu->PC + static_cast<int8_t>(cpu->lo);
+
+  if ((cpu->tmp_buff & 0xFF00) == (cpu->PC & 0xFF00)) {
+    /* No page crossing, PCH is already correct */
+    cpu->skip_microcode();
+  }
+
+  /* Set the low bits*/
+  cpu->PC = COMBINE(cpu->tmp_buff, cpu->PC);
+}
+
+// TICK(4) of the taken branches that cross the page: fix PCH
+static void branch_fix_pch(MOS6502 *cpu) {
+  cpu->address_bus = cpu->PC;
+  cpu->mem_read();
+
+  if (cpu->lo & 0x80) { /* if relative_adderess >= 128 */
+    cpu->PC -= 0x0100;
+  } else {
+    cpu->PC += 0x0100;
+  }
+}
+
+const MOS6502::microcode_t MOS6502::ADC = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(
       cpu->mem_read();
 
-      /* add is done in 16bit mode to catch the carry bit */
-      cpu->tmp_buff = (uint16_t)cpu->A + (uint16_t)cpu->data_bus +
-                      (cpu->read_flag(MOS6502::C) ? 0x0001 : 0x0000);
-
-      cpu->set_flag(MOS6502::C, cpu->tmp_buff > 0x00FF); /* Set the carry bit */
-      cpu->set_flag(MOS6502::Z,
-                    (cpu->tmp_buff & 0x00FF) == 0x0000); /* Set Zero bit */
-      /* Set Overflow bit */
-      cpu->set_flag(MOS6502::O,
-                    (~((uint16_t)(cpu->A ^ cpu->data_bus) & 0x00FF) &
-                     ((uint16_t)cpu->A ^ cpu->tmp_buff) & 0x0080));
-      cpu->set_flag(MOS6502::N,
-                    cpu->tmp_buff & 0x80); /* Set the Negative bit */
-
-      cpu->A = cpu->tmp_buff & 0x00FF;);
-}
+      cpu->add(cpu->data_bus);),
+});
 
-void MOS6502::AND() {
+const MOS6502::microcode_t MOS6502::AND = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
 
             cpu->A = cpu->A & cpu->data_bus;
 
-            cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80););
-}
+            cpu->set_ZN(cpu->A);),
+});
 
-void MOS6502::ASL() {
+const MOS6502::microcode_t MOS6502::ASL = microcode({
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write();
 
-            cpu->tmp_buff = ((uint16_t)cpu->data_bus) << 1;
-
-            cpu->set_flag(MOS6502::C, (cpu->tmp_buff & 0xFF00) > 0);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->shift(asl_table);),
 
   // TICK(A + 3): Write the new value to effective address
-  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write(););
-}
+  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();),
+});
 
-void MOS6502::BCC() {
-  // TICK(1): Fetch opcode, increment PC
+const MOS6502::microcode_t MOS6502::BCC = microcode({
+    // TICK(2): Fetch operand, increment PC
+    MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
+              cpu->lo = cpu->data_bus;
 
-  // *INDENT-OFF*
-  // TICK(2): Fetch operand, increment PC
-  MICROCODE(
-      cpu->address_bus = cpu->PC++; cpu->mem_read(); cpu->lo = cpu->data_bus;
-
-      /* if no branch taken just go with other instruction */
-      if (cpu->read_flag(C) == false) {
-        /* Branch Taken */
-
-        // TICK(3): If branch is taken, add operand to PCL.
-        cpu->MICROCODE(
-            /* Read the memory after the instruction */
-            cpu->address_bus = cpu->PC; cpu->mem_read();
-
-            cpu->tmp_buff = cpu->PC + static_cast<int8_t>(cpu->lo);
-
-            if ((cpu->tmp_buff & 0xFF00) !=
-                (cpu->PC &
-                 0xFF00)) { /* page crossing */
-                            // TICK(4): Fix PCH. If it did not change, increment
-                            // PC.
-                            cpu->MICROCODE(
-                                cpu->address_bus = cpu->PC; cpu->mem_read();
-
-                                if (cpu->lo &
-                                    0x80) { /* if relative_adderess >= 128 */
-                                            cpu->PC -= 0x0100;
-                                } else { cpu->PC += 0x0100; });
-            }
-
-            /* Set the low bits*/
-            cpu->PC = COMBINE(cpu->tmp_buff, cpu->PC););
-      });
-  // *INDENT-ON*
-}
+              /* if no branch taken just go with other instruction */
+              if (cpu->read_flag(C)) { cpu->skip_microcode(); }),
 
-void MOS6502::BCS() {
-  // TICK(1): Fetch opcode, increment PC
+    // TICK(3): If branch is taken, add operand to PCL
+    branch_add_offset,
 
-  // *INDENT-OFF*
-  // TICK(2): Fetch operand, increment PC
-  MICROCODE(
-      cpu->address_bus = cpu->PC++; cpu->mem_read(); cpu->lo = cpu->data_bus;
-
-      /* if no branch taken just go with other instruction */
-      if (cpu->read_flag(C)) {
-        /* Branch Taken */
-
-        // TICK(3): If branch is taken, add operand to PCL.
-        cpu->MICROCODE(
-            /* Read the memory after the instruction */
-            cpu->address_bus = cpu->PC; cpu->mem_read();
-
-            cpu->tmp_buff = cpu->PC + static_cast<int8_t>(cpu->lo);
-
-            if ((cpu->tmp_buff & 0xFF00) !=
-                (cpu->PC &
-                 0xFF00)) { /* page crossing */
-                            // TICK(4): Fix PCH. If it did not change, increment
-                            // PC.
-                            cpu->MICROCODE(
-                                cpu->address_bus = cpu->PC; cpu->mem_read();
-
-                                if (cpu->lo &
-                                    0x80) { /* if relative_adderess >= 128 */
-                                            cpu->PC -= 0x0100;
-                                } else { cpu->PC += 0x0100; });
-            }
-
-            /* Set the low bits*/
-            cpu->PC = COMBINE(cpu->tmp_buff, cpu->PC););
-      });
-  // *INDENT-ON*
-}
+    // TICK(4): Fix PCH, only if the page was crossed
+    branch_fix_pch,
+});
 
-void MOS6502::BEQ() {
-  // TICK(1): Fetch opcode, increment PC
+const MOS6502::microcode_t MOS6502::BCS = microcode({
+    // TICK(2): Fetch operand, increment PC
+    MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
+              cpu->lo = cpu->data_bus;
 
-  // *INDENT-OFF*
-  // TICK(2): Fetch operand, increment PC
-  MICROCODE(
-      cpu->address_bus = cpu->PC++; cpu->mem_read(); cpu->lo = cpu->data_bus;
-
-      /* if no branch taken just go with other instruction */
-      if (cpu->read_flag(Z)) {
-        /* Branch Taken */
-
-        // TICK(3): If branch is taken, add operand to PCL.
-        cpu->MICROCODE(
-            /* Read the memory after the instruction */
-            cpu->address_bus = cpu->PC; cpu->mem_read();
-
-            cpu->tmp_buff = cpu->PC + static_cast<int8_t>(cpu->lo);
-
-            if ((cpu->tmp_buff & 0xFF00) !=
-                (cpu->PC &
-                 0xFF00)) { /* page crossing */
-                            // TICK(4): Fix PCH. If it did not change, increment
-                            // PC.
-                            cpu->MICROCODE(
-                                cpu->address_bus = cpu->PC; cpu->mem_read();
-
-                                if (cpu->lo &
-                                    0x80) { /* if relative_adderess >= 128 */
-                                            cpu->PC -= 0x0100;
-                                } else { cpu->PC += 0x0100; });
-            }
-
-            /* Set the low bits*/
-            cpu->PC = COMBINE(cpu->tmp_buff, cpu->PC););
-      });
-  // *INDENT-ON*
-}
+              /* if no branch taken just go with other instruction */
+              if (!cpu->read_flag(C)) { cpu->skip_microcode(); }),
+
+    // TICK(3): If branch is taken, add operand to PCL
+    branch_add_offset,
+
+    // TICK(4): Fix PCH, only if the page was crossed
+    branch_fix_pch,
+});
+
+const MOS6502::microcode_t MOS6502::BEQ = microcode({
+    // TICK(2): Fetch operand, increment PC
+    MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
+              cpu->lo = cpu->data_bus;
+
+              /* if no branch taken just go with other instruction */
+              if (!cpu->read_flag(Z)) { cpu->skip_microcode(); }),
+
+    // TICK(3): If branch is taken, add operand to PCL
+    branch_add_offset,
 
-void MOS6502::BIT() {
+    // TICK(4): Fix PCH, only if the page was crossed
+    branch_fix_pch,
+});
+
+const MOS6502::microcode_t MOS6502::BIT = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read(); cpu->tmp_buff = cpu->A & cpu->data_bus;
 
             cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x00);
             cpu->set_flag(MOS6502::N, cpu->data_bus & (1 << 7));
-            cpu->set_flag(MOS6502::O, cpu->data_bus & (1 << 6)););
-}
+            cpu->set_flag(MOS6502::O, cpu->data_bus & (1 << 6));),
+});
 
-void MOS6502::BMI() {
-  // TICK(1): Fetch opcode, increment PC
+const MOS6502::microcode_t MOS6502::BMI = microcode({
+    // TICK(2): Fetch operand, increment PC
+    MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
+              cpu->lo = cpu->data_bus;
 
-  // *INDENT-OFF*
-  // TICK(2): Fetch operand, increment PC
-  MICROCODE(
-      cpu->address_bus = cpu->PC++; cpu->mem_read(); cpu->lo = cpu->data_bus;
-
-      /* if no branch taken just go with other instruction */
-      if (cpu->read_flag(N)) {
-        /* Branch Taken */
-
-        // TICK(3): If branch is taken, add operand to PCL.
-        cpu->MICROCODE(
-            /* Read the memory after the instruction */
-            cpu->address_bus = cpu->PC; cpu->mem_read();
-
-            cpu->tmp_buff = cpu->PC + static_cast<int8_t>(cpu->lo);
-
-            if ((cpu->tmp_buff & 0xFF00) !=
-                (cpu->PC &
-                 0xFF00)) { /* page crossing */
-                            // TICK(4): Fix PCH. If it did not change, increment
-                            // PC.
-                            cpu->MICROCODE(
-                                cpu->address_bus = cpu->PC; cpu->mem_read();
-
-                                if (cpu->lo &
-                                    0x80) { /* if relative_adderess >= 128 */
-                                            cpu->PC -= 0x0100;
-                                } else { cpu->PC += 0x0100; });
-            }
-
-            /* Set the low bits*/
-            cpu->PC = COMBINE(cpu->tmp_buff, cpu->PC););
-      });
-  // *INDENT-ON*
+              /* if no branch taken just go with other instruction */
+              if (!cpu->read_flag(N)) { cpu->skip_microcode(); }),
+
+    // TICK(3): If branch is taken, add operand to PCL
+    branch_add_offset,
+
+    // TICK(4): Fix PCH, only if the page was crossed
+    branch_fix_pch,
+});
+
+const MOS6502::microcode_t MOS6502::BNE = microcode({
+    // TICK(2): Fetch operand, increment PC
+    MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
+              cpu->lo = cpu->data_bus;
+
+              /* if no branch taken just go with other instruction */
+              if (cpu->read_flag(Z)) { cpu->skip_microcode(); }),
+
+    // TICK(3): If branch is taken, add operand to PCL
+    branch_add_offset,
+
+    // TICK(4): Fix PCH, only if the page was crossed
+    branch_fix_pch,
+});
+
+const MOS6502::microcode_t MOS6502::BPL = microcode({
+    // TICK(2): Fetch operand, increment PC
+    MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
+              cpu->lo = cpu->data_bus;
+
+              /* if no branch taken just go with other instruction */
+              if (cpu->read_flag(N)) { cpu->skip_microcode(); }),
+
+    // TICK(3): If branch is taken, add operand to PCL
+    branch_add_offset,
+
+    // TICK(4): Fix PCH, only if the page was crossed
+    branch_fix_pch,
+});
+
+// Micro-ops of the interrupt sequence, shared by BRK, IRQ and NMI
+
+// Push PC H on stack, decrement S
+static void push_pch(MOS6502 *cpu) {
+  cpu->address_bus = STACK_OFFSET + cpu->S--;
+  cpu->data_bus = (cpu->PC >> 8) & 0x00FF;
+  cpu->mem_write();
 }
 
-void MOS6502::BNE() {
-  // TICK(1): Fetch opcode, increment PC
+// Push PC L on stack, decrement S
+static void push_pcl(MOS6502 *cpu) {
+  cpu->address_bus = STACK_OFFSET + cpu->S--;
+  cpu->data_bus = cpu->PC & 0x00FF;
+  cpu->mem_write();
+}
 
-  // *INDENT-OFF*
-  // TICK(2): Fetch operand, increment PC
-  MICROCODE(
-      cpu->address_bus = cpu->PC++; cpu->mem_read(); cpu->lo = cpu->data_bus;
-
-      /* if no branch taken just go with other instruction */
-      if (cpu->read_flag(Z) == false) {
-        /* Branch Taken */
-
-        // TICK(3): If branch is taken, add operand to PCL.
-        cpu->MICROCODE(
-            /* Read the memory after the instruction */
-            cpu->address_bus = cpu->PC; cpu->mem_read();
-
-            cpu->tmp_buff = cpu->PC + static_cast<int8_t>(cpu->lo);
-
-            if ((cpu->tmp_buff & 0xFF00) !=
-                (cpu->PC &
-                 0xFF00)) { /* page crossing */
-                            // TICK(4): Fix PCH. If it did not change, increment
-                            // PC.
-                            cpu->MICROCODE(
-                                cpu->address_bus = cpu->PC; cpu->mem_read();
-
-                                if (cpu->lo &
-                                    0x80) { /* if relative_adderess >= 128 */
-                                            cpu->PC -= 0x0100;
-                                } else { cpu->PC += 0x0100; });
-            }
-
-            /* Set the low bits*/
-            cpu->PC = COMBINE(cpu->tmp_buff, cpu->PC););
-      });
-  // *INDENT-ON*
+// Read the byte at PC (and throw it away), the PC is not incremented
+static void interrupt_dummy_read(MOS6502 *cpu) {
+  cpu->address_bus = cpu->PC;
+  cpu->mem_read();
 }
 
-void MOS6502::BPL() {
-  // TICK(1): Fetch opcode, increment PC
+// Push P on stack (with B flag clear), decrement S, set I
+static void interrupt_push_p(MOS6502 *cpu) {
+  cpu->set_flag(MOS6502::B, false);
+  cpu->address_bus = STACK_OFFSET + cpu->S--;
+  cpu->data_bus = cpu->P | MOS6502::U;
+  cpu->mem_write();
+  cpu->set_flag(MOS6502::I, true);
+}
 
-  // *INDENT-OFF*
-  // TICK(2): Fetch operand, increment PC
-  MICROCODE(
-      cpu->address_bus = cpu->PC++; cpu->mem_read(); cpu->lo = cpu->data_bus;
-
-      /* if no branch taken just go with other instruction */
-      if (cpu->read_flag(N) == false) {
-        /* Branch Taken */
-
-        // TICK(3): If branch is taken, add operand to PCL.
-        cpu->MICROCODE(
-            /* Read the memory after the instruction */
-            cpu->address_bus = cpu->PC; cpu->mem_read();
-
-            cpu->tmp_buff = cpu->PC + static_cast<int8_t>(cpu->lo);
-
-            if ((cpu->tmp_buff & 0xFF00) !=
-                (cpu->PC &
-                 0xFF00)) { /* page crossing */
-                            // TICK(4): Fix PCH. If it did not change, increment
-                            // PC.
-                            cpu->MICROCODE(
-                                cpu->address_bus = cpu->PC; cpu->mem_read();
-
-                                if (cpu->lo &
-                                    0x80) { /* if relative_adderess >= 128 */
-                                            cpu->PC -= 0x0100;
-                                } else { cpu->PC += 0x0100; });
-            }
-
-            /* Set the low bits*/
-            cpu->PC = COMBINE(cpu->tmp_buff, cpu->PC););
-      });
-  // *INDENT-ON*
+// Fetch PC L from the vector at 'pcl'
+template <uint16_t pcl> static void fetch_pcl(MOS6502 *cpu) {
+  cpu->address_bus = pcl;
+  cpu->mem_read();
+  cpu->tmp_buff = cpu->data_bus & 0x00FF;
 }
 
-void MOS6502::BRK() {
-  // NOTE(max):   Clear the microcode_q because in this case the
-  //              implied addressing mode is different
-  microcode_q.clear();
+// Fetch PC H from the vector at 'pch'
+template <uint16_t pch> static void fetch_pch(MOS6502 *cpu) {
+  cpu->address_bus = pch;
+  cpu->mem_read();
+  cpu->PC = ((((uint16_t)cpu->data_bus) << 8) & 0xFF00) | cpu->tmp_buff;
+}
 
+const MOS6502::microcode_t MOS6502::BRK = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away), increment PC
-  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();),
 
   // TICK(3): Push PC H on stack, decrement S
-  MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S--;
-            cpu->data_bus = (cpu->PC >> 8) & 0x00FF; cpu->mem_write(););
+  push_pch,
 
   // TICK(4): Push PC L on stack, decrement S
-  MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S--;
-            cpu->data_bus = cpu->PC & 0x00FF; cpu->mem_write(););
+  push_pcl,
 
   // TICK(5): Push P on stack (with B flag set), decrement S
   MICROCODE(
@@ -802,835 +941,690 @@ void MOS6502::BRK() {
       cpu->address_bus = STACK_OFFSET + cpu->S--; cpu->data_bus = cpu->P;
       cpu->mem_write();
       /* TODO(max): verify if this should be false after push */
-      cpu->set_flag(MOS6502::B, false););
+      cpu->set_flag(MOS6502::B, false);),
 
   // TICK(6): Fetch PC L from 0xFFFE
-  MICROCODE(cpu->address_bus = BRK_PCL; cpu->mem_read();
-            cpu->tmp_buff = cpu->data_bus & 0x00FF;);
+  fetch_pcl<BRK_PCL>,
 
   // TICK(7): Fetch PC H from 0xFFFF
-  MICROCODE(cpu->address_bus = BRK_PCH; cpu->mem_read();
-            cpu->PC =
-                ((((uint16_t)cpu->data_bus) << 8) & 0xFF00) | cpu->tmp_buff;);
-}
+  fetch_pch<BRK_PCH>,
+});
 
-void MOS6502::BVC() {
-  // TICK(1): Fetch opcode, increment PC
+const MOS6502::microcode_t MOS6502::BVC = microcode({
+    // TICK(2): Fetch operand, increment PC
+    MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
+              cpu->lo = cpu->data_bus;
 
-  // *INDENT-OFF*
-  // TICK(2): Fetch operand, increment PC
-  MICROCODE(
-      cpu->address_bus = cpu->PC++; cpu->mem_read(); cpu->lo = cpu->data_bus;
-
-      /* if no branch taken just go with other instruction */
-      if (cpu->read_flag(O) == false) {
-        /* Branch Taken */
-
-        // TICK(3): If branch is taken, add operand to PCL.
-        cpu->MICROCODE(
-            /* Read the memory after the instruction */
-            cpu->address_bus = cpu->PC; cpu->mem_read();
-
-            cpu->tmp_buff = cpu->PC + static_cast<int8_t>(cpu->lo);
-
-            if ((cpu->tmp_buff & 0xFF00) !=
-                (cpu->PC &
-                 0xFF00)) { /* page crossing */
-                            // TICK(4): Fix PCH. If it did not change, increment
-                            // PC.
-                            cpu->MICROCODE(
-                                cpu->address_bus = cpu->PC; cpu->mem_read();
-
-                                if (cpu->lo &
-                                    0x80) { /* if relative_adderess >= 128 */
-                                            cpu->PC -= 0x0100;
-                                } else { cpu->PC += 0x0100; });
-            }
-
-            /* Set the low bits*/
-            cpu->PC = COMBINE(cpu->tmp_buff, cpu->PC););
-      });
-  // *INDENT-ON*
-}
+              /* if no branch taken just go with other instruction */
+              if (cpu->read_flag(O)) { cpu->skip_microcode(); }),
 
-void MOS6502::BVS() {
-  // TICK(1): Fetch opcode, increment PC
+    // TICK(3): If branch is taken, add operand to PCL
+    branch_add_offset,
 
-  // *INDENT-OFF*
-  // TICK(2): Fetch operand, increment PC
-  MICROCODE(
-      cpu->address_bus = cpu->PC++; cpu->mem_read(); cpu->lo = cpu->data_bus;
-
-      /* if no branch taken just go with other instruction */
-      if (cpu->read_flag(O)) {
-        /* Branch Taken */
-
-        // TICK(3): If branch is taken, add operand to PCL.
-        cpu->MICROCODE(
-            /* Read the memory after the instruction */
-            cpu->address_bus = cpu->PC; cpu->mem_read();
-
-            cpu->tmp_buff = cpu->PC + static_cast<int8_t>(cpu->lo);
-
-            if ((cpu->tmp_buff & 0xFF00) !=
-                (cpu->PC &
-                 0xFF00)) { /* page crossing */
-                            // TICK(4): Fix PCH. If it did not change, increment
-                            // PC.
-                            cpu->MICROCODE(
-                                cpu->address_bus = cpu->PC; cpu->mem_read();
-
-                                if (cpu->lo &
-                                    0x80) { /* if relative_adderess >= 128 */
-                                            cpu->PC -= 0x0100;
-                                } else { cpu->PC += 0x0100; });
-            }
-
-            /* Set the low bits*/
-            cpu->PC = COMBINE(cpu->tmp_buff, cpu->PC););
-      });
-  // *INDENT-ON*
-}
+    // TICK(4): Fix PCH, only if the page was crossed
+    branch_fix_pch,
+});
+
+const MOS6502::microcode_t MOS6502::BVS = microcode({
+    // TICK(2): Fetch operand, increment PC
+    MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
+              cpu->lo = cpu->data_bus;
 
-void MOS6502::CLC() {
-  microcode_q.clear();
+              /* if no branch taken just go with other instruction */
+              if (!cpu->read_flag(O)) { cpu->skip_microcode(); }),
 
+    // TICK(3): If branch is taken, add operand to PCL
+    branch_add_offset,
+
+    // TICK(4): Fix PCH, only if the page was crossed
+    branch_fix_pch,
+});
+
+const MOS6502::microcode_t MOS6502::CLC = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();
-            cpu->set_flag(MOS6502::C, false););
-}
-
-void MOS6502::CLD() {
-  microcode_q.clear();
+            cpu->set_flag(MOS6502::C, false);),
+});
 
+const MOS6502::microcode_t MOS6502::CLD = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();
-            cpu->set_flag(MOS6502::D, false););
-}
-
-void MOS6502::CLI() {
-  microcode_q.clear();
+            cpu->set_flag(MOS6502::D, false);),
+});
 
+const MOS6502::microcode_t MOS6502::CLI = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();
-            cpu->set_flag(MOS6502::I, false););
-}
-
-void MOS6502::CLV() {
-  microcode_q.clear();
+            cpu->set_flag(MOS6502::I, false);),
+});
 
+const MOS6502::microcode_t MOS6502::CLV = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();
-            cpu->set_flag(MOS6502::O, false););
-}
+            cpu->set_flag(MOS6502::O, false);),
+});
 
-void MOS6502::CMP() {
+const MOS6502::microcode_t MOS6502::CMP = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
 
-            cpu->tmp_buff = (uint16_t)cpu->A - (uint16_t)cpu->data_bus;
-            cpu->set_flag(MOS6502::C, cpu->A >= cpu->data_bus);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
-}
+            cpu->set_alu_flags(MOS6502::N | MOS6502::Z | MOS6502::C,
+                               alu_compare(cpu->A, cpu->data_bus));),
+});
 
-void MOS6502::CPX() {
+const MOS6502::microcode_t MOS6502::CPX = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
-            cpu->tmp_buff = (uint16_t)cpu->X - (uint16_t)cpu->data_bus;
-            cpu->set_flag(MOS6502::C, cpu->X >= cpu->data_bus);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
-}
+            cpu->set_alu_flags(MOS6502::N | MOS6502::Z | MOS6502::C,
+                               alu_compare(cpu->X, cpu->data_bus));),
+});
 
-void MOS6502::CPY() {
+const MOS6502::microcode_t MOS6502::CPY = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
-            cpu->tmp_buff = (uint16_t)cpu->Y - (uint16_t)cpu->data_bus;
-            cpu->set_flag(MOS6502::C, cpu->Y >= cpu->data_bus);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
-}
-
-void MOS6502::DEC() {
+            cpu->set_alu_flags(MOS6502::N | MOS6502::Z | MOS6502::C,
+                               alu_compare(cpu->Y, cpu->data_bus));),
+});
 
+const MOS6502::microcode_t MOS6502::DEC = microcode({
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write(); cpu->tmp_buff = cpu->data_bus - 1;
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->set_ZN(cpu->tmp_buff & 0x00FF);),
 
   // TICK(A + 3): Write the new value to effective address
-  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write(););
-}
-
-void MOS6502::DEX() {
-  microcode_q.clear();
+  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();),
+});
 
+const MOS6502::microcode_t MOS6502::DEX = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->X--;
-            cpu->set_flag(MOS6502::Z, cpu->X == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->X & 0x80););
-}
-
-void MOS6502::DEY() {
-  microcode_q.clear();
+            cpu->set_ZN(cpu->X);),
+});
 
+const MOS6502::microcode_t MOS6502::DEY = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->Y--;
-            cpu->set_flag(MOS6502::Z, cpu->Y == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->Y & 0x80););
-}
+            cpu->set_ZN(cpu->Y);),
+});
 
-void MOS6502::EOR() {
+const MOS6502::microcode_t MOS6502::EOR = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
 
             cpu->A = cpu->data_bus ^ cpu->A;
-            cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80););
-}
-
-void MOS6502::INC() {
+            cpu->set_ZN(cpu->A);),
+});
 
+const MOS6502::microcode_t MOS6502::INC = microcode({
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write(); cpu->tmp_buff = cpu->data_bus + 1;
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->set_ZN(cpu->tmp_buff & 0x00FF);),
 
   // TICK(A + 3): Write the new value to effective address
-  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write(););
-}
-
-void MOS6502::INX() {
-  microcode_q.clear();
+  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();),
+});
 
+const MOS6502::microcode_t MOS6502::INX = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->X++;
-            cpu->set_flag(MOS6502::Z, cpu->X == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->X & 0x80););
-}
-
-void MOS6502::INY() {
-  microcode_q.clear();
+            cpu->set_ZN(cpu->X);),
+});
 
+const MOS6502::microcode_t MOS6502::INY = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->Y++;
-            cpu->set_flag(MOS6502::Z, cpu->Y == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->Y & 0x80););
-}
+            cpu->set_ZN(cpu->Y);),
+});
+
+// NOTE(max):   JMP is a particular instruction so need to be treated as an
+//              exception
+//              0x4C JMP ABS
+//              0x6C JMP IND
+const MOS6502::microcode_t MOS6502::JMP = microcode_without_addressing({
+  // TICK(1): Fetch opcode, increment PC
 
-void MOS6502::JMP() {
-  // NOTE(max):   JMP is a particular instruction so need to be treated as an
-  // exception
-  //              0x4C JMP ABS
-  //              0x6C JMP IND
-  microcode_q.clear();
+  // TICK(2): Fetch low address byte, increment PC
+  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
+            cpu->tmp_buff = cpu->data_bus & 0x00FF;),
+
+  // TICK(3): Copy low address byte to PCL, fetch high address byte to PCH
+  MICROCODE(cpu->address_bus = cpu->PC; cpu->mem_read();
+            cpu->PC = (((uint16_t)cpu->data_bus) << 8) | cpu->tmp_buff;),
+});
 
+const MOS6502::microcode_t MOS6502::JMP_IND = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch low address byte, increment PC
   MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
-            cpu->tmp_buff = cpu->data_bus & 0x00FF;);
-
-  switch (opcode) {
-  case 0x4C: // JMP ABS
-    // TICK(3): Copy low address byte to PCL, fetch high address byte to PCH
-    MICROCODE(cpu->address_bus = cpu->PC; cpu->mem_read();
-              cpu->PC = (((uint16_t)cpu->data_bus) << 8) | cpu->tmp_buff;);
-    break;
-
-  case 0x6C: // JMP IND
-    // TICK(3): Fetch pointer address high, increment PC
-    MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read(););
-
-    // TICK(4): Fetch low address to latch
-    MICROCODE(cpu->address_bus =
-                  (((uint16_t)cpu->data_bus) << 8) | cpu->tmp_buff;
-              cpu->mem_read(); cpu->tmp_buff = cpu->data_bus & 0x00FF;);
-
-    // TICK(5): Fetch PCH, copy latch to PCL
-    MICROCODE(
-        /*
-            NOTE(max):  The PCH will always be fetched from the same page
-                        than PCL, i.e. page boundary crossing is not handled.
-        */
-        cpu->address_bus = (((cpu->address_bus & 0x00FF) == 0x00FF)
-                                ? cpu->address_bus & 0xFF00
-                                : /* Page boundary hardware bug */
-                                cpu->address_bus + 1);
-
-        cpu->mem_read();
-        cpu->PC = (((uint16_t)cpu->data_bus) << 8) | cpu->tmp_buff;);
-    break;
-
-  default:
-    log("Unexpected JMP opcode");
-    break;
-  }
-}
+            cpu->tmp_buff = cpu->data_bus & 0x00FF;),
+
+  // TICK(3): Fetch pointer address high, increment PC
+  MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();),
+
+  // TICK(4): Fetch low address to latch
+  MICROCODE(cpu->address_bus =
+                (((uint16_t)cpu->data_bus) << 8) | cpu->tmp_buff;
+            cpu->mem_read(); cpu->tmp_buff = cpu->data_bus & 0x00FF;),
+
+  // TICK(5): Fetch PCH, copy latch to PCL
+  MICROCODE(
+      /*
+          NOTE(max):  The PCH will always be fetched from the same page
+                      than PCL, i.e. page boundary crossing is not handled.
+      */
+      cpu->address_bus = (((cpu->address_bus & 0x00FF) == 0x00FF)
+                              ? cpu->address_bus & 0xFF00
+                              : /* Page boundary hardware bug */
+                              cpu->address_bus + 1);
 
-void MOS6502::JSR() {
-  // NOTE(max):   Clear the microcode because the JSR act different from normal
-  //              abbsolute addressing mode so i need to remove the addressing
-  //              mode code
-  microcode_q.clear();
+      cpu->mem_read();
+      cpu->PC = (((uint16_t)cpu->data_bus) << 8) | cpu->tmp_buff;),
+});
 
+const MOS6502::microcode_t MOS6502::JSR = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Fetch low address byte, increment PC
   MICROCODE(cpu->address_bus = cpu->PC++; cpu->mem_read();
-            cpu->tmp_buff = cpu->data_bus & 0x00FF;);
+            cpu->tmp_buff = cpu->data_bus & 0x00FF;),
 
   // TICK(3): Internal operation (predecrement S?)
-  MICROCODE(asm("nop"););
+  MICROCODE(asm("nop");),
 
   // TICK(4): Push PC H on stack, decrement S
   MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S--;
-            cpu->data_bus = (cpu->PC >> 8) & 0x00FF; cpu->mem_write(););
+            cpu->data_bus = (cpu->PC >> 8) & 0x00FF; cpu->mem_write();),
 
   // TICK(5): Push PC L on stack, decrement S
   MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S--;
-            cpu->data_bus = cpu->PC & 0x00FF; cpu->mem_write(););
+            cpu->data_bus = cpu->PC & 0x00FF; cpu->mem_write();),
 
   // TICK(6): Copy low address byte to PC L, fetch high address byte to PC H
   MICROCODE(cpu->address_bus = cpu->PC; cpu->mem_read();
-            cpu->PC = (((uint16_t)cpu->data_bus) << 8) | cpu->tmp_buff;);
-}
+            cpu->PC = (((uint16_t)cpu->data_bus) << 8) | cpu->tmp_buff;),
+});
 
-void MOS6502::LDA() {
+const MOS6502::microcode_t MOS6502::LDA = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read(); cpu->A = cpu->data_bus;
 
-            cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80););
-}
+            cpu->set_ZN(cpu->A);),
+});
 
-void MOS6502::LDX() {
+const MOS6502::microcode_t MOS6502::LDX = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
 
             cpu->X = cpu->data_bus;
 
-            cpu->set_flag(MOS6502::Z, cpu->X == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->X & 0x80););
-}
+            cpu->set_ZN(cpu->X);),
+});
 
-void MOS6502::LDY() {
+const MOS6502::microcode_t MOS6502::LDY = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
 
             cpu->Y = cpu->data_bus;
 
-            cpu->set_flag(MOS6502::Z, cpu->Y == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->Y & 0x80););
-}
+            cpu->set_ZN(cpu->Y);),
+});
 
-void MOS6502::LSR() {
+const MOS6502::microcode_t MOS6502::LSR = microcode({
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
-  MICROCODE(cpu->mem_write(); cpu->set_flag(MOS6502::C, cpu->data_bus & 0x01);
-
-            cpu->tmp_buff = cpu->data_bus >> 1;
-
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, false););
+  MICROCODE(cpu->mem_write(); cpu->shift(lsr_table);),
 
   // TICK(A + 3): Write the new value to effective address
-  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write(););
-}
+  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();),
+});
 
-void MOS6502::NOP() {
-  // TICK(A + 1): Read from effective address
-  MICROCODE(asm("nop"););
-}
+const MOS6502::microcode_t MOS6502::NOP = microcode({
+  // TICK(A + 1): Read the immediate operand, the other addressing modes have
+  // already fetched theirs
+  MICROCODE(if (cpu->instruction->addrmode == &IMM) { cpu->mem_read(); }),
+});
 
-void MOS6502::NO2() {
-  // TICK(A + 1):
-  MICROCODE(asm("nop"););
+const MOS6502::microcode_t MOS6502::NO2 = microcode({
+  // TICK(A + 1): Read the immediate operand
+  MICROCODE(if (cpu->instruction->addrmode == &IMM) { cpu->mem_read(); }),
 
   // TICK(A + 2):
-  MICROCODE(asm("nop"););
-}
+  MICROCODE(asm("nop");),
+});
 
-void MOS6502::ORA() {
+const MOS6502::microcode_t MOS6502::ORA = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
 
             cpu->A = cpu->A | cpu->data_bus;
-            cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80););
-}
-
-void MOS6502::PHA() {
+            cpu->set_ZN(cpu->A);),
+});
 
+const MOS6502::microcode_t MOS6502::PHA = microcode({
   // TICK(2): read next instruction byte (and throw it away)
-  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();),
 
   // TICK(3): Push register on stack, decrement S
   MICROCODE(cpu->data_bus = cpu->A; cpu->address_bus = STACK_OFFSET + cpu->S--;
-            cpu->mem_write(););
-}
-
-void MOS6502::PHP() {
+            cpu->mem_write();),
+});
 
+const MOS6502::microcode_t MOS6502::PHP = microcode({
   // TICK(2): read next instruction byte (and throw it away)
-  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();),
 
   // TICK(3): Push register on stack, decrement S
   MICROCODE(cpu->set_flag(MOS6502::B, true); cpu->data_bus = cpu->P;
             cpu->address_bus = STACK_OFFSET + cpu->S--; cpu->mem_write();
-            cpu->set_flag(MOS6502::B, false););
-}
-
-void MOS6502::PLA() {
+            cpu->set_flag(MOS6502::B, false);),
+});
 
+const MOS6502::microcode_t MOS6502::PLA = microcode({
   // TICK(2): read next instruction byte (and throw it away)
-  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();),
 
   // TICK(3): Increment S
-  MICROCODE(cpu->S++;);
+  MICROCODE(cpu->S++;),
 
   // TICK(4): Pull register from stack
   MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S; cpu->mem_read();
-            cpu->A = cpu->data_bus; cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80););
-}
-
-void MOS6502::PLP() {
+            cpu->A = cpu->data_bus; cpu->set_ZN(cpu->A);),
+});
 
+const MOS6502::microcode_t MOS6502::PLP = microcode({
   // TICK(2): read next instruction byte (and throw it away)
-  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();),
 
   // TICK(3): Increment S
-  MICROCODE(cpu->S++;);
+  MICROCODE(cpu->S++;),
 
   // TICK(4): Pull register from stack
   MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S; cpu->mem_read();
             cpu->P = cpu->data_bus; cpu->set_flag(MOS6502::B, false);
-            cpu->set_flag(MOS6502::U, true););
-}
-
-void MOS6502::ROL() {
+            cpu->set_flag(MOS6502::U, true);),
+});
 
+const MOS6502::microcode_t MOS6502::ROL = microcode({
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write();
-            cpu->tmp_buff = (uint16_t)(cpu->data_bus << 1) |
-                            (cpu->read_flag(MOS6502::C) ? 1 : 0);
-            cpu->set_flag(MOS6502::C, cpu->tmp_buff & 0xFF00);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->shift(rol_table);),
 
   // TICK(A + 3): Write the new value to effective address
-  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write(););
-}
-
-void MOS6502::ROR() {
+  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();),
+});
 
+const MOS6502::microcode_t MOS6502::ROR = microcode({
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write();
-            cpu->tmp_buff =
-                (uint16_t)((cpu->read_flag(MOS6502::C) ? 1 : 0) << 7) |
-                (cpu->data_bus >> 1);
-            cpu->set_flag(MOS6502::C, cpu->data_bus & 0x01);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->shift(ror_table);),
 
   // TICK(A + 3): Write the new value to effective address
-  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write(););
-}
-
-void MOS6502::RTI() {
+  MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();),
+});
 
+const MOS6502::microcode_t MOS6502::RTI = microcode({
   // TICK(2): read next instruction byte (and throw it away)
-  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();),
 
   // TICK(3): Increment S
-  MICROCODE(cpu->S++;);
+  MICROCODE(cpu->S++;),
 
   // TICK(4): Pull P from stack, increment S
   MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S; cpu->mem_read();
             cpu->P = cpu->data_bus;
             /* TODO(max): why this is not zero? */
-            cpu->set_flag(MOS6502::U, true); cpu->S++;);
+            cpu->set_flag(MOS6502::U, true); cpu->S++;),
 
   // TICK(5): Pull PC L from stack, increment S
   MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S; cpu->mem_read();
-            cpu->tmp_buff = (uint16_t)cpu->data_bus; cpu->S++;);
+            cpu->tmp_buff = (uint16_t)cpu->data_bus; cpu->S++;),
 
   // TICK(6): Pull PC H from stack
   MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S; cpu->mem_read();
             cpu->tmp_buff |= (uint16_t)cpu->data_bus << 8;
 
-            cpu->PC = cpu->tmp_buff;);
-}
-
-void MOS6502::RTS() {
+            cpu->PC = cpu->tmp_buff;),
+});
 
+const MOS6502::microcode_t MOS6502::RTS = microcode({
   // TICK(2): read next instruction byte (and throw it away)
-  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(););
+  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();),
 
   // TICK(3): Increment S
-  MICROCODE(cpu->S++;);
+  MICROCODE(cpu->S++;),
 
   // TICK(4): Pull PC L from stack, increment S
   MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S; cpu->mem_read();
-            cpu->tmp_buff = (uint16_t)cpu->data_bus; cpu->S++;);
+            cpu->tmp_buff = (uint16_t)cpu->data_bus; cpu->S++;),
 
   // TICK(5): Pull PC H from stack
   MICROCODE(cpu->address_bus = STACK_OFFSET + cpu->S; cpu->mem_read();
             cpu->tmp_buff |= (uint16_t)cpu->data_bus << 8;
-            cpu->PC = cpu->tmp_buff;);
+            cpu->PC = cpu->tmp_buff;),
 
   // TICK(6): Increment PC
-  MICROCODE(cpu->PC++;);
-}
+  MICROCODE(cpu->PC++;),
+});
 
 // cpu->A = cpu->A - M - (1 - MOS6502::C)  ->  cpu->A = cpu->A + -1 * (M - (1 -
 // MOS6502::C))  ->  cpu->A = cpu->A + (-M + 1 + MOS6502::C)
-void MOS6502::SBC() {
+const MOS6502::microcode_t MOS6502::SBC = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
 
-            uint16_t tv = (uint16_t)cpu->data_bus ^ 0x00FF;
-            cpu->tmp_buff = (uint16_t)cpu->A + tv +
-                            (cpu->read_flag(MOS6502::C) ? 0x0001 : 0x0000);
-            cpu->set_flag(MOS6502::C, cpu->tmp_buff & 0xFF00);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::O, (cpu->tmp_buff ^ (uint16_t)cpu->A) &
-                                          (cpu->tmp_buff ^ tv) & 0x0080);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080);
-            cpu->A = cpu->tmp_buff & 0x00FF;);
-}
-
-void MOS6502::SEC() {
-  microcode_q.clear();
+            cpu->add(cpu->data_bus ^ 0xFF);),
+});
 
+const MOS6502::microcode_t MOS6502::SEC = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();
-            cpu->set_flag(MOS6502::C, true););
-}
-
-void MOS6502::SED() {
-  microcode_q.clear();
+            cpu->set_flag(MOS6502::C, true);),
+});
 
+const MOS6502::microcode_t MOS6502::SED = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();
-            cpu->set_flag(D, true););
-}
-
-void MOS6502::SEI() {
-  microcode_q.clear();
+            cpu->set_flag(D, true);),
+});
 
+const MOS6502::microcode_t MOS6502::SEI = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read();
-            cpu->set_flag(I, true););
-}
+            cpu->set_flag(I, true);),
+});
 
-void MOS6502::STA() {
+const MOS6502::microcode_t MOS6502::STA = microcode({
   // TICK(A + 1): Write register to effective address
-  MICROCODE(cpu->data_bus = cpu->A; cpu->mem_write(););
-}
+  MICROCODE(cpu->data_bus = cpu->A; cpu->mem_write();),
+});
 
-void MOS6502::STX() {
+const MOS6502::microcode_t MOS6502::STX = microcode({
   // TICK(A + 1): Write register to effective address
-  MICROCODE(cpu->data_bus = cpu->X; cpu->mem_write(););
-}
+  MICROCODE(cpu->data_bus = cpu->X; cpu->mem_write();),
+});
 
-void MOS6502::STY() {
+const MOS6502::microcode_t MOS6502::STY = microcode({
   // TICK(A + 1): Write register to effective address
-  MICROCODE(cpu->data_bus = cpu->Y; cpu->mem_write(););
-}
-
-void MOS6502::TAX() {
-  microcode_q.clear();
+  MICROCODE(cpu->data_bus = cpu->Y; cpu->mem_write();),
+});
 
+const MOS6502::microcode_t MOS6502::TAX = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->X = cpu->A;
-            cpu->set_flag(MOS6502::Z, cpu->X == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->X & 0x80););
-}
-
-void MOS6502::TAY() {
-  microcode_q.clear();
+            cpu->set_ZN(cpu->X);),
+});
 
+const MOS6502::microcode_t MOS6502::TAY = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->Y = cpu->A;
-            cpu->set_flag(MOS6502::Z, cpu->Y == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->Y & 0x80););
-}
-
-void MOS6502::TSX() {
-  microcode_q.clear();
+            cpu->set_ZN(cpu->Y);),
+});
 
+const MOS6502::microcode_t MOS6502::TSX = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->X = cpu->S;
-            cpu->set_flag(MOS6502::Z, cpu->X == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->X & 0x80););
-}
-
-void MOS6502::TXA() {
-  microcode_q.clear();
+            cpu->set_ZN(cpu->X);),
+});
 
+const MOS6502::microcode_t MOS6502::TXA = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->A = cpu->X;
-            cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80););
-}
-
-void MOS6502::TXS() {
-  microcode_q.clear();
+            cpu->set_ZN(cpu->A);),
+});
 
+const MOS6502::microcode_t MOS6502::TXS = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
-  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->S = cpu->X;);
-}
-
-void MOS6502::TYA() {
-  microcode_q.clear();
+  MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->S = cpu->X;),
+});
 
+const MOS6502::microcode_t MOS6502::TYA = microcode_without_addressing({
   // TICK(1): Fetch opcode, increment PC
 
   // TICK(2): Read next instruction byte (and throw it away)
   MICROCODE(cpu->address_bus = cpu->PC + 1; cpu->mem_read(); cpu->A = cpu->Y;
-            cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80););
-}
+            cpu->set_ZN(cpu->A);),
+});
 
 /********************************************************
  *                  ILLEGAL INST SET                    *
  ********************************************************/
 
-void MOS6502::LAX() {
+const MOS6502::microcode_t MOS6502::LAX = microcode({
   // TICK(A + 1): Read from effective address
   MICROCODE(cpu->mem_read();
 
             cpu->A = cpu->data_bus; cpu->X = cpu->data_bus;
 
-            cpu->set_flag(MOS6502::Z, cpu->X == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->X & 0x80););
-}
+            cpu->set_ZN(cpu->X);),
+});
 
-void MOS6502::SAX() {
+const MOS6502::microcode_t MOS6502::SAX = microcode({
   // TICK(A + 1): Write register to effective address
-  MICROCODE(cpu->data_bus = cpu->A & cpu->X; cpu->mem_write(););
-}
+  MICROCODE(cpu->data_bus = cpu->A & cpu->X; cpu->mem_write();),
+});
 
-void MOS6502::DCP() {
+const MOS6502::microcode_t MOS6502::DCP = microcode({
   // DEC();
   // CMP();
 
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write(); cpu->tmp_buff = cpu->data_bus - 1;
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->set_ZN(cpu->tmp_buff & 0x00FF);),
 
   // TICK(A + 3): Write the new value to effective address
   MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();
 
             // Do the ops without reading again
-            cpu->tmp_buff = (uint16_t)cpu->A - (uint16_t)cpu->data_bus;
-            cpu->set_flag(MOS6502::C, cpu->A >= cpu->data_bus);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
-}
+            cpu->set_alu_flags(MOS6502::N | MOS6502::Z | MOS6502::C,
+                               alu_compare(cpu->A, cpu->data_bus));),
+});
 
-void MOS6502::ISB() {
+const MOS6502::microcode_t MOS6502::ISB = microcode({
   // INC();
   // SBC();
 
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write(); cpu->tmp_buff = cpu->data_bus + 1;
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->set_ZN(cpu->tmp_buff & 0x00FF);),
 
   // TICK(A + 3): Write the new value to effective address
   MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();
 
             // Do the SBC without reading from memory
-            uint16_t tv = (uint16_t)cpu->data_bus ^ 0x00FF;
-            cpu->tmp_buff = (uint16_t)cpu->A + tv +
-                            (cpu->read_flag(MOS6502::C) ? 0x0001 : 0x0000);
-            cpu->set_flag(MOS6502::C, cpu->tmp_buff & 0xFF00);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::O, (cpu->tmp_buff ^ (uint16_t)cpu->A) &
-                                          (cpu->tmp_buff ^ tv) & 0x0080);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080);
-            cpu->A = cpu->tmp_buff & 0x00FF;);
-}
+            cpu->add(cpu->data_bus ^ 0xFF);),
+});
 
-void MOS6502::SLO() {
+const MOS6502::microcode_t MOS6502::SLO = microcode({
   // ASL();
   // ORA();
 
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write();
 
-            cpu->tmp_buff = ((uint16_t)cpu->data_bus) << 1;
-
-            cpu->set_flag(MOS6502::C, (cpu->tmp_buff & 0xFF00) > 0);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->shift(asl_table);),
 
   // TICK(A + 3): Write the new value to effective address
   MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();
 
             // Do the ORA without reading
             cpu->A = cpu->A | cpu->data_bus;
-            cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80););
-}
+            cpu->set_ZN(cpu->A);),
+});
 
-void MOS6502::RLA() {
+const MOS6502::microcode_t MOS6502::RLA = microcode({
   // ROL();
   // AND();
 
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write();
-            cpu->tmp_buff = (uint16_t)(cpu->data_bus << 1) |
-                            (cpu->read_flag(MOS6502::C) ? 1 : 0);
-            cpu->set_flag(MOS6502::C, cpu->tmp_buff & 0xFF00);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->shift(rol_table);),
 
   // TICK(A + 3): Write the new value to effective address
   MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();
 
             // Do the AND without reading
             cpu->A = cpu->A & cpu->data_bus;
-            cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80);
+            cpu->set_ZN(cpu->A);
 
-  );
-}
+  ),
+});
 
-void MOS6502::SRE() {
+const MOS6502::microcode_t MOS6502::SRE = microcode({
   // LSR();
   // EOR();
 
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
-  MICROCODE(cpu->mem_write(); cpu->set_flag(MOS6502::C, cpu->data_bus & 0x01);
-
-            cpu->tmp_buff = cpu->data_bus >> 1;
-
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, false););
+  MICROCODE(cpu->mem_write(); cpu->shift(lsr_table);),
 
   // TICK(A + 3): Write the new value to effective address
   MICROCODE(cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();
 
             // Do the EOR without reading from memory
             cpu->A = cpu->data_bus ^ cpu->A;
-            cpu->set_flag(MOS6502::Z, cpu->A == 0x00);
-            cpu->set_flag(MOS6502::N, cpu->A & 0x80););
-}
+            cpu->set_ZN(cpu->A);),
+});
 
-void MOS6502::RRA() {
+const MOS6502::microcode_t MOS6502::RRA = microcode({
   // ROR();
   // ADC();
 
   // TICK(A + 1): Read from effective address
-  MICROCODE(cpu->mem_read(););
+  MICROCODE(cpu->mem_read();),
 
   // TICK(A + 2): Write the value back to effective address, and do the
   // operation on it
   MICROCODE(cpu->mem_write();
-            cpu->tmp_buff =
-                (uint16_t)((cpu->read_flag(MOS6502::C) ? 1 : 0) << 7) |
-                (cpu->data_bus >> 1);
-            cpu->set_flag(MOS6502::C, cpu->data_bus & 0x01);
-            cpu->set_flag(MOS6502::Z, (cpu->tmp_buff & 0x00FF) == 0x0000);
-            cpu->set_flag(MOS6502::N, cpu->tmp_buff & 0x0080););
+            cpu->shift(ror_table);),
 
   // TICK(A + 3): Write the new value to effective address
   MICROCODE(
       cpu->data_bus = cpu->tmp_buff & 0x00FF; cpu->mem_write();
 
       // Do the ADC without reading
-      /* add is done in 16bit mode to catch the carry bit */
-      cpu->tmp_buff = (uint16_t)cpu->A + (uint16_t)cpu->data_bus +
-                      (cpu->read_flag(MOS6502::C) ? 0x0001 : 0x0000);
-
-      cpu->set_flag(MOS6502::C, cpu->tmp_buff > 0x00FF); /* Set the carry bit */
-      cpu->set_flag(MOS6502::Z,
-                    (cpu->tmp_buff & 0x00FF) == 0x0000); /* Set Zero bit */
-      /* Set Overflow bit */
-      cpu->set_flag(MOS6502::O,
-                    (~((uint16_t)(cpu->A ^ cpu->data_bus) & 0x00FF) &
-                     ((uint16_t)cpu->A ^ cpu->tmp_buff) & 0x0080));
-      cpu->set_flag(MOS6502::N,
-                    cpu->tmp_buff & 0x80); /* Set the Negative bit */
-
-      cpu->A = cpu->tmp_buff & 0x00FF;);
-}
+      cpu->add(cpu->data_bus);),
+});
+
+// Halt the cpu, done at the opcode fetch
+const MOS6502::microcode_t MOS6502::JAM = microcode({});
+
+// Illegal instruction, only logged at the opcode fetch
+const MOS6502::microcode_t MOS6502::XXX = microcode({});
+
+/********************************************************
+ *                 INTERRUPT SEQUENCES                  *
+ ********************************************************/
+const MOS6502::microcode_t MOS6502::IRQ = microcode_without_addressing({
+  // TICK(1): Fetch opcode (and throw it away), the PC is not incremented
+
+  // TICK(2): Read the same byte again (and throw it away)
+  interrupt_dummy_read,
+
+  // TICK(3): Push PC H on stack, decrement S
+  push_pch,
+
+  // TICK(4): Push PC L on stack, decrement S
+  push_pcl,
+
+  // TICK(5): Push P on stack (with B flag clear), decrement S, set I
+  interrupt_push_p,
+
+  // TICK(6): Fetch PC L from 0xFFFE
+  fetch_pcl<BRK_PCL>,
+
+  // TICK(7): Fetch PC H from 0xFFFF
+  fetch_pch<BRK_PCH>,
+});
+
+const MOS6502::microcode_t MOS6502::NMI = microcode_without_addressing({
+  // TICK(1): Fetch opcode (and throw it away), the PC is not incremented
+
+  // TICK(2): Read the same byte again (and throw it away)
+  interrupt_dummy_read,
+
+  // TICK(3): Push PC H on stack, decrement S
+  push_pch,
+
+  // TICK(4): Push PC L on stack, decrement S
+  push_pcl,
+
+  // TICK(5): Push P on stack (with B flag clear), decrement S, set I
+  interrupt_push_p,
+
+  // TICK(6): Fetch PC L from 0xFFFA
+  fetch_pcl<NMI_PCL>,
 
-void MOS6502::XXX() { log("Executed illegal opcode"); }
+  // TICK(7): Fetch PC H from 0xFFFB
+  fetch_pch<NMI_PCH>,
+});
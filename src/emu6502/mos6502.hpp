@@ -1,7 +1,15 @@
 #pragma once
+#include "alu.hpp"
+#include "block_cache.hpp"
+#include "bus.hpp"
 #include "common.hpp"
+#include "jit.hpp"
+#include "opcode.hpp"
+#include "scheduler.hpp"
 #include "util.hpp"
+#include <array>
 #include <functional>
+#include <memory>
 #include <stdint.h>
 #include <vector>
 
@@ -11,15 +19,95 @@
 #define STACK_OFFSET 0x0100
 #define BRK_PCL 0xFFFE
 #define BRK_PCH 0xFFFF
+#define NMI_PCL 0xFFFA
+#define NMI_PCH 0xFFFB
+#define MICROCODE_MAX_STEPS 6
+
+// Mark the page of 'address' in the 256 bits bitmap 'dirty', see
+// MOS6502::set_dirty_tracking()
+inline void mark_dirty(uint64_t *dirty, const uint16_t address) {
+  dirty[address >> 14] |= 1ull << ((address >> 8) & 63);
+}
+
+class Recorder;
 
 class MOS6502 {
 public:
   explicit MOS6502(mem_access_callback mem_acc_clb, void *usr_data);
 
-  bool clock(); // Clock signal
-  void reset(); // Reset signal
-  void irq();   // Interrupt signal
-  void nmi();   // Non-maskable interrupt signal
+  // Clock signal. Return true at the end of an instruction, always if the cpu
+  // is halted (no cycle is counted then)
+  bool clock();
+
+  // Execute a whole instruction without going through the microcode queue.
+  // Return the number of cycles it took (also added to 'cycles'), 0 if the
+  // cpu is halted. If an instruction is in flight on the microcode engine it
+  // is completed instead
+  unsigned int step();
+
+  // Execute whole instructions, keeping the loop inside the library, until at
+  // least 'budget' cycles are consumed. The stop conditions are checked at the
+  // instruction boundaries so the run can exceed the budget by few cycles.
+  // Return the cycles actually executed and why the run stopped. A halted cpu
+  // (see 'halted') stops the run with stop_reason_t::HALT, at once if it is
+  // already halted
+  run_result_t run(const uint64_t budget);
+
+  // Like run() but stop also after the instruction that brings the PC to 'pc'
+  run_result_t run_until_pc(const uint16_t pc,
+                            const uint64_t budget = UINT64_MAX);
+
+  // Like run() but stop when the cycles counter reaches 'cycle'
+  run_result_t run_until_cycle(const uint64_t cycle);
+
+  // Like run() but stop also when 'predicate' returns true
+  run_result_t run_until(stop_predicate predicate, void *usr_data,
+                         const uint64_t budget = UINT64_MAX);
+
+  // Same as step() and the run functions above, but the instruction level
+  // engine accesses the memory through 'bus' instead of the mem_access
+  // callback, see bus.hpp. The Bus versions are defined in engine.hpp, include
+  // it to use them. An instruction in flight on the microcode engine is still
+  // completed through the callback
+  template <typename Bus> unsigned int step(Bus &bus);
+  template <typename Bus> run_result_t run(Bus &bus, const uint64_t budget);
+  template <typename Bus>
+  run_result_t run_until_pc(Bus &bus, const uint16_t pc,
+                            const uint64_t budget = UINT64_MAX);
+  template <typename Bus>
+  run_result_t run_until(Bus &bus, stop_predicate predicate, void *usr_data,
+                         const uint64_t budget = UINT64_MAX);
+
+  void reset(); // Reset signal, it also restarts a halted cpu
+
+  // Interrupt signals, ignored by a halted cpu. The interrupt is taken at the
+  // next instruction boundary, the IRQ only if the I flag is clear there. The
+  // interrupt sequence is executed like an instruction of 7 cycles (see
+  // MOS6502::IRQ), so step() and the run functions count it too
+  void irq();
+  void nmi();
+
+  // Interrupt lines of the devices, inactive by default. The IRQ line is
+  // level triggered: the interrupt is taken at every instruction boundary
+  // where the line is active and the I flag is clear. The NMI line is edge
+  // triggered: its activation takes one interrupt at the next instruction
+  // boundary. The run functions sample the lines after the events and after
+  // CLI, PLP and RTI, so they should be changed from the event callbacks (a
+  // change from mem_access is seen at the next event or run)
+  void set_irq_line(const bool active);
+  void set_nmi_line(const bool active);
+
+  // Call 'callback' when the cycles counter reaches 'cycle'. clock()
+  // dispatches the event before the cycle 'cycle' + 1, the run functions at
+  // the first instruction boundary at or after 'cycle': they execute up to
+  // the next event, dispatch it and go on, so the events do not stop the run.
+  // Return the id of the event for cancel_event()
+  uint64_t schedule(const uint64_t cycle, event_callback callback,
+                    void *usr_data);
+  // Remove a pending event, return false if it was already dispatched
+  bool cancel_event(const uint64_t id);
+  // Cycle of the next event, UINT64_MAX if there is none
+  uint64_t next_event() const;
 
   // Set the PC to specific memory address.
   // NOTE(max): debug/test
@@ -29,9 +117,101 @@ public:
   // NOTE(max): debug/test
   p_state_t get_status();
 
+  // Map the 'count' pages of 256 bytes starting from 'page' on the host memory
+  // 'mem'. The reads of the mapped pages do not call mem_access, the writes
+  // neither if 'writable', otherwise they still go to mem_access (e.g. ROM or
+  // to trap them). By default all the pages go to mem_access
+  void map_memory(const uint8_t page, const unsigned int count, uint8_t *mem,
+                  const bool writable = true);
+  // Give back the pages to mem_access, e.g. for memory mapped devices
+  void unmap_memory(const uint8_t page, const unsigned int count);
+  // Declare that the reads of the 'count' pages from 'page' through
+  // mem_access return the same values, without side effects, until the cycle
+  // 'until' (e.g. a device register that changes only at the next scheduled
+  // event). run() fast-forwards the idle loops polling them up to that cycle,
+  // see StepEngine. The mapped pages are always stable within a run. By
+  // default no page is declared, 0 removes the declaration. Ignored while a
+  // Recorder records the cpu
+  void set_stable_reads(const uint8_t page, const unsigned int count,
+                        const uint64_t until);
+
+  // Enable or disable the block cache of the instruction level engine,
+  // disabled by default. When enabled the engine decodes the straight-line
+  // runs of code once and then executes them from the cache, without fetching
+  // the opcodes and the operands from the memory. The writes of the cpu
+  // invalidate the cached code they hit (self-modifying code), the other
+  // changes of the code must be notified with invalidate_code(). The code
+  // should not be read from memory mapped devices, see block_cache.hpp
+  void set_block_cache(const bool enable);
+  // Invalidate the cached code of the 'count' pages from 'page', e.g. after
+  // loading a program or switching a bank. Mapping a page invalidates it
+  void invalidate_code(const uint8_t page, const unsigned int count);
+
+  // Enable or disable the JIT, disabled by default. When enabled (the block
+  // cache too) run() translates the hot blocks into native code and executes
+  // them without the interpreter, see jit.hpp. The memory mapped devices and
+  // the writes to the code still go through the interpreter. Return false if
+  // the host does not support the JIT
+  bool set_jit(const bool enable);
+
+  // Save the state of the cpu in 'out' (resized to fit): a small versioned
+  // binary blob without host pointers, with the registers, the latches, the
+  // position in the instruction in flight, the cycles counter and the
+  // interrupt signals. With 'memory' it also contains the image of the 64KB,
+  // copied from the mapped pages and read from mem_access with
+  // access_mode_t::READ_ONLY for the others. The scheduled events, the memory
+  // map and the settings (block cache, JIT, profiling...) are not saved, see
+  // state.cpp for the layout
+  void save_state(std::vector<uint8_t> &out, const bool memory = false) const;
+  // Restore a state of save_state(). Its memory image, if any, is written
+  // like write_pages() does.
+  // Return false, leaving the cpu unchanged, if the state is not valid
+  bool load_state(const uint8_t *data, const size_t size);
+
+  // Copy the 'count' pages from 'page' in 'out': the mapped pages directly,
+  // the others read from mem_access with access_mode_t::READ_ONLY
+  void read_pages(const uint8_t page, const unsigned int count,
+                  uint8_t *out) const;
+  // Copy 'in' in the 'count' pages from 'page': the pages mapped writable
+  // directly, the others written to mem_access (the read-only mapped pages
+  // too). The pages are marked dirty and their cached code is invalidated
+  void write_pages(const uint8_t page, const unsigned int count,
+                   const uint8_t *in);
+
+  // New cpu in the state of this one (the state of save_state(), without the
+  // memory) with the same memory map, callbacks, stable reads and profiling
+  // switch. The scheduled events are not copied, their callbacks refer to the
+  // devices of this cpu. The clone starts without the block cache and the
+  // JIT, so it costs only the copy of the state: enable them on the clones
+  // that run long enough. To fork the memory too attach the clone to a fork
+  // of the memory, see CowMemory::fork()
+  std::unique_ptr<MOS6502> clone() const;
+
+  // Enable or disable the dirty-page tracking, disabled by default. When
+  // enabled every write of the cpu (all the engines and the JIT, also the
+  // writes to mem_access) marks its page of 256 bytes in a bitmap of 256
+  // bits, so the consumers of the memory changes (snapshots, rewind,
+  // hashing...) touch only the modified pages. The host changes the memory
+  // by itself are not tracked, except through write_pages() and
+  // load_state(). Enabling the tracking clears the bitmap
+  void set_dirty_tracking(const bool enable);
+  // The bitmap, page 'n' is the bit 'n % 64' of the word 'n / 64'. Valid only
+  // while the tracking is enabled
+  const std::array<uint64_t, 4> &get_dirty_pages() const;
+  // True if 'page' was written since the bitmap was cleared
+  bool is_page_dirty(const uint8_t page) const;
+  void clear_dirty_pages();
+
   // Set the callback used for log. Not mandatory
   void set_log_callback(log_callback);
 
+  // Enable or disable the profiling, disabled by default. When enabled the
+  // host time is collected per opcode and per step()/run call, see profile_t.
+  // When disabled the run loops do not contain any profiling code
+  void set_profiling(const bool enable);
+  const profile_t &get_profile() const;
+  void clear_profile();
+
 public:
   /********************************************************
    *                  REGISTERS / FLAGS                   *
@@ -52,6 +232,10 @@ public:
   uint8_t S = STACK_POINTER_DEFAULT; // Stack pointer
   uint16_t PC = 0x0000;              // Program counter
 
+  // The cpu executed a JAM (KIL) opcode and is locked up, PC is the address
+  // of the opcode. Only reset() restarts it
+  bool halted = false;
+
   /********************************************************
    *                    DATA STRUCTURES                   *
    ********************************************************/
@@ -66,16 +250,22 @@ public:
     C = (1 << 0)       // C:  CARRY                1 = True
   };
 
-  typedef void (MOS6502::*operation_t)(void);
-  typedef void (MOS6502::*addrmode_t)(void);
   typedef void (*micro_op_t)(MOS6502 *self);
 
-  struct instruction_t { // INSTRUCTION
-    const std::string name;
-    const operation_t operation;
-    const addrmode_t addrmode;
-    const unsigned int cycles;
-    const unsigned int instruction_bytes;
+  // Static microcode program of an addressing mode or of an operation, one
+  // micro-op per cycle after the opcode fetch
+  struct microcode_t {
+    micro_op_t steps[MICROCODE_MAX_STEPS];
+    uint8_t length;
+    bool own_addressing; // The operation does not use the addressing microcode
+  };
+
+  typedef const microcode_t *operation_t;
+  typedef const microcode_t *addrmode_t;
+
+  struct instruction_t { // INSTRUCTION microcode
+    operation_t operation;
+    addrmode_t addrmode;
   };
 
   /********************************************************
@@ -87,6 +277,36 @@ public:
   // User passed like first argument to the mem_access
   void *user_data = nullptr;
 
+  // Memory map, one entry per page (high byte of the address). The pages
+  // without host memory go to mem_access
+  std::array<mem_page_t, 256> page_table = {};
+
+  // Pending events, see schedule()
+  Scheduler scheduler;
+
+  bool irq_line = false;    // See set_irq_line()
+  bool nmi_line = false;    // See set_nmi_line()
+  bool nmi_pending = false; // The NMI line was activated, not yet taken
+  bool irq_request = false; // irq() was called, not yet polled
+
+  // Cycle until which the reads of the page through mem_access are stable,
+  // one per page. See set_stable_reads()
+  std::array<uint64_t, 256> stable_reads = {};
+
+  // Decoded code of the instruction level engine, nullptr if disabled. See
+  // set_block_cache()
+  std::unique_ptr<BlockCache> block_cache;
+
+  // Native code of the hot blocks, nullptr if disabled. See set_jit()
+  std::unique_ptr<Jit> jit;
+
+  // Pages written since the last clear, see set_dirty_tracking()
+  bool dirty_tracking = false;
+  std::array<uint64_t, 4> dirty_pages = {};
+
+  // Recorder of the inputs, nullptr if not recording. See record.hpp
+  Recorder *recorder = nullptr;
+
   uint8_t opcode;                         // Current opcode
   const instruction_t *instruction;       // Current instruction
   uint8_t data_bus;                       // Data currently on the bus
@@ -100,15 +320,22 @@ public:
   uint16_t tmp_buff; // Temporary 16-bit buffer
   uint16_t hi;
   uint16_t lo;
-  uint32_t cycles = 0;
-  int64_t time; // Time that this cycle take to execute in ms
-
-  // The vector containing the opcode and addressing fuctions and info.
-  // The vector is 256 size long and the opcode byte match the correct
-  // addressing mode and function
-  static const std::vector<instruction_t> opcode_table;
-
-  Queue<micro_op_t, 10> microcode_q;
+  uint64_t cycles = 0;
+
+  // The array containing the opcode and addressing fuctions. The opcode byte
+  // match the correct addressing mode and function. The opcode info (name,
+  // cycles, size...) are in the constexpr opcode_table, see opcode.hpp
+  static const std::array<instruction_t, 256> instruction_table;
+  // Taken instead of the next instruction by an interrupt, see IRQ and NMI
+  static const instruction_t irq_instruction;
+  static const instruction_t nmi_instruction;
+
+  // The instruction in flight executes the addressing microcode and then the
+  // operation microcode. 'microcode_step' is the next micro-op to execute, the
+  // instruction is completed when it reaches 'microcode_len'
+  uint8_t microcode_step = 0;
+  uint8_t microcode_len = 0;
+  uint8_t addrmode_len = 0; // Micro-ops of the addressing microcode
 
   /********************************************************
    *                     DEBUG / TEST                     *
@@ -121,18 +348,59 @@ public:
   // Callback used to log. Can be setted by set_log_callback()
   log_callback log_func = nullptr;
 
+  bool profiling = false;     // Collect the profile. See set_profiling()
+  profile_t profile = {};     // Profile collected so far
+  uint64_t instruction_ticks; // Host ticks at the current instruction fetch
+
   /********************************************************
    *                    UTIL FUNCTIONS                    *
    ********************************************************/
   void set_flag(const status_flag_t flag, const bool val);
   bool read_flag(const status_flag_t flag);
+  // Set the flags in 'mask' from the 'flags' of an ALU table (see alu.hpp)
+  void set_alu_flags(const uint8_t mask, const uint8_t flags);
+  // Set Z and N from 'val'
+  void set_ZN(const uint8_t val);
+  // A = A + 'val' + C, with C, O, Z and N. SBC is the ADC of ~M
+  void add(const uint8_t val);
+  // Shift or rotate data_bus into tmp_buff through 'table', with C, Z and N
+  void shift(const shift_table_t &table);
+  // Read or write 'data' at 'address' through the page table
+  void bus_access(const uint16_t address, const access_mode_t read_write,
+                  uint8_t &data);
   void mem_read();
   void mem_write();
 
-  bool is_read_instruction();
+  // Execute now the next micro-op of the instruction in flight, if any
+  void exec_micro_op();
+  // Complete the instruction in flight without executing the remaining
+  // micro-ops (e.g. branch not taken)
+  void skip_microcode();
+
+  // Complete the instruction in flight on the microcode engine, if any
+  void complete_instruction();
+
+  // Lock up the cpu on the JAM opcode just fetched, see 'halted'
+  void halt();
+
+  // Call the callbacks of the events due at the current cycle
+  void dispatch_events();
+  // Bus of the callback API over the page table and the stable reads
+  PageTableBus page_table_bus() const;
+  // Called at an instruction boundary, return the vector (BRK_PCL or
+  // NMI_PCL) of the interrupt to take there, 0 if none. The pending NMI and
+  // the irq() request are consumed
+  uint16_t poll_interrupts();
+
+  // Complete the instruction in flight, then execute 'run' on the instruction
+  // level engine over 'bus' (the CACHED one if the block cache is enabled) and
+  // collect the per-run profiling. The run is split at the scheduled events,
+  // which are dispatched between the 'run' calls
+  template <typename Bus, typename F>
+  run_result_t run_engine(Bus &bus, const uint64_t budget, F run);
 
 public:
-  void log(const std::string &msg);
+  void log(const std::string &msg) const;
 
   /********************************************************
    *                  ADDRESSING MODES                    *
@@ -140,118 +408,126 @@ public:
 
   // clang-format off
 
-  void ACC();         //                (???)Accumulator addressing:          1-byte instruction on accumulator
-  void IMM();         // #$BB           (IMM)Immediate address:               the 2d byte of instruction is the operand
-  void ABS();         // $LLHH          (ABS)Abbsolute addressing:            the 2d byte of instruction is the 8 low order bits of the address, 3d is the 8 high order bits (64k total addresses)
-  void ZPI();         // $LL            (ZP0)Zero page addressing:            fetch only the 2d byte of the instruction. Assuming the high byte is 0
-  void ZPX();         // $LL,X          (ZPX)Indexed zero page addressing X:  the X register is added to the 2d byte. The high byte is 0. No carry is added to high byte, so no page overlapping
-  void ZPY();         // $LL,Y          (ZPY)Indexed zero page addressing Y:  Same as in ZPX but with Y register
-  void ABX();         // $LLHH,X        (ABX)Indexed abbsolute addressing X:  Adding to X the one absolute address
-  void ABY();         // $LLHH,X        (ABY)Indexed abbsolute addressing Y:  Same as in ABX but with Y register
-  void IMP();         //                (IMP)Implied addressing:              The address is implicit in the opcode
-  void REL();         // $BB            (REL)Relative addressing:             The 2d byte is the branch offset. If the branch is taken, the new address will the the current PC plus the offset.
-  //                                                                          The offset is a signed byte, so it can jump a maximum of 127 bytes forward, or 128 bytes backward
-  void IIX();         // ($LL,X)        (IZX)Indexed indirect addressing:     The 2d byte is added to the X discarding the carry.
-  //                                                                          The result point to the ZERO PAGE address which contains the low order byte of the effective address,
-  //                                                                          the next memory location on PAGE ZERO contains the high order byte of the effective address.
-  //                                                                     ex:  [LDA ($20,X)] (where is X = $04). X is added so $20 -> $24. Then fetch the $24 -> 0024: 7421.
-  //                                                                          The fetched 2171 (little endian) from the memory location 0024 is the actual address to be used to load the content into the register A.
-  //                                                                          So id in $2171: 124 then A = 124
-  //                                                                          formula: target_address = (X + opcode[1]) & 0xFF
-  void IIY();         // ($LL),Y        (IZY)Indirect indexed addressing:     Y is applied to the indirectly fetched address.
-  //                                                                     ex:  [LDA ($86),Y] (where in $0086: 28 40). First fetch the address located at $0086, add that address to the Y register to get
-  //                                                                          the final address. So the address will be $4028 (little endian) and Y is $10 then the final address is
-  //                                                                          $4038 ad A will be loaded with the content of the address $4038
-  void IND();         // ($LLHH)        (IND)Absolute indirect:               The 2d byte contain the low byte of address, the 3d byte contain the high byte of the address.
-  //                                                                          The loaded address contain the low byte fo the final addrss and the followed the high byte of the final address
+  static const microcode_t ACC;     //                (???)Accumulator addressing:          1-byte instruction on accumulator
+  static const microcode_t IMM;     // #$BB           (IMM)Immediate address:               the 2d byte of instruction is the operand
+  static const microcode_t ABS;     // $LLHH          (ABS)Abbsolute addressing:            the 2d byte of instruction is the 8 low order bits of the address, 3d is the 8 high order bits (64k total addresses)
+  static const microcode_t ZPI;     // $LL            (ZP0)Zero page addressing:            fetch only the 2d byte of the instruction. Assuming the high byte is 0
+  static const microcode_t ZPX;     // $LL,X          (ZPX)Indexed zero page addressing X:  the X register is added to the 2d byte. The high byte is 0. No carry is added to high byte, so no page overlapping
+  static const microcode_t ZPY;     // $LL,Y          (ZPY)Indexed zero page addressing Y:  Same as in ZPX but with Y register
+  static const microcode_t ABX;     // $LLHH,X        (ABX)Indexed abbsolute addressing X:  Adding to X the one absolute address
+  static const microcode_t ABY;     // $LLHH,X        (ABY)Indexed abbsolute addressing Y:  Same as in ABX but with Y register
+  static const microcode_t IMP;     //                (IMP)Implied addressing:              The address is implicit in the opcode
+  static const microcode_t REL;     // $BB            (REL)Relative addressing:             The 2d byte is the branch offset. If the branch is taken, the new address will the the current PC plus the offset.
+  //                                                                                        The offset is a signed byte, so it can jump a maximum of 127 bytes forward, or 128 bytes backward
+  static const microcode_t IIX;     // ($LL,X)        (IZX)Indexed indirect addressing:     The 2d byte is added to the X discarding the carry.
+  //                                                                                        The result point to the ZERO PAGE address which contains the low order byte of the effective address,
+  //                                                                                        the next memory location on PAGE ZERO contains the high order byte of the effective address.
+  //                                                                                   ex:  [LDA ($20,X)] (where is X = $04). X is added so $20 -> $24. Then fetch the $24 -> 0024: 7421.
+  //                                                                                        The fetched 2171 (little endian) from the memory location 0024 is the actual address to be used to load the content into the register A.
+  //                                                                                        So id in $2171: 124 then A = 124
+  //                                                                                        formula: target_address = (X + opcode[1]) & 0xFF
+  static const microcode_t IIY;     // ($LL),Y        (IZY)Indirect indexed addressing:     Y is applied to the indirectly fetched address.
+  //                                                                                   ex:  [LDA ($86),Y] (where in $0086: 28 40). First fetch the address located at $0086, add that address to the Y register to get
+  //                                                                                        the final address. So the address will be $4028 (little endian) and Y is $10 then the final address is
+  //                                                                                        $4038 ad A will be loaded with the content of the address $4038
+  static const microcode_t IND;     // ($LLHH)        (IND)Absolute indirect:               The 2d byte contain the low byte of address, the 3d byte contain the high byte of the address.
+  //                                                                                        The loaded address contain the low byte fo the final addrss and the followed the high byte of the final address
 
   /********************************************************
    *                   INSTRUCTION SET                    *
     ********************************************************/
-  void ADC();         // Add memory to A with Carry
-  void AND();         // "AND" memory with accumulator
-  void ASL();         // Shift LEFT 1 bit (memory or A)
-
-  void BCC();         // Branch on Carry Clear
-  void BCS();         // Branch on Carry Set
-  void BEQ();         // Branch on Result Zero
-  void BIT();         // Test Bits in Memory with A
-  void BMI();         // Branch on Result Minus
-  void BNE();         // Branch on Result not Zero
-  void BPL();         // Branch on Result Plus
-  void BRK();         // Force Break
-  void BVC();         // Branch on Overflow Clear
-  void BVS();         // Branch on Overflow Set
-
-  void CLC();         // Clear Carry Flag
-  void CLD();         // Clear Decimal Mode
-  void CLI();         // Clear Interrupt Disable Bit
-  void CLV();         // Clear Overflow Flag
-  void CMP();         // Compare Memory and accumulator
-  void CPX();         // Compare Memory and X
-  void CPY();         // Compare Memory and Y
-
-  void DEC();         // Decrement Memory by 1
-  void DEX();         // Decrement Index X by 1
-  void DEY();         // Decrement Index Y by 1
-
-  void EOR();         // "Exclusive-OR" Memory with A
-
-  void INC();         // Increment Memory by 1
-  void INX();         // Increment Index X by 1
-  void INY();         // Increment Index  by 1
-
-  void JMP();         // Jump to New Location
-  void JSR();         // Jump to New Location Saving Return Address
-
-  void LDA();         // Load A with the Memory
-  void LDX();         // Load X with the Memory
-  void LDY();         // Load Y with the Memory
-  void LSR();         // Shift 1 bit RIGHT (Memory or A)
-
-  void NOP();         // No Operation
-  void NO2();         // No Operation (this one take 2 instruction to execute)
-
-  void ORA();         // "OR" Memory with the A
-
-  void PHA();         // Push A on Stack
-  void PHP();         // Push P on Stack
-  void PLA();         // Pull A from Stack
-  void PLP();         // Pull P from Stack
-
-  void ROL();         // Rotate 1 bit LEFT (Memory or Accumulator)
-  void ROR();         // Rotate 1 bit RIGHT (Memory or Accumulator)
-  void RTI();         // Return from Interrupt
-  void RTS();         // Return from Subroutine
-
-  void SBC();         // Subtract Memory from Accumulator with Borrow
-  void SEC();         // Set Carry Flag
-  void SED();         // Set Decimal Mode
-  void SEI();         // Set Interrupt Disable Status
-  void STA();         // Store A in Memory
-  void STX();         // Store Index X in Memory
-  void STY();         // Store Index Y in Memory
-
-  void TAX();         // Transfer A to Index X
-  void TAY();         // Transfer A to Index Y
-  void TSX();         // Transfer S (Stack Pointer) to Index X
-  void TXA();         // Transfer Index X to A
-  void TXS();         // Transfer Index X to Stack Register
-  void TYA();         // Transfer Index Y to A
+  static const microcode_t ADC;     // Add memory to A with Carry
+  static const microcode_t AND;     // "AND" memory with accumulator
+  static const microcode_t ASL;     // Shift LEFT 1 bit (memory or A)
+
+  static const microcode_t BCC;     // Branch on Carry Clear
+  static const microcode_t BCS;     // Branch on Carry Set
+  static const microcode_t BEQ;     // Branch on Result Zero
+  static const microcode_t BIT;     // Test Bits in Memory with A
+  static const microcode_t BMI;     // Branch on Result Minus
+  static const microcode_t BNE;     // Branch on Result not Zero
+  static const microcode_t BPL;     // Branch on Result Plus
+  static const microcode_t BRK;     // Force Break
+  static const microcode_t BVC;     // Branch on Overflow Clear
+  static const microcode_t BVS;     // Branch on Overflow Set
+
+  static const microcode_t CLC;     // Clear Carry Flag
+  static const microcode_t CLD;     // Clear Decimal Mode
+  static const microcode_t CLI;     // Clear Interrupt Disable Bit
+  static const microcode_t CLV;     // Clear Overflow Flag
+  static const microcode_t CMP;     // Compare Memory and accumulator
+  static const microcode_t CPX;     // Compare Memory and X
+  static const microcode_t CPY;     // Compare Memory and Y
+
+  static const microcode_t DEC;     // Decrement Memory by 1
+  static const microcode_t DEX;     // Decrement Index X by 1
+  static const microcode_t DEY;     // Decrement Index Y by 1
+
+  static const microcode_t EOR;     // "Exclusive-OR" Memory with A
+
+  static const microcode_t INC;     // Increment Memory by 1
+  static const microcode_t INX;     // Increment Index X by 1
+  static const microcode_t INY;     // Increment Index  by 1
+
+  static const microcode_t JMP;     // Jump to New Location
+  static const microcode_t JMP_IND; // Jump to New Location, indirect
+  static const microcode_t JSR;     // Jump to New Location Saving Return Address
+
+  static const microcode_t LDA;     // Load A with the Memory
+  static const microcode_t LDX;     // Load X with the Memory
+  static const microcode_t LDY;     // Load Y with the Memory
+  static const microcode_t LSR;     // Shift 1 bit RIGHT (Memory or A)
+
+  static const microcode_t NOP;     // No Operation
+  static const microcode_t NO2;     // No Operation (this one take 2 instruction to execute)
+
+  static const microcode_t ORA;     // "OR" Memory with the A
+
+  static const microcode_t PHA;     // Push A on Stack
+  static const microcode_t PHP;     // Push P on Stack
+  static const microcode_t PLA;     // Pull A from Stack
+  static const microcode_t PLP;     // Pull P from Stack
+
+  static const microcode_t ROL;     // Rotate 1 bit LEFT (Memory or Accumulator)
+  static const microcode_t ROR;     // Rotate 1 bit RIGHT (Memory or Accumulator)
+  static const microcode_t RTI;     // Return from Interrupt
+  static const microcode_t RTS;     // Return from Subroutine
+
+  static const microcode_t SBC;     // Subtract Memory from Accumulator with Borrow
+  static const microcode_t SEC;     // Set Carry Flag
+  static const microcode_t SED;     // Set Decimal Mode
+  static const microcode_t SEI;     // Set Interrupt Disable Status
+  static const microcode_t STA;     // Store A in Memory
+  static const microcode_t STX;     // Store Index X in Memory
+  static const microcode_t STY;     // Store Index Y in Memory
+
+  static const microcode_t TAX;     // Transfer A to Index X
+  static const microcode_t TAY;     // Transfer A to Index Y
+  static const microcode_t TSX;     // Transfer S (Stack Pointer) to Index X
+  static const microcode_t TXA;     // Transfer Index X to A
+  static const microcode_t TXS;     // Transfer Index X to Stack Register
+  static const microcode_t TYA;     // Transfer Index Y to A
 
   /********************************************************
    *                  ILLEGAL INST SET                    *
     ********************************************************/
-  void LAX();         // Loads a value from an absolute address in memory and stores it in A and X at the same time
-  void SAX();         // Stores the bitwise AND of A and X. As with STA and STX, no flags are affected.
-  void DCP();         // Equivalent to DEC value then CMP value, except supporting more addressing modes. LDA #$FF followed by DCP can be used to check if the decrement underflows, which is useful for multi-byte decrements.
-  void ISB(); // ISC  // Equivalent to INC value then SBC value, except supporting more addressing modes.
-  void SLO();         // Equivalent to ASL value then ORA value, except supporting more addressing modes. LDA #0 followed by SLO is an efficient way to shift a variable while also loading it in A.
-  void RLA();         // Equivalent to ROL value then AND value, except supporting more addressing modes. LDA #$FF followed by RLA is an efficient way to rotate a variable while also loading it in A.
-  void SRE();         // Equivalent to LSR value then EOR value, except supporting more addressing modes. LDA #0 followed by SRE is an efficient way to shift a variable while also loading it in A.
-  void RRA();         // Equivalent to ROR value then ADC value, except supporting more addressing modes. Essentially this computes A + value / 2, where value is 9-bit and the division is rounded up.
-
-  void XXX();         // Illegal instruction
+  static const microcode_t LAX;     // Loads a value from an absolute address in memory and stores it in A and X at the same time
+  static const microcode_t SAX;     // Stores the bitwise AND of A and X. As with STA and STX, no flags are affected.
+  static const microcode_t DCP;     // Equivalent to DEC value then CMP value, except supporting more addressing modes. LDA #$FF followed by DCP can be used to check if the decrement underflows, which is useful for multi-byte decrements.
+  static const microcode_t ISB;     // ISC  // Equivalent to INC value then SBC value, except supporting more addressing modes.
+  static const microcode_t SLO;     // Equivalent to ASL value then ORA value, except supporting more addressing modes. LDA #0 followed by SLO is an efficient way to shift a variable while also loading it in A.
+  static const microcode_t RLA;     // Equivalent to ROL value then AND value, except supporting more addressing modes. LDA #$FF followed by RLA is an efficient way to rotate a variable while also loading it in A.
+  static const microcode_t SRE;     // Equivalent to LSR value then EOR value, except supporting more addressing modes. LDA #0 followed by SRE is an efficient way to shift a variable while also loading it in A.
+  static const microcode_t RRA;     // Equivalent to ROR value then ADC value, except supporting more addressing modes. Essentially this computes A + value / 2, where value is 9-bit and the division is rounded up.
+
+  static const microcode_t JAM;     // Halt the cpu (KIL), only the reset restarts it
+  static const microcode_t XXX;     // Illegal instruction
+
+  /********************************************************
+   *                 INTERRUPT SEQUENCES                  *
+    ********************************************************/
+  static const microcode_t IRQ;     // Interrupt request, the bus pattern of BRK without the PC increment and with the B flag clear
+  static const microcode_t NMI;     // Non-maskable interrupt, as IRQ but from the NMI vector
 
   // clang-format on
 };
\ No newline at end of file
@@ -2,29 +2,29 @@
 
 using M = MOS6502;
 
-// TODO(max): fix the illegal (*) opcode cycles numbers according to:
-// https://wiki.nesdev.com/w/index.php/Programming_with_unofficial_opcodes
-
 // clang-format off
-const std::vector<MOS6502::instruction_t> MOS6502::opcode_table = {
-    //                    0                                  1                                  2                                    3                                   4                                        5                                  6                                   7                                  8                                  9                                         A                                   B                                   C                                  D                                  E                                   F
-    /*0*/ { "BRK",  &M::BRK, &M::IMP, 7, 1 }, { "ORA", &M::ORA, &M::IIX, 6, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*SLO",  &M::SLO, &M::IIX, 8, 2 }, { "*NOP", &M::NO2, &M::IMM, 3, 2 }, /*0*/ { "ORA", &M::ORA, &M::ZPI, 3, 2 }, { "ASL", &M::ASL, &M::ZPI, 5, 2 }, { "*SLO", &M::SLO, &M::ZPI, 5, 2 }, { "PHP", &M::PHP, &M::IMP, 3, 1 }, { "ORA", &M::ORA, &M::IMM, 2, 2 }, /*0*/ { "ASL",  &M::ASL, &M::ACC, 2, 1 }, { "???",  &M::XXX, &M::IMP, 2, 0 }, { "*NOP", &M::NOP, &M::ABS, 4, 3 }, { "ORA", &M::ORA, &M::ABS, 4, 3 }, { "ASL", &M::ASL, &M::ABS, 6, 3 }, { "*SLO", &M::SLO, &M::ABS, 6, 3 }, /*0*/
-    /*1*/ { "BPL",  &M::BPL, &M::REL, 2, 2 }, { "ORA", &M::ORA, &M::IIY, 5, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*SLO",  &M::SLO, &M::IIY, 8, 2 }, { "*NOP", &M::NOP, &M::ZPX, 4, 2 }, /*1*/ { "ORA", &M::ORA, &M::ZPX, 4, 2 }, { "ASL", &M::ASL, &M::ZPX, 6, 2 }, { "*SLO", &M::SLO, &M::ZPX, 6, 2 }, { "CLC", &M::CLC, &M::IMP, 2, 1 }, { "ORA", &M::ORA, &M::ABY, 4, 3 }, /*1*/ { "*NOP", &M::NOP, &M::IMP, 2, 1 }, { "*SLO", &M::SLO, &M::ABY, 7, 3 }, { "*NOP", &M::NOP, &M::ABX, 2, 3 }, { "ORA", &M::ORA, &M::ABX, 4, 3 }, { "ASL", &M::ASL, &M::ABX, 7, 3 }, { "*SLO", &M::SLO, &M::ABX, 7, 3 }, /*1*/
-    /*2*/ { "JSR",  &M::JSR, &M::ABS, 6, 3 }, { "AND", &M::AND, &M::IIX, 6, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*RLA",  &M::RLA, &M::IIX, 8, 2 }, { "BIT",  &M::BIT, &M::ZPI, 3, 2 }, /*2*/ { "AND", &M::AND, &M::ZPI, 3, 2 }, { "ROL", &M::ROL, &M::ZPI, 5, 2 }, { "*RLA", &M::RLA, &M::ZPI, 5, 2 }, { "PLP", &M::PLP, &M::IMP, 4, 1 }, { "AND", &M::AND, &M::IMM, 2, 2 }, /*2*/ { "ROL",  &M::ROL, &M::ACC, 2, 1 }, { "???",  &M::XXX, &M::IMP, 2, 0 }, { "BIT",  &M::BIT, &M::ABS, 4, 3 }, { "AND", &M::AND, &M::ABS, 4, 3 }, { "ROL", &M::ROL, &M::ABS, 6, 3 }, { "*RLA", &M::RLA, &M::ABS, 6, 3 }, /*2*/
-    /*3*/ { "BMI",  &M::BMI, &M::REL, 2, 2 }, { "AND", &M::AND, &M::IIY, 5, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*RLA",  &M::RLA, &M::IIY, 8, 2 }, { "*NOP", &M::NO2, &M::ZPI, 3, 2 }, /*3*/ { "AND", &M::AND, &M::ZPX, 4, 2 }, { "ROL", &M::ROL, &M::ZPX, 6, 2 }, { "*RLA", &M::RLA, &M::ZPX, 6, 2 }, { "SEC", &M::SEC, &M::IMP, 2, 1 }, { "AND", &M::AND, &M::ABY, 4, 3 }, /*3*/ { "*NOP", &M::NOP, &M::IMP, 2, 1 }, { "*RLA", &M::RLA, &M::ABY, 7, 3 }, { "*NOP", &M::NOP, &M::ABX, 2, 3 }, { "AND", &M::AND, &M::ABX, 4, 3 }, { "ROL", &M::ROL, &M::ABX, 7, 3 }, { "*RLA", &M::RLA, &M::ABX, 7, 3 }, /*3*/
-    /*4*/ { "RTI",  &M::RTI, &M::IMP, 6, 1 }, { "EOR", &M::EOR, &M::IIX, 6, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*SRE",  &M::SRE, &M::IIX, 8, 2 }, { "*NOP", &M::NO2, &M::IMM, 3, 2 }, /*4*/ { "EOR", &M::EOR, &M::ZPI, 3, 2 }, { "LSR", &M::LSR, &M::ZPI, 5, 2 }, { "*SRE", &M::SRE, &M::ZPI, 5, 2 }, { "PHA", &M::PHA, &M::IMP, 3, 1 }, { "EOR", &M::EOR, &M::IMM, 2, 2 }, /*4*/ { "LSR",  &M::LSR, &M::ACC, 2, 1 }, { "???",  &M::XXX, &M::IMP, 2, 0 }, { "JMP",  &M::JMP, &M::ABS, 3, 3 }, { "EOR", &M::EOR, &M::ABS, 4, 3 }, { "LSR", &M::LSR, &M::ABS, 6, 3 }, { "*SRE", &M::SRE, &M::ABS, 6, 3 }, /*4*/
-    /*5*/ { "BVC",  &M::BVC, &M::REL, 2, 2 }, { "EOR", &M::EOR, &M::IIY, 5, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*SRE",  &M::SRE, &M::IIY, 8, 2 }, { "*NOP", &M::NO2, &M::ZPI, 3, 2 }, /*5*/ { "EOR", &M::EOR, &M::ZPX, 4, 2 }, { "LSR", &M::LSR, &M::ZPX, 6, 2 }, { "*SRE", &M::SRE, &M::ZPX, 6, 2 }, { "CLI", &M::CLI, &M::IMP, 2, 1 }, { "EOR", &M::EOR, &M::ABY, 4, 3 }, /*5*/ { "*NOP", &M::NOP, &M::IMP, 2, 1 }, { "*SRE", &M::SRE, &M::ABY, 7, 3 }, { "*NOP", &M::NOP, &M::ABX, 2, 3 }, { "EOR", &M::EOR, &M::ABX, 4, 3 }, { "LSR", &M::LSR, &M::ABX, 7, 3 }, { "*SRE", &M::SRE, &M::ABX, 7, 3 }, /*5*/
-    /*6*/ { "RTS",  &M::RTS, &M::IMP, 6, 1 }, { "ADC", &M::ADC, &M::IIX, 6, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*RRA",  &M::RRA, &M::IIX, 8, 2 }, { "*NOP", &M::NO2, &M::IMM, 3, 2 }, /*6*/ { "ADC", &M::ADC, &M::ZPI, 3, 2 }, { "ROR", &M::ROR, &M::ZPI, 5, 2 }, { "*RRA", &M::RRA, &M::ZPI, 5, 2 }, { "PLA", &M::PLA, &M::IMP, 4, 1 }, { "ADC", &M::ADC, &M::IMM, 2, 2 }, /*6*/ { "ROR",  &M::ROR, &M::ACC, 2, 1 }, { "???",  &M::XXX, &M::IMP, 2, 0 }, { "JMP",  &M::JMP, &M::IND, 5, 3 }, { "ADC", &M::ADC, &M::ABS, 4, 3 }, { "ROR", &M::ROR, &M::ABS, 6, 3 }, { "*RRA", &M::RRA, &M::ABS, 6, 3 }, /*6*/
-    /*7*/ { "BVS",  &M::BVS, &M::REL, 2, 2 }, { "ADC", &M::ADC, &M::IIY, 5, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*RRA",  &M::RRA, &M::IIY, 8, 2 }, { "*NOP", &M::NO2, &M::ZPI, 3, 2 }, /*7*/ { "ADC", &M::ADC, &M::ZPX, 4, 2 }, { "ROR", &M::ROR, &M::ZPX, 6, 2 }, { "*RRA", &M::RRA, &M::ZPX, 6, 2 }, { "SEI", &M::SEI, &M::IMP, 2, 1 }, { "ADC", &M::ADC, &M::ABY, 4, 3 }, /*7*/ { "*NOP", &M::NOP, &M::IMP, 2, 1 }, { "*RRA", &M::RRA, &M::ABY, 7, 3 }, { "*NOP", &M::NOP, &M::ABX, 2, 3 }, { "ADC", &M::ADC, &M::ABX, 4, 3 }, { "ROR", &M::ROR, &M::ABX, 7, 3 }, { "*RRA", &M::RRA, &M::ABX, 7, 3 }, /*7*/
-    /*8*/ { "*NOP", &M::NOP, &M::IMM, 2, 2 }, { "STA", &M::STA, &M::IIX, 6, 2 }, { "???", &M::NOP, &M::IMP, 2, 1 }, { "*SAX",  &M::SAX, &M::IIX, 6, 2 }, { "STY",  &M::STY, &M::ZPI, 3, 2 }, /*8*/ { "STA", &M::STA, &M::ZPI, 3, 2 }, { "STX", &M::STX, &M::ZPI, 3, 2 }, { "*SAX", &M::SAX, &M::ZPI, 3, 2 }, { "DEY", &M::DEY, &M::IMP, 2, 1 }, { "???", &M::NOP, &M::IMP, 2, 1 }, /*8*/ { "TXA",  &M::TXA, &M::IMP, 2, 1 }, { "???",  &M::XXX, &M::IMP, 2, 0 }, { "STY",  &M::STY, &M::ABS, 4, 3 }, { "STA", &M::STA, &M::ABS, 4, 3 }, { "STX", &M::STX, &M::ABS, 4, 3 }, { "*SAX", &M::SAX, &M::ABS, 4, 3 }, /*8*/
-    /*9*/ { "BCC",  &M::BCC, &M::REL, 2, 2 }, { "STA", &M::STA, &M::IIY, 6, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "???",   &M::XXX, &M::IMP, 6, 0 }, { "STY",  &M::STY, &M::ZPX, 4, 2 }, /*9*/ { "STA", &M::STA, &M::ZPX, 4, 2 }, { "STX", &M::STX, &M::ZPY, 4, 2 }, { "*SAX", &M::SAX, &M::ZPY, 4, 2 }, { "TYA", &M::TYA, &M::IMP, 2, 1 }, { "STA", &M::STA, &M::ABY, 5, 3 }, /*9*/ { "TXS",  &M::TXS, &M::IMP, 2, 1 }, { "???",  &M::XXX, &M::IMP, 5, 0 }, { "???",  &M::NOP, &M::IMP, 5, 1 }, { "STA", &M::STA, &M::ABX, 5, 3 }, { "???", &M::XXX, &M::IMP, 5, 0 }, { "???",  &M::XXX, &M::IMP, 5, 0 }, /*9*/
-    /*A*/ { "LDY",  &M::LDY, &M::IMM, 2, 2 }, { "LDA", &M::LDA, &M::IIX, 6, 2 }, { "LDX", &M::LDX, &M::IMM, 2, 2 }, { "*LAX",  &M::LAX, &M::IIX, 6, 2 }, { "LDY",  &M::LDY, &M::ZPI, 3, 2 }, /*A*/ { "LDA", &M::LDA, &M::ZPI, 3, 2 }, { "LDX", &M::LDX, &M::ZPI, 3, 2 }, { "*LAX", &M::LAX, &M::ZPI, 6, 2 }, { "TAY", &M::TAY, &M::IMP, 2, 1 }, { "LDA", &M::LDA, &M::IMM, 2, 2 }, /*A*/ { "TAX",  &M::TAX, &M::IMP, 2, 1 }, { "???",  &M::XXX, &M::IMP, 2, 0 }, { "LDY",  &M::LDY, &M::ABS, 4, 3 }, { "LDA", &M::LDA, &M::ABS, 4, 3 }, { "LDX", &M::LDX, &M::ABS, 4, 3 }, { "*LAX", &M::LAX, &M::ABS, 4, 3 }, /*A*/
-    /*B*/ { "BCS",  &M::BCS, &M::REL, 2, 2 }, { "LDA", &M::LDA, &M::IIY, 5, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*LAX",  &M::LAX, &M::IIY, 5, 2 }, { "LDY",  &M::LDY, &M::ZPX, 4, 2 }, /*B*/ { "LDA", &M::LDA, &M::ZPX, 4, 2 }, { "LDX", &M::LDX, &M::ZPY, 4, 2 }, { "*LAX", &M::LAX, &M::ZPY, 4, 2 }, { "CLV", &M::CLV, &M::IMP, 2, 1 }, { "LDA", &M::LDA, &M::ABY, 4, 3 }, /*B*/ { "TSX",  &M::TSX, &M::IMP, 2, 1 }, { "???",  &M::XXX, &M::IMP, 4, 0 }, { "LDY",  &M::LDY, &M::ABX, 4, 3 }, { "LDA", &M::LDA, &M::ABX, 4, 3 }, { "LDX", &M::LDX, &M::ABY, 4, 3 }, { "*LAX", &M::LAX, &M::ABY, 4, 3 }, /*B*/
-    /*C*/ { "CPY",  &M::CPY, &M::IMM, 2, 2 }, { "CMP", &M::CMP, &M::IIX, 6, 2 }, { "???", &M::NOP, &M::IMP, 2, 1 }, { "*DCP",  &M::DCP, &M::IIX, 6, 2 }, { "CPY",  &M::CPY, &M::ZPI, 3, 2 }, /*C*/ { "CMP", &M::CMP, &M::ZPI, 3, 2 }, { "DEC", &M::DEC, &M::ZPI, 5, 2 }, { "*DCP", &M::DCP, &M::ZPI, 5, 2 }, { "INY", &M::INY, &M::IMP, 2, 1 }, { "CMP", &M::CMP, &M::IMM, 2, 2 }, /*C*/ { "DEX",  &M::DEX, &M::IMP, 2, 1 }, { "???",  &M::XXX, &M::IMP, 2, 0 }, { "CPY",  &M::CPY, &M::ABS, 4, 3 }, { "CMP", &M::CMP, &M::ABS, 4, 3 }, { "DEC", &M::DEC, &M::ABS, 6, 3 }, { "*DCP", &M::DCP, &M::ABS, 6, 3 }, /*C*/
-    /*D*/ { "BNE",  &M::BNE, &M::REL, 2, 2 }, { "CMP", &M::CMP, &M::IIY, 5, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*DCP",  &M::DCP, &M::IIY, 8, 2 }, { "*NOP", &M::NO2, &M::ZPI, 3, 2 }, /*D*/ { "CMP", &M::CMP, &M::ZPX, 4, 2 }, { "DEC", &M::DEC, &M::ZPX, 6, 2 }, { "*DCP", &M::DCP, &M::ZPX, 6, 2 }, { "CLD", &M::CLD, &M::IMP, 2, 1 }, { "CMP", &M::CMP, &M::ABY, 4, 3 }, /*D*/ { "*NOP", &M::NOP, &M::IMP, 2, 1 }, { "*DCP", &M::DCP, &M::ABY, 7, 3 }, { "*NOP", &M::NOP, &M::ABX, 2, 3 }, { "CMP", &M::CMP, &M::ABX, 4, 3 }, { "DEC", &M::DEC, &M::ABX, 7, 3 }, { "*DCP", &M::DCP, &M::ABX, 7, 3 }, /*D*/
-    /*E*/ { "CPX",  &M::CPX, &M::IMM, 2, 2 }, { "SBC", &M::SBC, &M::IIX, 6, 2 }, { "???", &M::NOP, &M::IMP, 2, 1 }, { "*ISB",  &M::ISB, &M::IIX, 8, 2 }, { "CPX",  &M::CPX, &M::ZPI, 3, 2 }, /*E*/ { "SBC", &M::SBC, &M::ZPI, 3, 2 }, { "INC", &M::INC, &M::ZPI, 5, 2 }, { "*ISB", &M::ISB, &M::ZPI, 5, 2 }, { "INX", &M::INX, &M::IMP, 2, 1 }, { "SBC", &M::SBC, &M::IMM, 2, 2 }, /*E*/ { "NOP",  &M::NOP, &M::IMP, 2, 1 }, { "*SBC", &M::SBC, &M::IMM, 2, 2 }, { "CPX",  &M::CPX, &M::ABS, 4, 3 }, { "SBC", &M::SBC, &M::ABS, 4, 3 }, { "INC", &M::INC, &M::ABS, 6, 3 }, { "*ISB", &M::ISB, &M::ABS, 6, 3 }, /*E*/
-    /*F*/ { "BEQ",  &M::BEQ, &M::REL, 2, 2 }, { "SBC", &M::SBC, &M::IIY, 5, 2 }, { "???", &M::XXX, &M::IMP, 2, 0 }, { "*ISB",  &M::ISB, &M::IIY, 8, 2 }, { "*NOP", &M::NO2, &M::ZPI, 3, 2 }, /*F*/ { "SBC", &M::SBC, &M::ZPX, 4, 2 }, { "INC", &M::INC, &M::ZPX, 6, 2 }, { "*ISB", &M::ISB, &M::ZPX, 6, 2 }, { "SED", &M::SED, &M::IMP, 2, 1 }, { "SBC", &M::SBC, &M::ABY, 4, 3 }, /*F*/ { "*NOP", &M::NOP, &M::IMP, 2, 1 }, { "*ISB", &M::ISB, &M::ABY, 7, 3 }, { "*NOP", &M::NOP, &M::ABX, 2, 3 }, { "SBC", &M::SBC, &M::ABX, 4, 3 }, { "INC", &M::INC, &M::ABX, 7, 3 }, { "*ISB", &M::ISB, &M::ABX, 7, 3 }, /*F*/
-    //                    0                                  1                                  2                                    3                                   4                                        5                                  6                                   7                                  8                                  9                                         A                                   B                                   C                                  D                                  E                                   F
-};
+const std::array<MOS6502::instruction_t, 256> MOS6502::instruction_table = {{
+    //      0                     1                     2                     3                     4                     5                     6                     7                           8                     9                     A                     B                     C                     D                     E                     F
+    /*0*/ { &M::BRK, &M::IMP }, { &M::ORA, &M::IIX }, { &M::JAM, &M::IMP }, { &M::SLO, &M::IIX }, { &M::NO2, &M::IMM }, { &M::ORA, &M::ZPI }, { &M::ASL, &M::ZPI }, { &M::SLO, &M::ZPI }, /*0*/ { &M::PHP, &M::IMP }, { &M::ORA, &M::IMM }, { &M::ASL, &M::ACC }, { &M::XXX, &M::IMP }, { &M::NOP, &M::ABS }, { &M::ORA, &M::ABS }, { &M::ASL, &M::ABS }, { &M::SLO, &M::ABS },
+    /*1*/ { &M::BPL, &M::REL }, { &M::ORA, &M::IIY }, { &M::JAM, &M::IMP }, { &M::SLO, &M::IIY }, { &M::NOP, &M::ZPX }, { &M::ORA, &M::ZPX }, { &M::ASL, &M::ZPX }, { &M::SLO, &M::ZPX }, /*1*/ { &M::CLC, &M::IMP }, { &M::ORA, &M::ABY }, { &M::NOP, &M::IMP }, { &M::SLO, &M::ABY }, { &M::NOP, &M::ABX }, { &M::ORA, &M::ABX }, { &M::ASL, &M::ABX }, { &M::SLO, &M::ABX },
+    /*2*/ { &M::JSR, &M::ABS }, { &M::AND, &M::IIX }, { &M::JAM, &M::IMP }, { &M::RLA, &M::IIX }, { &M::BIT, &M::ZPI }, { &M::AND, &M::ZPI }, { &M::ROL, &M::ZPI }, { &M::RLA, &M::ZPI }, /*2*/ { &M::PLP, &M::IMP }, { &M::AND, &M::IMM }, { &M::ROL, &M::ACC }, { &M::XXX, &M::IMP }, { &M::BIT, &M::ABS }, { &M::AND, &M::ABS }, { &M::ROL, &M::ABS }, { &M::RLA, &M::ABS },
+    /*3*/ { &M::BMI, &M::REL }, { &M::AND, &M::IIY }, { &M::JAM, &M::IMP }, { &M::RLA, &M::IIY }, { &M::NO2, &M::ZPI }, { &M::AND, &M::ZPX }, { &M::ROL, &M::ZPX }, { &M::RLA, &M::ZPX }, /*3*/ { &M::SEC, &M::IMP }, { &M::AND, &M::ABY }, { &M::NOP, &M::IMP }, { &M::RLA, &M::ABY }, { &M::NOP, &M::ABX }, { &M::AND, &M::ABX }, { &M::ROL, &M::ABX }, { &M::RLA, &M::ABX },
+    /*4*/ { &M::RTI, &M::IMP }, { &M::EOR, &M::IIX }, { &M::JAM, &M::IMP }, { &M::SRE, &M::IIX }, { &M::NO2, &M::IMM }, { &M::EOR, &M::ZPI }, { &M::LSR, &M::ZPI }, { &M::SRE, &M::ZPI }, /*4*/ { &M::PHA, &M::IMP }, { &M::EOR, &M::IMM }, { &M::LSR, &M::ACC }, { &M::XXX, &M::IMP }, { &M::JMP, &M::ABS }, { &M::EOR, &M::ABS }, { &M::LSR, &M::ABS }, { &M::SRE, &M::ABS },
+    /*5*/ { &M::BVC, &M::REL }, { &M::EOR, &M::IIY }, { &M::JAM, &M::IMP }, { &M::SRE, &M::IIY }, { &M::NO2, &M::ZPI }, { &M::EOR, &M::ZPX }, { &M::LSR, &M::ZPX }, { &M::SRE, &M::ZPX }, /*5*/ { &M::CLI, &M::IMP }, { &M::EOR, &M::ABY }, { &M::NOP, &M::IMP }, { &M::SRE, &M::ABY }, { &M::NOP, &M::ABX }, { &M::EOR, &M::ABX }, { &M::LSR, &M::ABX }, { &M::SRE, &M::ABX },
+    /*6*/ { &M::RTS, &M::IMP }, { &M::ADC, &M::IIX }, { &M::JAM, &M::IMP }, { &M::RRA, &M::IIX }, { &M::NO2, &M::IMM }, { &M::ADC, &M::ZPI }, { &M::ROR, &M::ZPI }, { &M::RRA, &M::ZPI }, /*6*/ { &M::PLA, &M::IMP }, { &M::ADC, &M::IMM }, { &M::ROR, &M::ACC }, { &M::XXX, &M::IMP }, { &M::JMP_IND, &M::IND }, { &M::ADC, &M::ABS }, { &M::ROR, &M::ABS }, { &M::RRA, &M::ABS },
+    /*7*/ { &M::BVS, &M::REL }, { &M::ADC, &M::IIY }, { &M::JAM, &M::IMP }, { &M::RRA, &M::IIY }, { &M::NO2, &M::ZPI }, { &M::ADC, &M::ZPX }, { &M::ROR, &M::ZPX }, { &M::RRA, &M::ZPX }, /*7*/ { &M::SEI, &M::IMP }, { &M::ADC, &M::ABY }, { &M::NOP, &M::IMP }, { &M::RRA, &M::ABY }, { &M::NOP, &M::ABX }, { &M::ADC, &M::ABX }, { &M::ROR, &M::ABX }, { &M::RRA, &M::ABX },
+    /*8*/ { &M::NOP, &M::IMM }, { &M::STA, &M::IIX }, { &M::NOP, &M::IMP }, { &M::SAX, &M::IIX }, { &M::STY, &M::ZPI }, { &M::STA, &M::ZPI }, { &M::STX, &M::ZPI }, { &M::SAX, &M::ZPI }, /*8*/ { &M::DEY, &M::IMP }, { &M::NOP, &M::IMP }, { &M::TXA, &M::IMP }, { &M::XXX, &M::IMP }, { &M::STY, &M::ABS }, { &M::STA, &M::ABS }, { &M::STX, &M::ABS }, { &M::SAX, &M::ABS },
+    /*9*/ { &M::BCC, &M::REL }, { &M::STA, &M::IIY }, { &M::JAM, &M::IMP }, { &M::XXX, &M::IMP }, { &M::STY, &M::ZPX }, { &M::STA, &M::ZPX }, { &M::STX, &M::ZPY }, { &M::SAX, &M::ZPY }, /*9*/ { &M::TYA, &M::IMP }, { &M::STA, &M::ABY }, { &M::TXS, &M::IMP }, { &M::XXX, &M::IMP }, { &M::NOP, &M::IMP }, { &M::STA, &M::ABX }, { &M::XXX, &M::IMP }, { &M::XXX, &M::IMP },
+    /*A*/ { &M::LDY, &M::IMM }, { &M::LDA, &M::IIX }, { &M::LDX, &M::IMM }, { &M::LAX, &M::IIX }, { &M::LDY, &M::ZPI }, { &M::LDA, &M::ZPI }, { &M::LDX, &M::ZPI }, { &M::LAX, &M::ZPI }, /*A*/ { &M::TAY, &M::IMP }, { &M::LDA, &M::IMM }, { &M::TAX, &M::IMP }, { &M::XXX, &M::IMP }, { &M::LDY, &M::ABS }, { &M::LDA, &M::ABS }, { &M::LDX, &M::ABS }, { &M::LAX, &M::ABS },
+    /*B*/ { &M::BCS, &M::REL }, { &M::LDA, &M::IIY }, { &M::JAM, &M::IMP }, { &M::LAX, &M::IIY }, { &M::LDY, &M::ZPX }, { &M::LDA, &M::ZPX }, { &M::LDX, &M::ZPY }, { &M::LAX, &M::ZPY }, /*B*/ { &M::CLV, &M::IMP }, { &M::LDA, &M::ABY }, { &M::TSX, &M::IMP }, { &M::XXX, &M::IMP }, { &M::LDY, &M::ABX }, { &M::LDA, &M::ABX }, { &M::LDX, &M::ABY }, { &M::LAX, &M::ABY },
+    /*C*/ { &M::CPY, &M::IMM }, { &M::CMP, &M::IIX }, { &M::NOP, &M::IMP }, { &M::DCP, &M::IIX }, { &M::CPY, &M::ZPI }, { &M::CMP, &M::ZPI }, { &M::DEC, &M::ZPI }, { &M::DCP, &M::ZPI }, /*C*/ { &M::INY, &M::IMP }, { &M::CMP, &M::IMM }, { &M::DEX, &M::IMP }, { &M::XXX, &M::IMP }, { &M::CPY, &M::ABS }, { &M::CMP, &M::ABS }, { &M::DEC, &M::ABS }, { &M::DCP, &M::ABS },
+    /*D*/ { &M::BNE, &M::REL }, { &M::CMP, &M::IIY }, { &M::JAM, &M::IMP }, { &M::DCP, &M::IIY }, { &M::NO2, &M::ZPI }, { &M::CMP, &M::ZPX }, { &M::DEC, &M::ZPX }, { &M::DCP, &M::ZPX }, /*D*/ { &M::CLD, &M::IMP }, { &M::CMP, &M::ABY }, { &M::NOP, &M::IMP }, { &M::DCP, &M::ABY }, { &M::NOP, &M::ABX }, { &M::CMP, &M::ABX }, { &M::DEC, &M::ABX }, { &M::DCP, &M::ABX },
+    /*E*/ { &M::CPX, &M::IMM }, { &M::SBC, &M::IIX }, { &M::NOP, &M::IMP }, { &M::ISB, &M::IIX }, { &M::CPX, &M::ZPI }, { &M::SBC, &M::ZPI }, { &M::INC, &M::ZPI }, { &M::ISB, &M::ZPI }, /*E*/ { &M::INX, &M::IMP }, { &M::SBC, &M::IMM }, { &M::NOP, &M::IMP }, { &M::SBC, &M::IMM }, { &M::CPX, &M::ABS }, { &M::SBC, &M::ABS }, { &M::INC, &M::ABS }, { &M::ISB, &M::ABS },
+    /*F*/ { &M::BEQ, &M::REL }, { &M::SBC, &M::IIY }, { &M::JAM, &M::IMP }, { &M::ISB, &M::IIY }, { &M::NO2, &M::ZPI }, { &M::SBC, &M::ZPX }, { &M::INC, &M::ZPX }, { &M::ISB, &M::ZPX }, /*F*/ { &M::SED, &M::IMP }, { &M::SBC, &M::ABY }, { &M::NOP, &M::IMP }, { &M::ISB, &M::ABY }, { &M::NOP, &M::ABX }, { &M::SBC, &M::ABX }, { &M::INC, &M::ABX }, { &M::ISB, &M::ABX },
+    //      0                     1                     2                     3                     4                     5                     6                     7                           8                     9                     A                     B                     C                     D                     E                     F
+}};
 
 // clang-format on
+
+const MOS6502::instruction_t MOS6502::irq_instruction = {&M::IRQ, &M::IMP};
+const MOS6502::instruction_t MOS6502::nmi_instruction = {&M::NMI, &M::IMP};
@@ -0,0 +1,114 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Addressing modes and operations of the opcodes. They are known at compile
+// time, so the engines can instantiate a specialized handler for every opcode
+// clang-format off
+enum class addressing_t : uint8_t {
+  IMP, ACC, IMM, ZPI, ZPX, ZPY, REL, ABS, ABX, ABY, IND, IIX, IIY
+};
+
+enum class operation_t : uint8_t {
+  ADC, AND, ASL, BCC, BCS, BEQ, BIT, BMI, BNE, BPL, BRK, BVC, BVS,
+  CLC, CLD, CLI, CLV, CMP, CPX, CPY, DCP, DEC, DEX, DEY, EOR, INC,
+  INX, INY, ISB, JAM, JMP, JSR, LAX, LDA, LDX, LDY, LSR, NOP, ORA,
+  PHA, PHP, PLA, PLP, RLA, ROL, ROR, RRA, RTI, RTS, SAX, SBC, SEC,
+  SED, SEI, SLO, SRE, STA, STX, STY, TAX, TAY, TSX, TXA, TXS, TYA,
+  XXX
+};
+// clang-format on
+
+// Class of the operation, i.e. how it accesses the operand
+enum class access_t : uint8_t {
+  NONE,  // No operand access (implied, stack, branches and jumps)
+  READ,  // Read the operand
+  WRITE, // Write the operand
+  RMW    // Read-Modify-Write the operand (accumulator included)
+};
+
+struct opcode_t {
+  std::string_view name; // Mnemonic, unofficial ones are prefixed by '*'
+  operation_t operation;
+  addressing_t addressing;
+  uint8_t cycles;            // Base cycles, page crossing and branches excluded
+  uint8_t instruction_bytes; // Opcode plus operands
+  access_t access;
+  bool page_penalty; // One more cycle if the indexed addressing crosses a page
+};
+
+constexpr access_t operation_access(const operation_t op,
+                                    const addressing_t mode) {
+  using O = operation_t;
+
+  switch (op) {
+  case O::ADC: case O::AND: case O::BIT: case O::CMP: case O::CPX:
+  case O::CPY: case O::EOR: case O::LAX: case O::LDA: case O::LDX:
+  case O::LDY: case O::ORA: case O::SBC:
+    return access_t::READ;
+
+  case O::NOP: // The unofficial NOPs with operand read it
+    return mode == addressing_t::IMP ? access_t::NONE : access_t::READ;
+
+  case O::SAX: case O::STA: case O::STX: case O::STY:
+    return access_t::WRITE;
+
+  case O::ASL: case O::DCP: case O::DEC: case O::INC: case O::ISB:
+  case O::LSR: case O::RLA: case O::ROL: case O::ROR: case O::RRA:
+  case O::SLO: case O::SRE:
+    return access_t::RMW;
+
+  default:
+    return access_t::NONE;
+  }
+}
+
+constexpr opcode_t make_opcode(const std::string_view name,
+                               const operation_t op, const addressing_t mode,
+                               const uint8_t cycles, const uint8_t bytes) {
+  const access_t access = operation_access(op, mode);
+
+  // Only the read instructions pay the fix of the address high byte, the
+  // others always spend that cycle and have it in the base cycles
+  const bool page_penalty =
+      access == access_t::READ &&
+      (mode == addressing_t::ABX || mode == addressing_t::ABY ||
+       mode == addressing_t::IIY);
+
+  return {name, op, mode, cycles, bytes, access, page_penalty};
+}
+
+// The opcode table. The array index is the opcode. It lives in the read only
+// data and can be used at compile time
+
+// TODO(max): fix the illegal (*) opcode cycles numbers according to:
+// https://wiki.nesdev.com/w/index.php/Programming_with_unofficial_opcodes
+
+#define ENTRY(name, op, mode, cycles, bytes)                                   \
+  make_opcode(name, operation_t::op, addressing_t::mode, cycles, bytes)
+
+// clang-format off
+constexpr std::array<opcode_t, 256> opcode_table = {
+    //      0                              1                              2                              3                              4                              5                              6                              7                                    8                              9                              A                              B                              C                              D                              E                              F
+    /*0*/ ENTRY("BRK", BRK, IMP, 7, 1),  ENTRY("ORA", ORA, IIX, 6, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*SLO", SLO, IIX, 8, 2), ENTRY("*NOP", NOP, IMM, 3, 2), ENTRY("ORA", ORA, ZPI, 3, 2),  ENTRY("ASL", ASL, ZPI, 5, 2),  ENTRY("*SLO", SLO, ZPI, 5, 2), /*0*/ ENTRY("PHP", PHP, IMP, 3, 1),  ENTRY("ORA", ORA, IMM, 2, 2),  ENTRY("ASL", ASL, ACC, 2, 1),  ENTRY("???", XXX, IMP, 2, 0),  ENTRY("*NOP", NOP, ABS, 4, 3), ENTRY("ORA", ORA, ABS, 4, 3),  ENTRY("ASL", ASL, ABS, 6, 3),  ENTRY("*SLO", SLO, ABS, 6, 3),
+    /*1*/ ENTRY("BPL", BPL, REL, 2, 2),  ENTRY("ORA", ORA, IIY, 5, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*SLO", SLO, IIY, 8, 2), ENTRY("*NOP", NOP, ZPX, 4, 2), ENTRY("ORA", ORA, ZPX, 4, 2),  ENTRY("ASL", ASL, ZPX, 6, 2),  ENTRY("*SLO", SLO, ZPX, 6, 2), /*1*/ ENTRY("CLC", CLC, IMP, 2, 1),  ENTRY("ORA", ORA, ABY, 4, 3),  ENTRY("*NOP", NOP, IMP, 2, 1), ENTRY("*SLO", SLO, ABY, 7, 3), ENTRY("*NOP", NOP, ABX, 4, 3), ENTRY("ORA", ORA, ABX, 4, 3),  ENTRY("ASL", ASL, ABX, 7, 3),  ENTRY("*SLO", SLO, ABX, 7, 3),
+    /*2*/ ENTRY("JSR", JSR, ABS, 6, 3),  ENTRY("AND", AND, IIX, 6, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*RLA", RLA, IIX, 8, 2), ENTRY("BIT", BIT, ZPI, 3, 2),  ENTRY("AND", AND, ZPI, 3, 2),  ENTRY("ROL", ROL, ZPI, 5, 2),  ENTRY("*RLA", RLA, ZPI, 5, 2), /*2*/ ENTRY("PLP", PLP, IMP, 4, 1),  ENTRY("AND", AND, IMM, 2, 2),  ENTRY("ROL", ROL, ACC, 2, 1),  ENTRY("???", XXX, IMP, 2, 0),  ENTRY("BIT", BIT, ABS, 4, 3),  ENTRY("AND", AND, ABS, 4, 3),  ENTRY("ROL", ROL, ABS, 6, 3),  ENTRY("*RLA", RLA, ABS, 6, 3),
+    /*3*/ ENTRY("BMI", BMI, REL, 2, 2),  ENTRY("AND", AND, IIY, 5, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*RLA", RLA, IIY, 8, 2), ENTRY("*NOP", NOP, ZPI, 4, 2), ENTRY("AND", AND, ZPX, 4, 2),  ENTRY("ROL", ROL, ZPX, 6, 2),  ENTRY("*RLA", RLA, ZPX, 6, 2), /*3*/ ENTRY("SEC", SEC, IMP, 2, 1),  ENTRY("AND", AND, ABY, 4, 3),  ENTRY("*NOP", NOP, IMP, 2, 1), ENTRY("*RLA", RLA, ABY, 7, 3), ENTRY("*NOP", NOP, ABX, 4, 3), ENTRY("AND", AND, ABX, 4, 3),  ENTRY("ROL", ROL, ABX, 7, 3),  ENTRY("*RLA", RLA, ABX, 7, 3),
+    /*4*/ ENTRY("RTI", RTI, IMP, 6, 1),  ENTRY("EOR", EOR, IIX, 6, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*SRE", SRE, IIX, 8, 2), ENTRY("*NOP", NOP, IMM, 3, 2), ENTRY("EOR", EOR, ZPI, 3, 2),  ENTRY("LSR", LSR, ZPI, 5, 2),  ENTRY("*SRE", SRE, ZPI, 5, 2), /*4*/ ENTRY("PHA", PHA, IMP, 3, 1),  ENTRY("EOR", EOR, IMM, 2, 2),  ENTRY("LSR", LSR, ACC, 2, 1),  ENTRY("???", XXX, IMP, 2, 0),  ENTRY("JMP", JMP, ABS, 3, 3),  ENTRY("EOR", EOR, ABS, 4, 3),  ENTRY("LSR", LSR, ABS, 6, 3),  ENTRY("*SRE", SRE, ABS, 6, 3),
+    /*5*/ ENTRY("BVC", BVC, REL, 2, 2),  ENTRY("EOR", EOR, IIY, 5, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*SRE", SRE, IIY, 8, 2), ENTRY("*NOP", NOP, ZPI, 4, 2), ENTRY("EOR", EOR, ZPX, 4, 2),  ENTRY("LSR", LSR, ZPX, 6, 2),  ENTRY("*SRE", SRE, ZPX, 6, 2), /*5*/ ENTRY("CLI", CLI, IMP, 2, 1),  ENTRY("EOR", EOR, ABY, 4, 3),  ENTRY("*NOP", NOP, IMP, 2, 1), ENTRY("*SRE", SRE, ABY, 7, 3), ENTRY("*NOP", NOP, ABX, 4, 3), ENTRY("EOR", EOR, ABX, 4, 3),  ENTRY("LSR", LSR, ABX, 7, 3),  ENTRY("*SRE", SRE, ABX, 7, 3),
+    /*6*/ ENTRY("RTS", RTS, IMP, 6, 1),  ENTRY("ADC", ADC, IIX, 6, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*RRA", RRA, IIX, 8, 2), ENTRY("*NOP", NOP, IMM, 3, 2), ENTRY("ADC", ADC, ZPI, 3, 2),  ENTRY("ROR", ROR, ZPI, 5, 2),  ENTRY("*RRA", RRA, ZPI, 5, 2), /*6*/ ENTRY("PLA", PLA, IMP, 4, 1),  ENTRY("ADC", ADC, IMM, 2, 2),  ENTRY("ROR", ROR, ACC, 2, 1),  ENTRY("???", XXX, IMP, 2, 0),  ENTRY("JMP", JMP, IND, 5, 3),  ENTRY("ADC", ADC, ABS, 4, 3),  ENTRY("ROR", ROR, ABS, 6, 3),  ENTRY("*RRA", RRA, ABS, 6, 3),
+    /*7*/ ENTRY("BVS", BVS, REL, 2, 2),  ENTRY("ADC", ADC, IIY, 5, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*RRA", RRA, IIY, 8, 2), ENTRY("*NOP", NOP, ZPI, 4, 2), ENTRY("ADC", ADC, ZPX, 4, 2),  ENTRY("ROR", ROR, ZPX, 6, 2),  ENTRY("*RRA", RRA, ZPX, 6, 2), /*7*/ ENTRY("SEI", SEI, IMP, 2, 1),  ENTRY("ADC", ADC, ABY, 4, 3),  ENTRY("*NOP", NOP, IMP, 2, 1), ENTRY("*RRA", RRA, ABY, 7, 3), ENTRY("*NOP", NOP, ABX, 4, 3), ENTRY("ADC", ADC, ABX, 4, 3),  ENTRY("ROR", ROR, ABX, 7, 3),  ENTRY("*RRA", RRA, ABX, 7, 3),
+    /*8*/ ENTRY("*NOP", NOP, IMM, 2, 2), ENTRY("STA", STA, IIX, 6, 2),  ENTRY("???", NOP, IMP, 2, 1),  ENTRY("*SAX", SAX, IIX, 6, 2), ENTRY("STY", STY, ZPI, 3, 2),  ENTRY("STA", STA, ZPI, 3, 2),  ENTRY("STX", STX, ZPI, 3, 2),  ENTRY("*SAX", SAX, ZPI, 3, 2), /*8*/ ENTRY("DEY", DEY, IMP, 2, 1),  ENTRY("???", NOP, IMP, 2, 1),  ENTRY("TXA", TXA, IMP, 2, 1),  ENTRY("???", XXX, IMP, 2, 0),  ENTRY("STY", STY, ABS, 4, 3),  ENTRY("STA", STA, ABS, 4, 3),  ENTRY("STX", STX, ABS, 4, 3),  ENTRY("*SAX", SAX, ABS, 4, 3),
+    /*9*/ ENTRY("BCC", BCC, REL, 2, 2),  ENTRY("STA", STA, IIY, 6, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("???", XXX, IMP, 6, 0),  ENTRY("STY", STY, ZPX, 4, 2),  ENTRY("STA", STA, ZPX, 4, 2),  ENTRY("STX", STX, ZPY, 4, 2),  ENTRY("*SAX", SAX, ZPY, 4, 2), /*9*/ ENTRY("TYA", TYA, IMP, 2, 1),  ENTRY("STA", STA, ABY, 5, 3),  ENTRY("TXS", TXS, IMP, 2, 1),  ENTRY("???", XXX, IMP, 5, 0),  ENTRY("???", NOP, IMP, 2, 1),  ENTRY("STA", STA, ABX, 5, 3),  ENTRY("???", XXX, IMP, 5, 0),  ENTRY("???", XXX, IMP, 5, 0),
+    /*A*/ ENTRY("LDY", LDY, IMM, 2, 2),  ENTRY("LDA", LDA, IIX, 6, 2),  ENTRY("LDX", LDX, IMM, 2, 2),  ENTRY("*LAX", LAX, IIX, 6, 2), ENTRY("LDY", LDY, ZPI, 3, 2),  ENTRY("LDA", LDA, ZPI, 3, 2),  ENTRY("LDX", LDX, ZPI, 3, 2),  ENTRY("*LAX", LAX, ZPI, 3, 2), /*A*/ ENTRY("TAY", TAY, IMP, 2, 1),  ENTRY("LDA", LDA, IMM, 2, 2),  ENTRY("TAX", TAX, IMP, 2, 1),  ENTRY("???", XXX, IMP, 2, 0),  ENTRY("LDY", LDY, ABS, 4, 3),  ENTRY("LDA", LDA, ABS, 4, 3),  ENTRY("LDX", LDX, ABS, 4, 3),  ENTRY("*LAX", LAX, ABS, 4, 3),
+    /*B*/ ENTRY("BCS", BCS, REL, 2, 2),  ENTRY("LDA", LDA, IIY, 5, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*LAX", LAX, IIY, 5, 2), ENTRY("LDY", LDY, ZPX, 4, 2),  ENTRY("LDA", LDA, ZPX, 4, 2),  ENTRY("LDX", LDX, ZPY, 4, 2),  ENTRY("*LAX", LAX, ZPY, 4, 2), /*B*/ ENTRY("CLV", CLV, IMP, 2, 1),  ENTRY("LDA", LDA, ABY, 4, 3),  ENTRY("TSX", TSX, IMP, 2, 1),  ENTRY("???", XXX, IMP, 4, 0),  ENTRY("LDY", LDY, ABX, 4, 3),  ENTRY("LDA", LDA, ABX, 4, 3),  ENTRY("LDX", LDX, ABY, 4, 3),  ENTRY("*LAX", LAX, ABY, 4, 3),
+    /*C*/ ENTRY("CPY", CPY, IMM, 2, 2),  ENTRY("CMP", CMP, IIX, 6, 2),  ENTRY("???", NOP, IMP, 2, 1),  ENTRY("*DCP", DCP, IIX, 8, 2), ENTRY("CPY", CPY, ZPI, 3, 2),  ENTRY("CMP", CMP, ZPI, 3, 2),  ENTRY("DEC", DEC, ZPI, 5, 2),  ENTRY("*DCP", DCP, ZPI, 5, 2), /*C*/ ENTRY("INY", INY, IMP, 2, 1),  ENTRY("CMP", CMP, IMM, 2, 2),  ENTRY("DEX", DEX, IMP, 2, 1),  ENTRY("???", XXX, IMP, 2, 0),  ENTRY("CPY", CPY, ABS, 4, 3),  ENTRY("CMP", CMP, ABS, 4, 3),  ENTRY("DEC", DEC, ABS, 6, 3),  ENTRY("*DCP", DCP, ABS, 6, 3),
+    /*D*/ ENTRY("BNE", BNE, REL, 2, 2),  ENTRY("CMP", CMP, IIY, 5, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*DCP", DCP, IIY, 8, 2), ENTRY("*NOP", NOP, ZPI, 4, 2), ENTRY("CMP", CMP, ZPX, 4, 2),  ENTRY("DEC", DEC, ZPX, 6, 2),  ENTRY("*DCP", DCP, ZPX, 6, 2), /*D*/ ENTRY("CLD", CLD, IMP, 2, 1),  ENTRY("CMP", CMP, ABY, 4, 3),  ENTRY("*NOP", NOP, IMP, 2, 1), ENTRY("*DCP", DCP, ABY, 7, 3), ENTRY("*NOP", NOP, ABX, 4, 3), ENTRY("CMP", CMP, ABX, 4, 3),  ENTRY("DEC", DEC, ABX, 7, 3),  ENTRY("*DCP", DCP, ABX, 7, 3),
+    /*E*/ ENTRY("CPX", CPX, IMM, 2, 2),  ENTRY("SBC", SBC, IIX, 6, 2),  ENTRY("???", NOP, IMP, 2, 1),  ENTRY("*ISB", ISB, IIX, 8, 2), ENTRY("CPX", CPX, ZPI, 3, 2),  ENTRY("SBC", SBC, ZPI, 3, 2),  ENTRY("INC", INC, ZPI, 5, 2),  ENTRY("*ISB", ISB, ZPI, 5, 2), /*E*/ ENTRY("INX", INX, IMP, 2, 1),  ENTRY("SBC", SBC, IMM, 2, 2),  ENTRY("NOP", NOP, IMP, 2, 1),  ENTRY("*SBC", SBC, IMM, 2, 2), ENTRY("CPX", CPX, ABS, 4, 3),  ENTRY("SBC", SBC, ABS, 4, 3),  ENTRY("INC", INC, ABS, 6, 3),  ENTRY("*ISB", ISB, ABS, 6, 3),
+    /*F*/ ENTRY("BEQ", BEQ, REL, 2, 2),  ENTRY("SBC", SBC, IIY, 5, 2),  ENTRY("*JAM", JAM, IMP, 1, 1), ENTRY("*ISB", ISB, IIY, 8, 2), ENTRY("*NOP", NOP, ZPI, 4, 2), ENTRY("SBC", SBC, ZPX, 4, 2),  ENTRY("INC", INC, ZPX, 6, 2),  ENTRY("*ISB", ISB, ZPX, 6, 2), /*F*/ ENTRY("SED", SED, IMP, 2, 1),  ENTRY("SBC", SBC, ABY, 4, 3),  ENTRY("*NOP", NOP, IMP, 2, 1), ENTRY("*ISB", ISB, ABY, 7, 3), ENTRY("*NOP", NOP, ABX, 4, 3), ENTRY("SBC", SBC, ABX, 4, 3),  ENTRY("INC", INC, ABX, 7, 3),  ENTRY("*ISB", ISB, ABX, 7, 3),
+    //      0                              1                              2                              3                              4                              5                              6                              7                                    8                              9                              A                              B                              C                              D                              E                              F
+};
+// clang-format on
+
+#undef ENTRY
\ No newline at end of file
@@ -0,0 +1,200 @@
+#pragma once
+#include "engine.hpp"
+
+// Runtime of the C++ code generated by the static recompiler, see
+// src/recompiler. The generated function of a binary executes its recovered
+// basic blocks as straight C++ on a RecompiledCpu, with the operands and the
+// addresses as constants, and jumps between the blocks with gotos. The code
+// it can not follow statically (computed jumps, returns to unknown
+// addresses, unofficial opcodes, BRK and RTI) is executed by the instruction
+// level engine, one instruction at a time, until the PC is back on a known
+// block.
+//
+// The registers, the flags and the ALU operations are the ones of LazyAlu,
+// shared with the instruction level engine, and so are the memory accesses
+// and the cycle counting. A block runs only when all of its cycles fit in
+// the budget, the last instructions of a run are interpreted, so the run
+// stops on the same instruction boundary as MOS6502::run(). The trace state
+// of the cpu (bus, opcode and operands of the last instruction) is updated
+// only by the interpreted instructions.
+//
+// As in MOS6502::run(), the run is split at the scheduled events (see
+// MOS6502::schedule()): a segment ends at the next event, which is
+// dispatched, the interrupts are polled and the next segment starts with the
+// interrupt sequence. CLI, PLP and RTI are interpreted, a segment ends after
+// them if they unmask an active IRQ line.
+//
+// The recompiled code is valid only while the code of the binary is in
+// memory and never modified, e.g. a ROM.
+template <typename Bus> class RecompiledCpu : public LazyAlu {
+public:
+  RecompiledCpu(MOS6502 &cpu, Bus &bus, const uint64_t budget);
+
+  // Write the registers back to the cpu and return the result of the run
+  run_result_t finish();
+
+  // The run is over, checked at the instruction boundaries. At the end of a
+  // segment the next one is started instead
+  ENGINE_INLINE bool done() { return cycles >= end && !next_segment(); }
+  // A block of at most 'max_cycles' cycles can run without exceeding the end
+  ENGINE_INLINE bool fits(const unsigned int max_cycles) const {
+    return cycles + max_cycles < end;
+  }
+
+  // Execute the instruction at PC on the instruction level engine. A JAM
+  // opcode ends the run, see MOS6502::halted
+  void interpret();
+
+  // Dispatch the events due and take the pending interrupt, then start the
+  // segment up to the next event. Return false if the run is over
+  bool next_segment();
+  // Execute the interrupt sequence of the vector at 'vector', see
+  // LazyAlu::enter_interrupt()
+  void interrupt(const uint16_t vector) { enter_interrupt(*this, vector); }
+  void load(); // Read the registers from the cpu
+
+  MOS6502 &cpu;
+  Bus &bus;
+  uint64_t *dirty; // nullptr if the dirty pages are not tracked
+
+  uint64_t start;
+  uint64_t end;     // End of the segment
+  uint64_t run_end; // End of the run
+
+  // The registers and the flags are the ones of LazyAlu, PC is valid only at
+  // the exits of the blocks
+
+  /********************************************************
+   *                    UTIL FUNCTIONS                    *
+   ********************************************************/
+  ENGINE_INLINE uint8_t read(const uint16_t address) {
+    return bus.read(address);
+  }
+  ENGINE_INLINE void write(const uint16_t address, const uint8_t data) {
+    bus.write(address, data);
+
+    if (dirty) {
+      mark_dirty(dirty, address);
+    }
+  }
+  ENGINE_INLINE void push(const uint8_t data) {
+    write(STACK_OFFSET + S--, data);
+  }
+  ENGINE_INLINE uint8_t pull() { return read(STACK_OFFSET + ++S); }
+
+  /********************************************************
+   *                  ADDRESSING MODES                    *
+   ********************************************************/
+  // 'base' + 'index', one more cycle if 'penalty' and the page is crossed
+  ENGINE_INLINE uint16_t indexed(const uint16_t base, const uint8_t index,
+                                 const bool penalty) {
+    uint16_t effective = base + index;
+    if (penalty && ((base ^ effective) & 0xFF00)) {
+      cycles++;
+    }
+    return effective;
+  }
+  ENGINE_INLINE uint16_t zero_page_word(const uint8_t pointer) {
+    uint8_t lo = read(pointer);
+    return (read(static_cast<uint8_t>(pointer + 1)) << 8) | lo;
+  }
+  ENGINE_INLINE uint16_t indirect_x(const uint8_t pointer) {
+    return zero_page_word(pointer + X);
+  }
+  ENGINE_INLINE uint16_t indirect_y(const uint8_t pointer,
+                                    const bool penalty) {
+    return indexed(zero_page_word(pointer), Y, penalty);
+  }
+  // JMP ($xxxx), the high byte is read from the same page (hardware bug)
+  ENGINE_INLINE uint16_t indirect(const uint16_t pointer) {
+    uint8_t lo = read(pointer);
+    return (read((pointer & 0xFF00) | ((pointer + 1) & 0x00FF)) << 8) | lo;
+  }
+
+  /********************************************************
+   *                   INSTRUCTION SET                    *
+   ********************************************************/
+  // adc(), sbc(), bit(), compare() and the Read-Modify-Write operations are
+  // the ones of LazyAlu
+  ENGINE_INLINE void php() {
+    push(status() | MOS6502::B);
+    P &= ~MOS6502::B;
+  }
+  // JSR of the instruction at 'pc', push the address of its last byte
+  ENGINE_INLINE void jsr(const uint16_t pc) {
+    push(((pc + 2) >> 8) & 0x00FF);
+    push((pc + 2) & 0x00FF);
+  }
+  ENGINE_INLINE void rts() {
+    uint8_t lo = pull();
+    PC = ((pull() << 8) | lo) + 1;
+  }
+};
+
+template <typename Bus>
+RecompiledCpu<Bus>::RecompiledCpu(MOS6502 &cpu, Bus &bus,
+                                  const uint64_t budget)
+    : cpu(cpu), bus(bus),
+      dirty(cpu.dirty_tracking ? cpu.dirty_pages.data() : nullptr) {
+  cpu.complete_instruction();
+
+  start = cpu.cycles;
+  run_end = end_cycle(start, budget);
+  end = start;
+
+  load();
+  next_segment();
+}
+
+template <typename Bus> run_result_t RecompiledCpu<Bus>::finish() {
+  cpu.A = A;
+  cpu.X = X;
+  cpu.Y = Y;
+  cpu.S = S;
+  cpu.P = status();
+  cpu.PC = PC;
+  cpu.cycles = cycles;
+
+  return {cycles - start,
+          cpu.halted ? stop_reason_t::HALT : stop_reason_t::CYCLES, PC};
+}
+
+template <typename Bus> void RecompiledCpu<Bus>::interpret() {
+  finish();
+  cpu.step(bus);
+  load();
+
+  if (cpu.halted) {
+    end = run_end = cycles;
+  } else if (cpu.irq_line && !(P & MOS6502::I)) {
+    end = cycles; // The IRQ is polled by the next segment
+  }
+}
+
+template <typename Bus> bool RecompiledCpu<Bus>::next_segment() {
+  if (cpu.halted || cycles >= run_end) {
+    return false;
+  }
+
+  finish();
+  cpu.dispatch_events();
+  const uint16_t vector = cpu.poll_interrupts();
+  load();
+
+  if (vector) {
+    interrupt(vector);
+  }
+
+  end = std::min(run_end, cpu.next_event());
+  return true;
+}
+
+template <typename Bus> void RecompiledCpu<Bus>::load() {
+  A = cpu.A;
+  X = cpu.X;
+  Y = cpu.Y;
+  S = cpu.S;
+  PC = cpu.PC;
+  cycles = cpu.cycles;
+  set_status(cpu.P);
+}
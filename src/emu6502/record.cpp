@@ -0,0 +1,300 @@
+#include "record.hpp"
+#include <cstring>
+
+// Layout of the stream of a Recorder:
+//
+//   magic "6502R", version
+//   256 bytes, the map of the pages (RECORD_PAGE_READ, RECORD_PAGE_WRITE)
+//   size of the state (4 bytes, little endian), save_state() with the memory
+//   the records, up to the end of the stream
+//
+// A record is the input_t, the difference of its stamp from the stamp of the
+// previous record (the first from 0) zigzag encoded in a LEB128 varint (the
+// reset moves the cycles back) and, for input_t::READ, the address (little
+// endian) and the value read. A read in a tight loop takes 5 bytes.
+#define RECORD_VERSION 1
+#define RECORD_PAGES 256
+#define RECORD_MAP_OFFSET 6
+#define RECORD_HEADER_SIZE (RECORD_MAP_OFFSET + RECORD_PAGES + 4)
+#define RECORD_MEMORY_SIZE (64 * 1024)
+
+#define RECORD_PAGE_READ (1 << 0) // The page is mapped for the reads
+#define RECORD_PAGE_WRITE (1 << 1)
+
+static const uint8_t record_magic[5] = {'6', '5', '0', '2', 'R'};
+
+struct record_t {
+  input_t input;
+  uint16_t address; // input_t::READ only
+  uint8_t data;
+};
+
+// Decode the record at 'in' (before 'end'), update 'stamp' from the previous
+// one. Return the position after it, nullptr if it is truncated or invalid
+static const uint8_t *decode(const uint8_t *in, const uint8_t *end,
+                             uint64_t &stamp, record_t &record) {
+  if (in == end || *in > static_cast<uint8_t>(input_t::END)) {
+    return nullptr;
+  }
+
+  record.input = static_cast<input_t>(*in++);
+
+  uint64_t zigzag = 0;
+  for (unsigned int shift = 0;; shift += 7) {
+    if (in == end || shift > 63) {
+      return nullptr;
+    }
+
+    zigzag |= static_cast<uint64_t>(*in & 0x7F) << shift;
+    if (!(*in++ & 0x80)) {
+      break;
+    }
+  }
+  stamp += (zigzag >> 1) ^ (0 - (zigzag & 1));
+
+  if (record.input == input_t::READ) {
+    if (end - in < 3) {
+      return nullptr;
+    }
+
+    record.address = in[0] | (in[1] << 8);
+    record.data = in[2];
+    in += 3;
+  }
+
+  return in;
+}
+
+/********************************************************
+ *                       RECORDER                       *
+ ********************************************************/
+Recorder::Recorder(MOS6502 &cpu)
+    : cpu(&cpu), callback(cpu.mem_access), user_data(cpu.user_data) {
+  std::vector<uint8_t> state;
+  cpu.save_state(state, true);
+
+  stream.assign(record_magic, record_magic + sizeof(record_magic));
+  stream.push_back(RECORD_VERSION);
+  for (const mem_page_t &page : cpu.page_table) {
+    stream.push_back((page.read ? RECORD_PAGE_READ : 0) |
+                     (page.write ? RECORD_PAGE_WRITE : 0));
+  }
+  for (unsigned int i = 0; i < 4; i++) {
+    stream.push_back((state.size() >> (8 * i)) & 0xFF);
+  }
+  stream.insert(stream.end(), state.begin(), state.end());
+
+  cpu.mem_access = mem_access;
+  cpu.user_data = this;
+  cpu.recorder = this;
+}
+
+Recorder::~Recorder() { stop(); }
+
+void Recorder::stop() {
+  if (!cpu) {
+    return;
+  }
+
+  put(input_t::END);
+
+  cpu->mem_access = callback;
+  cpu->user_data = user_data;
+  cpu->recorder = nullptr;
+  cpu = nullptr;
+}
+
+void Recorder::input(const input_t input) { put(input); }
+
+void Recorder::mem_access(void *usr_data, const uint16_t address,
+                          const access_mode_t read_write, uint8_t &data) {
+  Recorder *recorder = (Recorder *)usr_data;
+
+  recorder->callback(recorder->user_data, address, read_write, data);
+  if (read_write == access_mode_t::READ) {
+    recorder->put(input_t::READ, address, data);
+  }
+}
+
+void Recorder::put(const input_t input, const uint16_t address,
+                   const uint8_t data) {
+  const int64_t delta = static_cast<int64_t>(cpu->cycles - stamp);
+  uint64_t zigzag = static_cast<uint64_t>(delta) << 1;
+  if (delta < 0) {
+    zigzag = ~zigzag;
+  }
+  stamp = cpu->cycles;
+
+  stream.push_back(static_cast<uint8_t>(input));
+  do {
+    stream.push_back((zigzag & 0x7F) | (zigzag > 0x7F ? 0x80 : 0x00));
+    zigzag >>= 7;
+  } while (zigzag);
+
+  if (input == input_t::READ) {
+    stream.push_back(address & 0xFF);
+    stream.push_back(address >> 8);
+    stream.push_back(data);
+  }
+}
+
+/********************************************************
+ *                       REPLAYER                       *
+ ********************************************************/
+Replayer::Replayer(std::vector<uint8_t> stream)
+    : stream(std::move(stream)), memory(RECORD_MEMORY_SIZE) {}
+
+bool Replayer::attach(MOS6502 &cpu) {
+  const uint8_t *in = stream.data();
+  end = in + stream.size();
+
+  if (stream.size() < RECORD_HEADER_SIZE ||
+      memcmp(in, record_magic, sizeof(record_magic)) != 0 ||
+      in[sizeof(record_magic)] != RECORD_VERSION) {
+    cpu.log("Not a recording of this version");
+    return false;
+  }
+
+  const uint8_t *map = in + RECORD_MAP_OFFSET;
+  uint32_t state_size = 0;
+  for (unsigned int i = 0; i < 4; i++) {
+    state_size |= map[RECORD_PAGES + i] << (8 * i);
+  }
+  in += RECORD_HEADER_SIZE;
+
+  if (static_cast<size_t>(end - in) < state_size) {
+    cpu.log("The recording is truncated");
+    return false;
+  }
+  const uint8_t *state = in;
+  in += state_size;
+
+  uint64_t stamp = 0;
+  record_t record;
+  for (const uint8_t *next = in; next != end;) {
+    next = decode(next, end, stamp, record);
+    if (!next) {
+      cpu.log("The recording is truncated");
+      return false;
+    }
+  }
+
+  // The memory of the state is loaded with all the pages mapped here, then
+  // the map of the recording is set
+  const std::array<mem_page_t, RECORD_PAGES> page_table = cpu.page_table;
+  for (unsigned int page = 0; page < RECORD_PAGES; page++) {
+    cpu.page_table[page] = {&memory[page << 8], &memory[page << 8]};
+  }
+
+  if (!cpu.load_state(state, state_size)) {
+    cpu.page_table = page_table;
+    return false;
+  }
+
+  for (unsigned int page = 0; page < RECORD_PAGES; page++) {
+    uint8_t *bytes = &memory[page << 8];
+    cpu.page_table[page] = {(map[page] & RECORD_PAGE_READ) ? bytes : nullptr,
+                            (map[page] & RECORD_PAGE_WRITE) ? bytes : nullptr};
+  }
+  cpu.invalidate_code(0x00, RECORD_PAGES);
+
+  cpu.mem_access = mem_access;
+  cpu.user_data = this;
+  this->cpu = &cpu;
+
+  reads = inputs = in;
+  reads_stamp = inputs_stamp = 0;
+  divergence = false;
+  schedule_next();
+  return true;
+}
+
+void Replayer::run() {
+  while (pending) {
+    if (cpu->cycles < pending_cycle && !cpu->halted) {
+      cpu->run_until_cycle(pending_cycle);
+    } else {
+      // Between the runs, like the host of the recording: a reset dispatched
+      // as an event would move back the cycles in the middle of a run. The
+      // cycles of a halted cpu stopped at the input
+      cpu->cancel_event(event);
+      on_input(this, cpu->cycles);
+    }
+  }
+}
+
+uint64_t Replayer::next_cycle() const {
+  return pending ? pending_cycle : UINT64_MAX;
+}
+
+void Replayer::mem_access(void *usr_data, const uint16_t address,
+                          const access_mode_t read_write, uint8_t &data) {
+  Replayer *replayer = (Replayer *)usr_data;
+
+  if (read_write == access_mode_t::WRITE) {
+    return;
+  }
+
+  if (read_write == access_mode_t::READ_ONLY) {
+    data = replayer->memory[address];
+    return;
+  }
+
+  record_t record{};
+  record.input = input_t::END;
+  while (replayer->reads != replayer->end && record.input != input_t::READ) {
+    replayer->reads = decode(replayer->reads, replayer->end,
+                             replayer->reads_stamp, record);
+  }
+
+  if (record.input != input_t::READ || record.address != address) {
+    replayer->divergence = true;
+  }
+  data = (record.input == input_t::READ) ? record.data : 0x00;
+}
+
+void Replayer::on_input(void *usr_data, const uint64_t) {
+  Replayer *replayer = (Replayer *)usr_data;
+
+  replayer->apply(replayer->pending_input);
+  replayer->schedule_next();
+}
+
+void Replayer::apply(const input_t input) {
+  switch (input) {
+  case input_t::IRQ:
+    cpu->irq();
+    break;
+  case input_t::NMI:
+    cpu->nmi();
+    break;
+  case input_t::RESET:
+    cpu->reset();
+    break;
+  case input_t::IRQ_LINE_OFF:
+  case input_t::IRQ_LINE_ON:
+    cpu->set_irq_line(input == input_t::IRQ_LINE_ON);
+    break;
+  case input_t::NMI_LINE_OFF:
+  case input_t::NMI_LINE_ON:
+    cpu->set_nmi_line(input == input_t::NMI_LINE_ON);
+    break;
+  default: // END
+    break;
+  }
+}
+
+void Replayer::schedule_next() {
+  record_t record{};
+  record.input = input_t::READ;
+  while (inputs != end && record.input == input_t::READ) {
+    inputs = decode(inputs, end, inputs_stamp, record);
+  }
+
+  pending = record.input != input_t::READ;
+  if (pending) {
+    pending_input = record.input;
+    pending_cycle = inputs_stamp;
+    event = cpu->schedule(pending_cycle, on_input, this);
+  }
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include "mos6502.hpp"
+#include <stdint.h>
+#include <vector>
+
+// External inputs of a MOS6502, the records of the stream of a Recorder
+enum class input_t : uint8_t {
+  READ,         // Read served by mem_access (a device)
+  IRQ,          // irq()
+  NMI,          // nmi()
+  RESET,        // reset()
+  IRQ_LINE_OFF, // set_irq_line()
+  IRQ_LINE_ON,
+  NMI_LINE_OFF, // set_nmi_line()
+  NMI_LINE_ON,
+  END // Recorder::stop()
+};
+
+// Recorder of a session of a MOS6502 for a deterministic replay, see
+// Replayer. The stream starts with the memory map, the state and the memory
+// of the cpu, then it logs every external input stamped with the cycles
+// counter: the interrupt signals, the lines, the reset and the values of the
+// reads through mem_access (the devices, the mapped memory is in the state).
+//
+// The recorder takes the place of mem_access (forwarding to it) and is
+// called by the input functions of the cpu. The idle loops polling the
+// devices are not fast-forwarded while recording (set_stable_reads() is
+// ignored), so every read of a device is in the stream. The code must run
+// from the mapped memory, the lines must be changed from the event callbacks
+// (the change from mem_access has no exact cycle in the runs) and the host
+// must change the cpu only through the inputs: the memory map, the registers
+// and the mapped memory are not recorded.
+class Recorder {
+public:
+  explicit Recorder(MOS6502 &cpu);
+  ~Recorder(); // See stop()
+  Recorder(const Recorder &) = delete;
+  Recorder &operator=(const Recorder &) = delete;
+
+  // End the stream and give back mem_access to the cpu. Nothing is recorded
+  // after it
+  void stop();
+
+  // The stream so far, e.g. to save it periodically during a long session
+  const std::vector<uint8_t> &get_stream() const { return stream; }
+
+  // Log 'input' of the cpu, called by its input functions
+  void input(const input_t input);
+
+  // The mem_access of the cpu while it is recorded, see MOS6502::clone()
+  mem_access_callback get_callback() const { return callback; }
+  void *get_user_data() const { return user_data; }
+
+private:
+  // Forward to the mem_access of the cpu, log the reads
+  static void mem_access(void *usr_data, const uint16_t address,
+                         const access_mode_t read_write, uint8_t &data);
+
+  void put(const input_t input, const uint16_t address = 0,
+           const uint8_t data = 0);
+
+  MOS6502 *cpu; // nullptr once stopped
+  mem_access_callback callback;
+  void *user_data;
+  std::vector<uint8_t> stream;
+  uint64_t stamp = 0; // Cycles of the last record, see record.cpp
+};
+
+// Replayer of a stream of a Recorder, without the devices. attach() sets up
+// a cpu with the memory map, the state and the memory at the start of the
+// recording, on the memory of the Replayer. The inputs are scheduled at
+// their cycles and the reads through mem_access are served from the stream,
+// in order (the writes are dropped).
+//
+// The cpu is then executed like in the recorded session: the replay is exact
+// if it uses the same kind of engine, clock() if the session used it, run()
+// (see Replayer::run()) or step() otherwise. The block cache, the JIT and the
+// length of the runs do not change the replay. A read different from the
+// recorded one (another address or beyond the stream) makes the replay
+// diverged().
+class Replayer {
+public:
+  explicit Replayer(std::vector<uint8_t> stream);
+  Replayer(const Replayer &) = delete;
+  Replayer &operator=(const Replayer &) = delete;
+
+  // Set up 'cpu' for the replay, replacing its memory map, its state and its
+  // mem_access, and invalidate its cached code. Return false, leaving the cpu
+  // unchanged, if the stream is not valid. The replayer must outlive the cpu
+  bool attach(MOS6502 &cpu);
+
+  // Replay with the run functions up to the end of the recording (or to the
+  // last input, if the recording was not stopped). The inputs are applied
+  // between the runs, at their cycles
+  void run();
+
+  // All the inputs of the stream were replayed
+  bool finished() const { return !pending; }
+  // Cycle of the next input to replay, UINT64_MAX if finished()
+  uint64_t next_cycle() const;
+  bool diverged() const { return divergence; }
+
+private:
+  // mem_access of the cpu, usr_data is the Replayer
+  static void mem_access(void *usr_data, const uint16_t address,
+                         const access_mode_t read_write, uint8_t &data);
+  // event_callback of the next input, usr_data is the Replayer
+  static void on_input(void *usr_data, const uint64_t cycle);
+
+  void apply(const input_t input); // Input of the cpu
+  void schedule_next();            // Move to the next input and schedule it
+
+  std::vector<uint8_t> stream;
+  std::vector<uint8_t> memory; // The mapped pages of the cpu
+  MOS6502 *cpu = nullptr;
+
+  // The records, the reads and the other inputs are followed separately
+  const uint8_t *end = nullptr;
+  const uint8_t *reads = nullptr;  // After the last read served
+  uint64_t reads_stamp = 0;        // Stamp of the record before 'reads'
+  const uint8_t *inputs = nullptr; // After the pending input
+  uint64_t inputs_stamp = 0;
+
+  bool pending = false; // The next input to replay, scheduled as 'event'
+  input_t pending_input;
+  uint64_t pending_cycle;
+  uint64_t event;
+  bool divergence = false;
+};
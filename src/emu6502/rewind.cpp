@@ -0,0 +1,206 @@
+#include "rewind.hpp"
+#include <chrono>
+#include <cstring>
+
+#define REWIND_MEMORY_SIZE (64 * 1024)
+#define REWIND_PAGES 256
+// The re-execution runs up to this many cycles before the target and then
+// clocks to it, more than a superinstruction or an interrupt can overshoot
+#define REWIND_CLOCK_MARGIN 32
+
+// Delta of the memory between two snapshots, for every changed page:
+//
+//   page number, tokens covering the 256 bytes of the page
+//
+// A token is a byte 'n': if n < 0x80 n + 1 unchanged bytes, otherwise
+// n - 0x7F changed bytes follow, XOR the previous content. The XOR makes the
+// delta work both ways, the snapshots are rebuilt backwards from the newest.
+
+// Append the delta of 'page' from 'previous'
+static void encode_page(std::vector<uint8_t> &out, const uint8_t *page,
+                        const uint8_t *previous) {
+  unsigned int i = 0;
+
+  while (i < 0x0100) {
+    const bool changed = page[i] != previous[i];
+    unsigned int n = 0;
+
+    while (i + n < 0x0100 && n < 0x80 &&
+           (page[i + n] != previous[i + n]) == changed) {
+      n++;
+    }
+
+    out.push_back((changed ? 0x80 : 0x00) | (n - 1));
+    for (unsigned int j = 0; changed && j < n; j++) {
+      out.push_back(page[i + j] ^ previous[i + j]);
+    }
+
+    i += n;
+  }
+}
+
+// Apply the tokens of a page at 'in' to 'page', return the end of the tokens
+static const uint8_t *apply_page(const uint8_t *in, uint8_t *page) {
+  unsigned int i = 0;
+
+  while (i < 0x0100) {
+    const uint8_t token = *in++;
+    const unsigned int n = (token & 0x7F) + 1;
+
+    for (unsigned int j = 0; (token & 0x80) && j < n; j++) {
+      page[i + j] ^= *in++;
+    }
+
+    i += n;
+  }
+
+  return in;
+}
+
+// Apply a whole delta to the 64KB 'memory', add its pages to the bitmap
+// 'pages' (page 'n' is the bit 'n % 64' of the word 'n / 64')
+static void apply_delta(const std::vector<uint8_t> &delta, uint8_t *memory,
+                        std::array<uint64_t, 4> &pages) {
+  const uint8_t *in = delta.data();
+  const uint8_t *end = in + delta.size();
+
+  while (in < end) {
+    const uint8_t page = *in++;
+    in = apply_page(in, memory + (page << 8));
+    pages[page >> 6] |= 1ull << (page & 0x3F);
+  }
+}
+
+Rewind::Rewind(MOS6502 &cpu, const uint64_t interval, const size_t capacity)
+    : cpu(cpu), interval(interval), capacity(capacity ? capacity : 1),
+      memory(REWIND_MEMORY_SIZE) {
+  cpu.set_dirty_tracking(true);
+}
+
+void Rewind::record() {
+  if (ring.empty() || cpu.cycles - ring.back().cycle >= interval) {
+    snapshot();
+  }
+}
+
+void Rewind::snapshot() {
+  if (ring.size() == capacity) {
+    drop_oldest();
+  }
+
+  snapshot_t snapshot{};
+  snapshot.cycle = cpu.cycles;
+  cpu.save_state(snapshot.state);
+
+  // The first snapshot reads the whole memory and has nothing before it, the
+  // others only the pages written since the previous one
+  const bool all = ring.empty() || !cpu.dirty_tracking;
+  uint8_t now[0x0100];
+
+  for (unsigned int page = 0; page < REWIND_PAGES; page++) {
+    // The pages of mem_access are the devices, not rewound
+    if ((!all && !cpu.is_page_dirty(page)) || !cpu.page_table[page].read) {
+      continue;
+    }
+
+    uint8_t *before = memory.data() + (page << 8);
+    cpu.read_pages(page, 1, now);
+
+    if (!ring.empty() && memcmp(now, before, 0x0100) != 0) {
+      snapshot.delta.push_back(page);
+      encode_page(snapshot.delta, now, before);
+    }
+
+    memcpy(before, now, 0x0100);
+  }
+
+  cpu.clear_dirty_pages();
+  snapshot.delta.shrink_to_fit();
+  ring.push_back(std::move(snapshot));
+}
+
+bool Rewind::rewind(const uint64_t cycle) {
+  const auto start = std::chrono::steady_clock::now();
+
+  if (cycle > cpu.cycles || ring.empty() || cycle < ring.front().cycle) {
+    return false;
+  }
+
+  // The pages to restore: the ones written since the newest snapshot and the
+  // ones changed by the deltas undone
+  std::array<uint64_t, 4> pages = cpu.get_dirty_pages();
+  if (!cpu.dirty_tracking) {
+    pages.fill(UINT64_MAX);
+  }
+
+  // Back to the newest snapshot not after 'cycle'
+  while (ring.back().cycle > cycle) {
+    apply_delta(ring.back().delta, memory.data(), pages);
+    ring.pop_back();
+  }
+
+  const snapshot_t &snapshot = ring.back();
+  if (!cpu.load_state(snapshot.state.data(), snapshot.state.size())) {
+    return false;
+  }
+
+  for (unsigned int page = 0; page < REWIND_PAGES; page++) {
+    if (((pages[page >> 6] >> (page & 0x3F)) & 1) &&
+        cpu.page_table[page].read) {
+      cpu.write_pages(page, 1, memory.data() + (page << 8));
+    }
+  }
+  cpu.clear_dirty_pages();
+
+  // Re-execute up to 'cycle', with the runs up to the last instructions
+  if (cycle > cpu.cycles + REWIND_CLOCK_MARGIN) {
+    cpu.run_until_cycle(cycle - REWIND_CLOCK_MARGIN);
+  }
+
+  while (cpu.cycles < cycle && !cpu.halted) {
+    cpu.clock();
+  }
+
+  latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+  return true;
+}
+
+void Rewind::set_interval(const uint64_t interval) {
+  this->interval = interval;
+}
+
+void Rewind::set_capacity(const size_t capacity) {
+  this->capacity = capacity ? capacity : 1;
+
+  while (ring.size() > this->capacity) {
+    drop_oldest();
+  }
+}
+
+void Rewind::clear() { ring.clear(); }
+
+uint64_t Rewind::oldest_cycle() const {
+  return ring.empty() ? UINT64_MAX : ring.front().cycle;
+}
+
+size_t Rewind::memory_usage() const {
+  size_t size = memory.size();
+
+  for (const snapshot_t &snapshot : ring) {
+    size += sizeof(snapshot) + snapshot.state.size() + snapshot.delta.size();
+  }
+
+  return size;
+}
+
+void Rewind::drop_oldest() {
+  ring.pop_front();
+
+  // The delta of the new oldest one leads to the dropped snapshot
+  if (!ring.empty()) {
+    ring.front().delta.clear();
+    ring.front().delta.shrink_to_fit();
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "mos6502.hpp"
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+#define REWIND_INTERVAL 10000 // Default cycles between the snapshots
+#define REWIND_CAPACITY 64    // Default snapshots kept
+
+// Rewind buffer of a MOS6502: it takes a snapshot of the cpu every
+// 'interval' cycles in a ring of 'capacity' snapshots (the oldest is dropped)
+// and brings the cpu back to any cycle after the oldest one, restoring the
+// nearest snapshot and re-executing up to that cycle.
+//
+// A snapshot is the state of MOS6502::save_state() plus its memory as a
+// delta: the pages changed since the previous snapshot, RLE encoded XOR the
+// previous content. Only the memory at the newest snapshot is kept whole,
+// the older ones are rebuilt from it applying the deltas backwards. The
+// pages are found with the dirty-page tracking of the cpu, enabled by the
+// Rewind, which clears the bitmap at every snapshot. A rewind restores only
+// the pages written since the newest snapshot and the ones changed by the
+// deltas it undoes, see MOS6502::write_pages().
+//
+// Only the mapped pages are rewound (see MOS6502::map_memory()), the pages
+// of mem_access are the devices. The memory and the cpu must change only by
+// the execution and the memory map must not change: the scheduled events
+// and the devices are not rewound.
+class Rewind {
+public:
+  explicit Rewind(MOS6502 &cpu, const uint64_t interval = REWIND_INTERVAL,
+                  const size_t capacity = REWIND_CAPACITY);
+
+  // Take a snapshot if 'interval' cycles passed since the last one (or if
+  // there is none). To be called while the cpu executes, e.g. after every
+  // clock() or between the runs
+  void record();
+  // Take a snapshot now
+  void snapshot();
+
+  // Bring the cpu back to 'cycle' (at that cycle exactly, also in the middle
+  // of an instruction). The snapshots after 'cycle' are dropped. Return false,
+  // leaving the cpu unchanged, if 'cycle' is in the future or before the
+  // oldest snapshot
+  bool rewind(const uint64_t cycle);
+
+  void set_interval(const uint64_t interval);
+  // Drop the oldest snapshots beyond the new capacity
+  void set_capacity(const size_t capacity);
+  void clear(); // Drop all the snapshots
+
+  size_t size() const { return ring.size(); } // Snapshots kept
+  // Cycle of the oldest snapshot, UINT64_MAX if there is none
+  uint64_t oldest_cycle() const;
+  // Host memory used by the snapshots, in bytes
+  size_t memory_usage() const;
+  // Host time taken by the last rewind(), in microseconds
+  uint64_t last_latency() const { return latency; }
+
+private:
+  struct snapshot_t {
+    uint64_t cycle;
+    std::vector<uint8_t> state; // save_state() without the memory image
+    std::vector<uint8_t> delta; // From the previous snapshot, see rewind.cpp
+  };
+
+  MOS6502 &cpu;
+  uint64_t interval;
+  size_t capacity;
+
+  std::deque<snapshot_t> ring; // Oldest first
+  std::vector<uint8_t> memory; // Memory at the newest snapshot
+  uint64_t latency = 0;        // See last_latency()
+
+  void drop_oldest();
+};
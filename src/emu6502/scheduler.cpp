@@ -0,0 +1,43 @@
+#include "scheduler.hpp"
+#include <algorithm>
+
+// Order of the heap, the first event has the lowest cycle and then id
+static bool later(const scheduled_event_t &a, const scheduled_event_t &b) {
+  return a.cycle != b.cycle ? a.cycle > b.cycle : a.id > b.id;
+}
+
+uint64_t Scheduler::add(const uint64_t cycle, event_callback callback,
+                        void *usr_data) {
+  const uint64_t id = m_next_id++;
+
+  m_events.push_back({cycle, id, callback, usr_data});
+  std::push_heap(m_events.begin(), m_events.end(), later);
+
+  return id;
+}
+
+bool Scheduler::cancel(const uint64_t id) {
+  auto it =
+      std::find_if(m_events.begin(), m_events.end(),
+                   [id](const scheduled_event_t &e) { return e.id == id; });
+  if (it == m_events.end()) {
+    return false;
+  }
+
+  m_events.erase(it);
+  std::make_heap(m_events.begin(), m_events.end(), later);
+  return true;
+}
+
+bool Scheduler::pop(const uint64_t cycle, scheduled_event_t &event) {
+  if (next() > cycle) {
+    return false;
+  }
+
+  std::pop_heap(m_events.begin(), m_events.end(), later);
+  event = m_events.back();
+  m_events.pop_back();
+  return true;
+}
+
+void Scheduler::clear() { m_events.clear(); }
@@ -0,0 +1,39 @@
+#pragma once
+#include "common.hpp"
+#include <stdint.h>
+#include <vector>
+
+// Event of the Scheduler
+struct scheduled_event_t {
+  uint64_t cycle;          // Cycle at which the event is due
+  uint64_t id;             // Returned by Scheduler::add(), never 0
+  event_callback callback; // Called when the event is dispatched
+  void *usr_data;          // Passed to the callback
+};
+
+// Events keyed by the cycle at which they are due, e.g. the timers of the
+// devices or the changes of the interrupt lines. The events due at the same
+// cycle are dispatched in the order they were added. The cpu keeps one, see
+// MOS6502::schedule()
+class Scheduler {
+public:
+  // Add the event due at 'cycle', return its id
+  uint64_t add(const uint64_t cycle, event_callback callback, void *usr_data);
+  // Remove the event 'id', return false if it is not pending
+  bool cancel(const uint64_t id);
+  // Remove the next event if it is due at 'cycle' and copy it in 'event',
+  // return false otherwise
+  bool pop(const uint64_t cycle, scheduled_event_t &event);
+  void clear(); // Remove all the events
+
+  // Cycle of the next event, UINT64_MAX if there is none
+  inline uint64_t next() const {
+    return m_events.empty() ? UINT64_MAX : m_events.front().cycle;
+  }
+
+  inline size_t size() const { return m_events.size(); }
+
+private:
+  std::vector<scheduled_event_t> m_events; // Min-heap on cycle and id
+  uint64_t m_next_id = 1;
+};
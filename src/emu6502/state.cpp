@@ -0,0 +1,293 @@
+#include "mos6502.hpp"
+#include "record.hpp"
+#include <cstring>
+
+// Layout of the state of save_state(), all little endian:
+//
+//   magic "6502", version, flags (STATE_MEMORY)
+//   the fields of state_t in order
+//   the 64KB of memory, if STATE_MEMORY
+//
+// A new field needs a new STATE_VERSION.
+#define STATE_VERSION 1
+#define STATE_HEADER_SIZE 6
+#define STATE_SIZE (STATE_HEADER_SIZE + 37)
+#define STATE_MEMORY_SIZE (64 * 1024)
+
+#define STATE_MEMORY (1 << 0) // The flags
+
+#define STATE_HALTED (1 << 0) // The signals
+#define STATE_IRQ_LINE (1 << 1)
+#define STATE_NMI_LINE (1 << 2)
+#define STATE_NMI_PENDING (1 << 3)
+#define STATE_IRQ_REQUEST (1 << 4)
+
+#define STATE_INSTRUCTION_TABLE 0 // The instruction of 'opcode'
+#define STATE_INSTRUCTION_IRQ 1   // The IRQ sequence
+#define STATE_INSTRUCTION_NMI 2   // The NMI sequence
+
+static const uint8_t state_magic[4] = {'6', '5', '0', '2'};
+
+// The saved fields of the cpu, without pointers
+struct state_t {
+  uint8_t A, X, Y, P, S;
+  uint16_t PC;
+  uint64_t cycles;
+  uint8_t signals; // STATE_HALTED, STATE_IRQ_LINE, ...
+
+  // Position in the instruction in flight
+  uint8_t opcode;
+  uint8_t instruction; // STATE_INSTRUCTION_*
+  uint8_t microcode_step;
+  uint8_t microcode_len;
+  uint8_t addrmode_len;
+  uint8_t accumulator_addressing;
+
+  uint8_t data_bus;
+  uint16_t address_bus, relative_adderess, tmp_buff, hi, lo;
+
+  uint16_t PC_executed;
+  uint8_t arg1, arg2;
+};
+
+// Write or read a field of 'bytes' bytes and advance the position
+static void put(uint8_t *&out, const uint64_t val, const unsigned int bytes) {
+  for (unsigned int i = 0; i < bytes; i++) {
+    *out++ = (val >> (8 * i)) & 0xFF;
+  }
+}
+
+template <typename T> static void get(const uint8_t *&in, T &val) {
+  uint64_t tmp = 0;
+  for (unsigned int i = 0; i < sizeof(T); i++) {
+    tmp |= static_cast<uint64_t>(*in++) << (8 * i);
+  }
+  val = static_cast<T>(tmp);
+}
+
+// Apply F(field) to the fields of state_t in the order of the layout
+template <typename State, typename F>
+static void for_each_field(State &s, F f) {
+  f(s.A), f(s.X), f(s.Y), f(s.P), f(s.S), f(s.PC), f(s.cycles), f(s.signals);
+  f(s.opcode), f(s.instruction), f(s.microcode_step), f(s.microcode_len);
+  f(s.addrmode_len), f(s.accumulator_addressing);
+  f(s.data_bus), f(s.address_bus), f(s.relative_adderess), f(s.tmp_buff);
+  f(s.hi), f(s.lo);
+  f(s.PC_executed), f(s.arg1), f(s.arg2);
+}
+
+void MOS6502::save_state(std::vector<uint8_t> &out, const bool memory) const {
+  state_t s{};
+
+  s.A = A;
+  s.X = X;
+  s.Y = Y;
+  s.P = P;
+  s.S = S;
+  s.PC = PC;
+  s.cycles = cycles;
+  s.signals = (halted ? STATE_HALTED : 0) | (irq_line ? STATE_IRQ_LINE : 0) |
+              (nmi_line ? STATE_NMI_LINE : 0) |
+              (nmi_pending ? STATE_NMI_PENDING : 0) |
+              (irq_request ? STATE_IRQ_REQUEST : 0);
+
+  s.opcode = opcode;
+  s.instruction = STATE_INSTRUCTION_TABLE;
+  if (instruction == &irq_instruction) {
+    s.instruction = STATE_INSTRUCTION_IRQ;
+  } else if (instruction == &nmi_instruction) {
+    s.instruction = STATE_INSTRUCTION_NMI;
+  }
+  s.microcode_step = microcode_step;
+  s.microcode_len = microcode_len;
+  s.addrmode_len = addrmode_len;
+  s.accumulator_addressing = accumulator_addressing;
+
+  s.data_bus = data_bus;
+  s.address_bus = address_bus;
+  s.relative_adderess = relative_adderess;
+  s.tmp_buff = tmp_buff;
+  s.hi = hi;
+  s.lo = lo;
+
+  s.PC_executed = PC_executed;
+  s.arg1 = arg1;
+  s.arg2 = arg2;
+
+  out.resize(STATE_SIZE + (memory ? STATE_MEMORY_SIZE : 0));
+  uint8_t *p = out.data();
+
+  memcpy(p, state_magic, sizeof(state_magic));
+  p += sizeof(state_magic);
+  put(p, STATE_VERSION, 1);
+  put(p, memory ? STATE_MEMORY : 0, 1);
+  for_each_field(s, [&p](const auto &field) { put(p, field, sizeof(field)); });
+
+  if (!memory) {
+    return;
+  }
+
+  read_pages(0x00, page_table.size(), p);
+}
+
+bool MOS6502::load_state(const uint8_t *data, const size_t size) {
+  if (size < STATE_SIZE || memcmp(data, state_magic, sizeof(state_magic))) {
+    log("Not a state of the cpu");
+    return false;
+  }
+
+  const uint8_t *p = data + sizeof(state_magic);
+  uint8_t version, flags;
+  get(p, version);
+  get(p, flags);
+
+  if (version != STATE_VERSION) {
+    log("Unsupported version of the state");
+    return false;
+  }
+
+  const bool memory = flags & STATE_MEMORY;
+  if (size != STATE_SIZE + (memory ? STATE_MEMORY_SIZE : 0)) {
+    log("Wrong size of the state");
+    return false;
+  }
+
+  state_t s;
+  for_each_field(s, [&p](auto &field) { get(p, field); });
+
+  // The instruction in flight must be a valid position (it is not checked
+  // between the instructions), the cpu is not changed otherwise
+  const instruction_t *in_flight = nullptr;
+  switch (s.instruction) {
+  case STATE_INSTRUCTION_TABLE:
+    in_flight = &instruction_table[s.opcode];
+    break;
+  case STATE_INSTRUCTION_IRQ:
+    in_flight = &irq_instruction;
+    break;
+  case STATE_INSTRUCTION_NMI:
+    in_flight = &nmi_instruction;
+    break;
+  }
+
+  if (!in_flight || s.microcode_step > s.microcode_len ||
+      (s.microcode_step != s.microcode_len &&
+       (s.addrmode_len != (in_flight->operation->own_addressing
+                               ? 0
+                               : in_flight->addrmode->length) ||
+        s.microcode_len != s.addrmode_len + in_flight->operation->length))) {
+    log("Corrupted instruction in the state");
+    return false;
+  }
+
+  A = s.A;
+  X = s.X;
+  Y = s.Y;
+  P = s.P;
+  S = s.S;
+  PC = s.PC;
+  cycles = s.cycles;
+
+  halted = s.signals & STATE_HALTED;
+  irq_line = s.signals & STATE_IRQ_LINE;
+  nmi_line = s.signals & STATE_NMI_LINE;
+  nmi_pending = s.signals & STATE_NMI_PENDING;
+  irq_request = s.signals & STATE_IRQ_REQUEST;
+
+  opcode = s.opcode;
+  instruction = in_flight;
+  microcode_step = s.microcode_step;
+  microcode_len = s.microcode_len;
+  addrmode_len = s.addrmode_len;
+  accumulator_addressing = s.accumulator_addressing;
+
+  data_bus = s.data_bus;
+  address_bus = s.address_bus;
+  relative_adderess = s.relative_adderess;
+  tmp_buff = s.tmp_buff;
+  hi = s.hi;
+  lo = s.lo;
+
+  PC_executed = s.PC_executed;
+  arg1 = s.arg1;
+  arg2 = s.arg2;
+
+  if (!memory) {
+    return true;
+  }
+
+  write_pages(0x00, page_table.size(), p);
+  return true;
+}
+
+void MOS6502::read_pages(const uint8_t page, const unsigned int count,
+                         uint8_t *out) const {
+  if (page + count > page_table.size()) {
+    log("Can not read the pages beyond the end of the memory");
+    return;
+  }
+
+  // The mapped pages are copied, the others are read from the devices
+  for (unsigned int i = page; i < page + count; i++) {
+    if (page_table[i].read) {
+      memcpy(out, page_table[i].read, 0x0100);
+      out += 0x0100;
+      continue;
+    }
+
+    for (unsigned int j = 0; j < 0x0100; j++) {
+      mem_access(user_data, (i << 8) | j, access_mode_t::READ_ONLY, *out++);
+    }
+  }
+}
+
+void MOS6502::write_pages(const uint8_t page, const unsigned int count,
+                          const uint8_t *in) {
+  if (page + count > page_table.size()) {
+    log("Can not write the pages beyond the end of the memory");
+    return;
+  }
+
+  // The pages mapped writable are written directly, the others through the
+  // devices like the writes of the cpu (e.g. the shared pages of a
+  // CowMemory, copied before the write)
+  for (unsigned int i = page; i < page + count; i++) {
+    if (page_table[i].write) {
+      memcpy(page_table[i].write, in, 0x0100);
+      in += 0x0100;
+    } else {
+      for (unsigned int j = 0; j < 0x0100; j++) {
+        uint8_t val = *in++;
+        mem_access(user_data, (i << 8) | j, access_mode_t::WRITE, val);
+      }
+    }
+
+    if (dirty_tracking) {
+      mark_dirty(dirty_pages.data(), i << 8);
+    }
+  }
+
+  invalidate_code(page, count);
+}
+
+std::unique_ptr<MOS6502> MOS6502::clone() const {
+  std::unique_ptr<MOS6502> copy =
+      std::make_unique<MOS6502>(mem_access, user_data);
+
+  std::vector<uint8_t> state;
+  save_state(state);
+  copy->load_state(state.data(), state.size());
+
+  copy->page_table = page_table;
+  copy->stable_reads = stable_reads;
+  copy->log_func = log_func;
+  copy->profiling = profiling;
+
+  // The clone of a recorded cpu is not recorded
+  if (recorder) {
+    copy->mem_access = recorder->get_callback();
+    copy->user_data = recorder->get_user_data();
+  }
+
+  return copy;
+}
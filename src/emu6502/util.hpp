@@ -5,14 +5,30 @@
 #include <cstring>
 #include <stdint.h>
 #include <string>
-#include <sys/time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
 
 // Functions
 std::string uint16_to_hex(const uint16_t i, bool prefix = false);
 std::string uint8_to_bin(const uint8_t i);
 std::string uint16_to_bin(const uint16_t i);
 void build_log_str(char *out, const p_state_t &s);
-int64_t time_diff(const timeval *t1, const timeval *t2);
+
+// Cheap monotonic host counter used by the profiling. It is the time stamp
+// counter on x86 and the steady clock in nanoseconds elsewhere
+inline uint64_t host_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
 
 // Classes
 template <typename T, uint32_t S> class Queue {
@@ -0,0 +1,568 @@
+#include "recompiler.hpp"
+#include <cstdlib>
+#include <cstring>
+
+#define NMI_VECTOR 0xFFFA
+#define RESET_VECTOR 0xFFFC
+#define IRQ_VECTOR 0xFFFE
+
+// Hex literal of 'val' with 'digits' digits
+static std::string hex(const unsigned int val, const int digits) {
+  char buff[8];
+  snprintf(buff, sizeof(buff), "0x%0*X", digits, val);
+  return buff;
+}
+
+// Label of the block at 'pc' in the generated code
+static std::string label(const uint16_t pc) {
+  char buff[8];
+  snprintf(buff, sizeof(buff), "L%04X", pc);
+  return buff;
+}
+
+bool Recompiler::load(const char *file, const long offset, const long length,
+                      const uint16_t address) {
+  FILE *in = fopen(file, "rb");
+
+  if (in == nullptr) {
+    printf("Can not open the file %s\n", file);
+    return false;
+  }
+
+  // get the file size
+  fseek(in, 0, SEEK_END);
+  long size = ftell(in) - offset;
+  fseek(in, offset, SEEK_SET);
+
+  if (length > 0 && length < size) {
+    size = length;
+  }
+
+  if (size <= 0 || address + size > (long)mem.size()) {
+    printf("The binary does not fit in the memory\n");
+    fclose(in);
+    return false;
+  }
+
+  if (fread(mem.data() + address, sizeof(uint8_t), size, in) != (size_t)size) {
+    printf("Failed read the binary from file\n");
+    fclose(in);
+    return false;
+  }
+
+  fclose(in);
+
+  for (long i = 0; i < size; i++) {
+    loaded[address + i] = true;
+  }
+
+  return true;
+}
+
+void Recompiler::add_entry(const uint16_t pc) { entries.push_back(pc); }
+
+bool Recompiler::decodable(const uint16_t pc) const {
+  const opcode_t &info = opcode_table[mem[pc]];
+
+  if (!loaded[pc] || info.instruction_bytes == 0) {
+    return false;
+  }
+
+  for (unsigned int i = 1; i < info.instruction_bytes; i++) {
+    if (pc + i >= mem.size() || !loaded[pc + i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Recompiler::interpreted(const opcode_t &info) {
+  using O = operation_t;
+
+  // The unofficial opcodes are prefixed by '*', the illegal ones are '???'.
+  // CLI and PLP can unmask the IRQ, the engine takes it after them
+  return info.name[0] == '*' || info.name[0] == '?' ||
+         info.operation == O::BRK || info.operation == O::RTI ||
+         info.operation == O::CLI || info.operation == O::PLP;
+}
+
+uint16_t Recompiler::operand(const uint16_t pc) const {
+  return mem[pc + 1] | (mem[pc + 2] << 8);
+}
+
+uint16_t Recompiler::branch_target(const uint16_t pc) const {
+  return pc + 2 + static_cast<int8_t>(mem[pc + 1]);
+}
+
+void Recompiler::analyze() {
+  using O = operation_t;
+  std::vector<uint16_t> work;
+
+  auto add_leader = [this, &work](const uint16_t pc) {
+    if (decodable(pc) && !leader[pc]) {
+      leader[pc] = true;
+      work.push_back(pc);
+    }
+  };
+
+  // The vectors covered by the binary are entries too
+  for (const uint16_t vector : {NMI_VECTOR, RESET_VECTOR, IRQ_VECTOR}) {
+    if (loaded[vector] && loaded[vector + 1]) {
+      add_leader(mem[vector] | (mem[vector + 1] << 8));
+    }
+  }
+
+  for (const uint16_t pc : entries) {
+    add_leader(pc);
+  }
+
+  // Follow the flow of every block until it leaves the block
+  while (!work.empty()) {
+    uint16_t pc = work.back();
+    work.pop_back();
+
+    while (decodable(pc)) {
+      const opcode_t &info = opcode_table[mem[pc]];
+      const uint16_t next = pc + info.instruction_bytes;
+      decoded[pc] = true;
+
+      if (interpreted(info)) {
+        // The interpreter returns to the dispatch, after it the flow goes on
+        // from the next instruction
+        if (info.operation == O::BRK) {
+          add_leader(pc + 2);
+        } else if (info.operation != O::RTI) {
+          add_leader(next);
+        }
+        break;
+      }
+
+      if (info.addressing == addressing_t::REL) {
+        add_leader(branch_target(pc));
+        add_leader(next);
+        break;
+      }
+
+      if (info.operation == O::JSR) {
+        add_leader(operand(pc));
+        add_leader(next); // The return address
+        break;
+      }
+
+      if (info.operation == O::JMP) {
+        if (info.addressing == addressing_t::ABS) {
+          add_leader(operand(pc));
+        }
+        break;
+      }
+
+      if (info.operation == O::RTS || leader[next]) {
+        break;
+      }
+
+      pc = next;
+    }
+  }
+}
+
+size_t Recompiler::blocks() const {
+  size_t count = 0;
+  for (const bool val : leader) {
+    count += val;
+  }
+  return count;
+}
+
+size_t Recompiler::instructions() const {
+  size_t count = 0;
+  for (const bool val : decoded) {
+    count += val;
+  }
+  return count;
+}
+
+unsigned int Recompiler::max_cycles(uint16_t pc) const {
+  using O = operation_t;
+  unsigned int cycles = 0;
+
+  while (true) {
+    const opcode_t &info = opcode_table[mem[pc]];
+
+    if (interpreted(info)) {
+      return cycles;
+    }
+
+    cycles += info.cycles + (info.page_penalty ? 1 : 0);
+
+    if (info.addressing == addressing_t::REL) {
+      return cycles + 2;
+    }
+
+    const uint16_t next = pc + info.instruction_bytes;
+    if (info.operation == O::JSR || info.operation == O::JMP ||
+        info.operation == O::RTS || leader[next] || !decoded[next]) {
+      return cycles;
+    }
+
+    pc = next;
+  }
+}
+
+void Recompiler::emit_jump(FILE *out, const char *indent,
+                           const uint16_t target) const {
+  if (leader[target]) {
+    fprintf(out, "%sgoto %s;\n", indent, label(target).c_str());
+  } else {
+    // Out of the binary, the interpreter takes it from there
+    fprintf(out, "%sc.PC = %s;\n%sgoto dispatch;\n", indent,
+            hex(target, 4).c_str(), indent);
+  }
+}
+
+void Recompiler::emit_instruction(FILE *out, const uint16_t pc) const {
+  using A = addressing_t;
+  using O = operation_t;
+  const opcode_t &info = opcode_table[mem[pc]];
+  const std::string zp = hex(mem[pc + 1], 2);
+  const std::string abs = hex(operand(pc), 4);
+  const char *penalty = info.page_penalty ? "true" : "false";
+
+  // Effective address and operand value
+  std::string address;
+  switch (info.addressing) {
+  case A::ZPI: address = zp; break;
+  case A::ZPX: address = "static_cast<uint8_t>(" + zp + " + c.X)"; break;
+  case A::ZPY: address = "static_cast<uint8_t>(" + zp + " + c.Y)"; break;
+  case A::ABS: address = abs; break;
+  case A::ABX: address = "c.indexed(" + abs + ", c.X, " + penalty + ")"; break;
+  case A::ABY: address = "c.indexed(" + abs + ", c.Y, " + penalty + ")"; break;
+  case A::IIX: address = "c.indirect_x(" + zp + ")"; break;
+  case A::IIY: address = "c.indirect_y(" + zp + ", " + penalty + ")"; break;
+  default: break;
+  }
+
+  const std::string val =
+      info.addressing == A::IMM ? zp : "c.read(" + address + ")";
+
+  // Read-Modify-Write of the operand through c.<op>()
+  auto modify = [&](const char *op) {
+    if (info.addressing == A::ACC) {
+      fprintf(out, "  c.A = c.%s(c.A);\n", op);
+    } else {
+      fprintf(out, "  {\n    uint16_t address = %s;\n", address.c_str());
+      fprintf(out, "    c.write(address, c.%s(c.read(address)));\n  }\n", op);
+    }
+  };
+
+  fprintf(out, "  // %04X: %.*s\n", pc, (int)info.name.size(),
+          info.name.data());
+
+  switch (info.operation) {
+  case O::ADC: fprintf(out, "  c.adc(%s);\n", val.c_str()); break;
+  case O::SBC: fprintf(out, "  c.sbc(%s);\n", val.c_str()); break;
+  case O::AND: fprintf(out, "  c.set_ZN(c.A &= %s);\n", val.c_str()); break;
+  case O::ORA: fprintf(out, "  c.set_ZN(c.A |= %s);\n", val.c_str()); break;
+  case O::EOR: fprintf(out, "  c.set_ZN(c.A ^= %s);\n", val.c_str()); break;
+  case O::BIT: fprintf(out, "  c.bit(%s);\n", val.c_str()); break;
+  case O::CMP: fprintf(out, "  c.compare(c.A, %s);\n", val.c_str()); break;
+  case O::CPX: fprintf(out, "  c.compare(c.X, %s);\n", val.c_str()); break;
+  case O::CPY: fprintf(out, "  c.compare(c.Y, %s);\n", val.c_str()); break;
+  case O::LDA: fprintf(out, "  c.set_ZN(c.A = %s);\n", val.c_str()); break;
+  case O::LDX: fprintf(out, "  c.set_ZN(c.X = %s);\n", val.c_str()); break;
+  case O::LDY: fprintf(out, "  c.set_ZN(c.Y = %s);\n", val.c_str()); break;
+
+  case O::STA:
+    fprintf(out, "  c.write(%s, c.A);\n", address.c_str());
+    break;
+  case O::STX:
+    fprintf(out, "  c.write(%s, c.X);\n", address.c_str());
+    break;
+  case O::STY:
+    fprintf(out, "  c.write(%s, c.Y);\n", address.c_str());
+    break;
+
+  case O::ASL: modify("asl"); break;
+  case O::LSR: modify("lsr"); break;
+  case O::ROL: modify("rol"); break;
+  case O::ROR: modify("ror"); break;
+  case O::INC: modify("inc"); break;
+  case O::DEC: modify("dec"); break;
+
+  case O::INX: fprintf(out, "  c.set_ZN(++c.X);\n"); break;
+  case O::INY: fprintf(out, "  c.set_ZN(++c.Y);\n"); break;
+  case O::DEX: fprintf(out, "  c.set_ZN(--c.X);\n"); break;
+  case O::DEY: fprintf(out, "  c.set_ZN(--c.Y);\n"); break;
+  case O::TAX: fprintf(out, "  c.set_ZN(c.X = c.A);\n"); break;
+  case O::TAY: fprintf(out, "  c.set_ZN(c.Y = c.A);\n"); break;
+  case O::TSX: fprintf(out, "  c.set_ZN(c.X = c.S);\n"); break;
+  case O::TXA: fprintf(out, "  c.set_ZN(c.A = c.X);\n"); break;
+  case O::TYA: fprintf(out, "  c.set_ZN(c.A = c.Y);\n"); break;
+  case O::TXS: fprintf(out, "  c.S = c.X;\n"); break;
+
+  case O::PHA: fprintf(out, "  c.push(c.A);\n"); break;
+  case O::PHP: fprintf(out, "  c.php();\n"); break;
+  case O::PLA: fprintf(out, "  c.set_ZN(c.A = c.pull());\n"); break;
+
+  case O::CLC: fprintf(out, "  c.carry = false;\n"); break;
+  case O::SEC: fprintf(out, "  c.carry = true;\n"); break;
+  case O::CLV: fprintf(out, "  c.overflow = false;\n"); break;
+  case O::CLD: fprintf(out, "  c.P &= ~MOS6502::D;\n"); break;
+  case O::SED: fprintf(out, "  c.P |= MOS6502::D;\n"); break;
+  case O::SEI: fprintf(out, "  c.P |= MOS6502::I;\n"); break;
+
+  default: // NOP and the flow changes, emitted by emit_block()
+    break;
+  }
+}
+
+void Recompiler::emit_block(FILE *out, uint16_t pc) const {
+  using O = operation_t;
+
+  fprintf(out, "%s:\n", label(pc).c_str());
+
+  if (interpreted(opcode_table[mem[pc]])) {
+    fprintf(out, "  c.PC = %s;\n  goto interpret;\n\n", hex(pc, 4).c_str());
+    return;
+  }
+
+  // The whole block must fit in the run, the interpreter executes the last
+  // instructions one by one
+  fprintf(out, "  if (!c.fits(%u)) {\n", max_cycles(pc));
+  fprintf(out, "    c.PC = %s;\n    goto interpret;\n  }\n",
+          hex(pc, 4).c_str());
+
+  unsigned int cycles = 0; // Base cycles of the block
+
+  while (true) {
+    const opcode_t &info = opcode_table[mem[pc]];
+    const uint16_t next = pc + info.instruction_bytes;
+
+    if (interpreted(info)) {
+      fprintf(out, "  c.cycles += %u;\n", cycles);
+      fprintf(out, "  c.PC = %s;\n  goto interpret;\n\n", hex(pc, 4).c_str());
+      return;
+    }
+
+    emit_instruction(out, pc);
+    cycles += info.cycles;
+
+    if (info.addressing == addressing_t::REL) {
+      static const char *conditions[] = {
+          "!c.carry", "c.carry",     "c.zero()",  "c.negative()",
+          "!c.zero()", "!c.negative()", "!c.overflow", "c.overflow"};
+      const char *condition = "";
+
+      switch (info.operation) {
+      case O::BCC: condition = conditions[0]; break;
+      case O::BCS: condition = conditions[1]; break;
+      case O::BEQ: condition = conditions[2]; break;
+      case O::BMI: condition = conditions[3]; break;
+      case O::BNE: condition = conditions[4]; break;
+      case O::BPL: condition = conditions[5]; break;
+      case O::BVC: condition = conditions[6]; break;
+      default: condition = conditions[7]; break;
+      }
+
+      // One cycle if taken and one more if it crosses the page, both known
+      const uint16_t target = branch_target(pc);
+      fprintf(out, "  c.cycles += %u;\n", cycles);
+      fprintf(out, "  if (%s) {\n", condition);
+      fprintf(out, "    c.cycles += %u;\n", ((target ^ next) & 0xFF00) ? 2 : 1);
+      emit_jump(out, "    ", target);
+      fprintf(out, "  }\n");
+      emit_jump(out, "  ", next);
+      fprintf(out, "\n");
+      return;
+    }
+
+    if (info.operation == O::JSR) {
+      fprintf(out, "  c.jsr(%s);\n", hex(pc, 4).c_str());
+      fprintf(out, "  c.cycles += %u;\n", cycles);
+      emit_jump(out, "  ", operand(pc));
+      fprintf(out, "\n");
+      return;
+    }
+
+    if (info.operation == O::JMP) {
+      fprintf(out, "  c.cycles += %u;\n", cycles);
+
+      if (info.addressing == addressing_t::ABS) {
+        emit_jump(out, "  ", operand(pc));
+      } else {
+        fprintf(out, "  c.PC = c.indirect(%s);\n  goto dispatch;\n",
+                hex(operand(pc), 4).c_str());
+      }
+
+      fprintf(out, "\n");
+      return;
+    }
+
+    if (info.operation == O::RTS) {
+      fprintf(out, "  c.rts();\n  c.cycles += %u;\n  goto dispatch;\n\n",
+              cycles);
+      return;
+    }
+
+    if (leader[next] || !decoded[next]) {
+      fprintf(out, "  c.cycles += %u;\n", cycles);
+      emit_jump(out, "  ", next);
+      fprintf(out, "\n");
+      return;
+    }
+
+    pc = next;
+  }
+}
+
+bool Recompiler::emit(const char *file, const std::string &name) const {
+  FILE *out = fopen(file, "w");
+
+  if (out == nullptr) {
+    printf("Can not open the file %s\n", file);
+    return false;
+  }
+
+  fprintf(out, "// Generated by the recompiler, do not edit\n");
+  fprintf(out, "#pragma once\n#include \"recompiled.hpp\"\n\n");
+  fprintf(out, "// %zu blocks, %zu instructions\n", blocks(), instructions());
+  fprintf(out, "template <typename Bus>\n");
+  fprintf(out, "run_result_t %s_run(MOS6502 &cpu, Bus &bus, const uint64_t "
+               "budget) {\n",
+          name.c_str());
+  fprintf(out, "  RecompiledCpu<Bus> c(cpu, bus, budget);\n\n");
+
+  // Dispatch on the PC after the flow changes that are not known statically
+  fprintf(out, "dispatch:\n");
+  fprintf(out, "  if (c.done()) {\n    return c.finish();\n  }\n\n");
+  fprintf(out, "  switch (c.PC) {\n");
+  for (size_t pc = 0; pc < leader.size(); pc++) {
+    if (leader[pc]) {
+      fprintf(out, "  case %s:\n    goto %s;\n", hex(pc, 4).c_str(),
+              label(pc).c_str());
+    }
+  }
+  fprintf(out, "  default:\n    break;\n  }\n\n");
+
+  // Not recompiled, one instruction on the interpreter
+  fprintf(out, "interpret:\n");
+  fprintf(out, "  c.interpret();\n  goto dispatch;\n\n");
+
+  for (size_t pc = 0; pc < leader.size(); pc++) {
+    if (leader[pc]) {
+      emit_block(out, pc);
+    }
+  }
+
+  fprintf(out, "}\n");
+  fclose(out);
+  return true;
+}
+
+// Parse an address, in hex with the '$' or '0x' prefix or in decimal
+static bool parse(const char *str, long &val) {
+  char *end = nullptr;
+
+  if (str[0] == '$') {
+    val = strtol(str + 1, &end, 16);
+  } else {
+    val = strtol(str, &end, 0);
+  }
+
+  return *str != '\0' && *end == '\0' && val >= 0;
+}
+
+static void usage() {
+  printf("Usage: recompiler [options] <binary> <load address>\n"
+         "  -o <file>     output header (default: recompiled.hpp)\n"
+         "  -n <name>     name of the function <name>_run (default: "
+         "recompiled)\n"
+         "  -e <address>  entry point, can be repeated (default: the load "
+         "address)\n"
+         "  -s <offset>   skip the first bytes of the file (e.g. a header)\n"
+         "  -l <length>   bytes of the file to load (default: all)\n");
+}
+
+int main(int argc, char **argv) {
+  const char *output = "recompiled.hpp";
+  std::string name = "recompiled";
+  std::vector<long> entries;
+  long offset = 0;
+  long length = 0;
+  std::vector<const char *> args;
+
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] != '-' || argv[i][1] == '\0') {
+      args.push_back(argv[i]);
+      continue;
+    }
+
+    if (i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+
+    long val = 0;
+    const char *arg = argv[++i];
+
+    switch (argv[i - 1][1]) {
+    case 'o':
+      output = arg;
+      break;
+    case 'n':
+      name = arg;
+      break;
+    case 'e':
+      if (!parse(arg, val) || val > 0xFFFF) {
+        usage();
+        return 1;
+      }
+      entries.push_back(val);
+      break;
+    case 's':
+      if (!parse(arg, offset)) {
+        usage();
+        return 1;
+      }
+      break;
+    case 'l':
+      if (!parse(arg, length)) {
+        usage();
+        return 1;
+      }
+      break;
+    default:
+      usage();
+      return 1;
+    }
+  }
+
+  long address = 0;
+  if (args.size() != 2 || !parse(args[1], address) || address > 0xFFFF) {
+    usage();
+    return 1;
+  }
+
+  Recompiler recompiler;
+  if (!recompiler.load(args[0], offset, length, address)) {
+    return 1;
+  }
+
+  if (entries.empty()) {
+    entries.push_back(address);
+  }
+
+  for (const long entry : entries) {
+    recompiler.add_entry(entry);
+  }
+
+  recompiler.analyze();
+
+  if (!recompiler.emit(output, name)) {
+    return 1;
+  }
+
+  printf("%s: %zu blocks, %zu instructions\n", output, recompiler.blocks(),
+         recompiler.instructions());
+  return 0;
+}
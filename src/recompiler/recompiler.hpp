@@ -0,0 +1,66 @@
+#pragma once
+#include "opcode.hpp"
+#include <array>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Static recompiler of a 6502 binary into C++ source.
+//
+// The binary is disassembled by following the flow from the entry points
+// (and the vectors, if the binary covers them): the targets of the branches,
+// JMP and JSR, the instructions after the branches and the JSRs (the return
+// addresses) and the instructions after the interpreted ones start a basic
+// block. The flow can not be followed through JMP ($xxxx), RTS and RTI, the
+// generated code goes back to a dispatch on the PC there.
+//
+// The output is a header with a template function on the Bus, that runs the
+// blocks on a RecompiledCpu (see recompiled.hpp):
+//
+//   template <typename Bus>
+//   run_result_t <name>_run(MOS6502 &cpu, Bus &bus, const uint64_t budget);
+//
+// The official instructions are translated, the unofficial ones, BRK and RTI
+// are left to the interpreter.
+class Recompiler {
+public:
+  // Load 'length' bytes (all the file if 0) from 'offset' of 'file' at
+  // 'address'
+  bool load(const char *file, const long offset, const long length,
+            const uint16_t address);
+  void add_entry(const uint16_t pc);
+
+  // Disassemble the code reachable from the entries
+  void analyze();
+
+  // Write the C++ of the code with the function '<name>_run'
+  bool emit(const char *file, const std::string &name) const;
+
+  size_t blocks() const;
+  size_t instructions() const;
+
+private:
+  std::array<uint8_t, 64 * 1024> mem = {};
+  std::array<bool, 64 * 1024> loaded = {};  // The byte is in the binary
+  std::array<bool, 64 * 1024> decoded = {}; // An instruction starts here
+  std::array<bool, 64 * 1024> leader = {};  // A basic block starts here
+  std::vector<uint16_t> entries;
+
+  // The whole instruction at 'pc' is in the binary
+  bool decodable(const uint16_t pc) const;
+  // The instruction is left to the interpreter
+  static bool interpreted(const opcode_t &info);
+
+  uint16_t operand(const uint16_t pc) const; // The 16-bit operand at pc + 1
+  uint16_t branch_target(const uint16_t pc) const;
+
+  // Cycles of the block at 'pc', page crossing and branch taken included
+  unsigned int max_cycles(uint16_t pc) const;
+
+  void emit_block(FILE *out, uint16_t pc) const;
+  // Emit the instruction at 'pc', except the flow changes
+  void emit_instruction(FILE *out, const uint16_t pc) const;
+  // Emit the jump to the code at 'target', a block or the dispatch
+  void emit_jump(FILE *out, const char *indent, const uint16_t target) const;
+};
@@ -0,0 +1,143 @@
+// Microbenchmark of the table-driven ALU (alu.hpp) versus the arithmetic of
+// the engines. Every kernel updates A and the P register like the
+// cycle-accurate engine does, on random operands. ADC has no table: its
+// column is the N and Z lookup of MOS6502::add().
+//
+// Not a test, run it by hand: ./alu_bench [iterations]
+#include <chrono>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "alu.hpp"
+#include "mos6502.hpp"
+
+#define DEFAULT_ITERATIONS 50000000
+#define FLAGS_MASK (MOS6502::N | MOS6502::O | MOS6502::Z | MOS6502::C)
+
+struct registers_t {
+  uint8_t A;
+  uint8_t P;
+};
+
+static void set_flag(registers_t &r, const MOS6502::status_flag_t flag,
+                     const bool val) {
+  if (val) {
+    r.P |= flag;
+  } else {
+    r.P &= ~flag;
+  }
+}
+
+static void set_ZN(registers_t &r, const uint8_t val) {
+  set_flag(r, MOS6502::Z, val == 0x00);
+  set_flag(r, MOS6502::N, val & 0x80);
+}
+
+/********************************************************
+ *                     ARITHMETIC                       *
+ ********************************************************/
+static void adc_arithmetic(registers_t &r, const uint8_t val) {
+  uint16_t tmp = static_cast<uint16_t>(r.A) + val + (r.P & MOS6502::C);
+
+  set_flag(r, MOS6502::C, tmp > 0x00FF);
+  set_flag(r, MOS6502::O, ~(r.A ^ val) & (r.A ^ tmp) & 0x0080);
+  r.A = tmp & 0x00FF;
+  set_ZN(r, r.A);
+}
+
+static void cmp_arithmetic(registers_t &r, const uint8_t val) {
+  set_flag(r, MOS6502::C, r.A >= val);
+  set_ZN(r, r.A - val);
+  r.A += val; // Keep the operands changing
+}
+
+static void rol_arithmetic(registers_t &r, const uint8_t val) {
+  uint8_t carry = r.P & MOS6502::C;
+  set_flag(r, MOS6502::C, (r.A ^ val) & 0x80);
+  r.A = ((r.A ^ val) << 1) | carry;
+  set_ZN(r, r.A);
+}
+
+/********************************************************
+ *                       TABLES                         *
+ ********************************************************/
+// ADC has no table, only the N and Z of the result, like MOS6502::add()
+static void adc_table_driven(registers_t &r, const uint8_t val) {
+  uint16_t tmp = static_cast<uint16_t>(r.A) + val + (r.P & MOS6502::C);
+  uint8_t overflow = (~(r.A ^ val) & (r.A ^ tmp) & 0x0080) ? MOS6502::O : 0;
+
+  r.A = tmp & 0x00FF;
+  r.P = (r.P & ~FLAGS_MASK) | nz_table[r.A] | overflow | (tmp >> 8);
+}
+
+static void cmp_table_driven(registers_t &r, const uint8_t val) {
+  r.P = (r.P & ~(MOS6502::N | MOS6502::Z | MOS6502::C)) | alu_compare(r.A, val);
+  r.A += val; // Keep the operands changing
+}
+
+static void rol_table_driven(registers_t &r, const uint8_t val) {
+  const alu_result_t &res = rol_table[r.P & MOS6502::C][r.A ^ val];
+
+  r.A = res.result;
+  r.P = (r.P & ~(MOS6502::N | MOS6502::Z | MOS6502::C)) | res.flags;
+}
+
+typedef void (*kernel_t)(registers_t &r, const uint8_t val);
+
+// Run KERNEL on all the operands, return the Mops/s. The kernel is a template
+// parameter so it is inlined in the loop
+template <kernel_t KERNEL>
+static double bench(const std::vector<uint8_t> &operands, uint64_t &checksum) {
+  registers_t r = {0x00, PROCESSOR_STATUS_DEFAULT};
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (uint8_t val : operands) {
+    KERNEL(r, val);
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  checksum += r.A + r.P;
+  return operands.size() / elapsed.count() / 1e6;
+}
+
+int main(int argc, char **argv) {
+  size_t iterations = argc > 1 ? strtoull(argv[1], nullptr, 10)
+                               : DEFAULT_ITERATIONS;
+  std::vector<uint8_t> operands(iterations);
+  uint64_t checksum = 0;
+
+  srand(6502);
+  for (uint8_t &val : operands) {
+    val = rand() & 0xFF;
+  }
+
+  typedef double (*bench_t)(const std::vector<uint8_t> &, uint64_t &);
+  struct {
+    const char *name;
+    bench_t arithmetic;
+    bench_t table;
+  } kernels[] = {
+      {"ADC", bench<adc_arithmetic>, bench<adc_table_driven>},
+      {"CMP", bench<cmp_arithmetic>, bench<cmp_table_driven>},
+      {"ROL", bench<rol_arithmetic>, bench<rol_table_driven>},
+  };
+
+  printf("%-4s %12s %12s\n", "", "arithmetic", "table");
+
+  for (auto &k : kernels) {
+    double arithmetic = k.arithmetic(operands, checksum);
+    double table = k.table(operands, checksum);
+
+    printf("%-4s %8.1f M/s %8.1f M/s  (x%.2f)\n", k.name, arithmetic, table,
+           table / arithmetic);
+  }
+
+  printf("checksum %" PRIu64 "\n", checksum);
+
+  return 0;
+}
@@ -0,0 +1,121 @@
+// Benchmark of the timing test ROM recompiled to C++ by the recompiler (see
+// src/recompiler) versus the cycle-accurate and the instruction level
+// engines. The recompiled header is generated at build time.
+//
+// Not a test, run it by hand from the build folder: ./recompiled_bench [cycles]
+#include <chrono>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mos6502.hpp"
+#include "timingtest.hpp"
+
+#define DEFAULT_CYCLES 100000000
+#define TIMING_TEST_BIN "../../resources/6502timing/timingtest.bin"
+#define TIMING_TEST_MEM_LOC 0x1000
+
+static uint8_t rom[64 * 1024];
+static uint8_t mem[64 * 1024];
+
+static void mem_callback(void *usr_data, const uint16_t address,
+                         const access_mode_t read_write, uint8_t &data) {
+  uint8_t *mem = (uint8_t *)usr_data;
+
+  if (read_write == access_mode_t::WRITE) {
+    mem[address] = data;
+  } else {
+    data = mem[address];
+  }
+}
+
+enum class runner_t { CLOCK, RUN, RECOMPILED, RECOMPILED_RAM };
+
+// Run the ROM for 'cycles' cycles from a fresh memory, return the Mcycles/s
+static double bench(const runner_t runner, const uint64_t cycles,
+                    p_state_t &state) {
+  memcpy(mem, rom, sizeof(mem));
+
+  MOS6502 cpu(mem_callback, (void *)mem);
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+
+  CallbackBus callback_bus(mem_callback, (void *)mem);
+  RamBus ram_bus(mem);
+
+  auto start = std::chrono::steady_clock::now();
+
+  switch (runner) {
+  case runner_t::CLOCK:
+    while (cpu.cycles < cycles) {
+      cpu.clock();
+    }
+    break;
+  case runner_t::RUN:
+    cpu.run(cycles);
+    break;
+  case runner_t::RECOMPILED:
+    timingtest_run(cpu, callback_bus, cycles);
+    break;
+  case runner_t::RECOMPILED_RAM:
+    timingtest_run(cpu, ram_bus, cycles);
+    break;
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  state = cpu.get_status();
+  return cpu.cycles / elapsed.count() / 1e6;
+}
+
+int main(int argc, char **argv) {
+  uint64_t cycles = argc > 1 ? strtoull(argv[1], nullptr, 10) : DEFAULT_CYCLES;
+
+  FILE *file = fopen(TIMING_TEST_BIN, "rb");
+  if (file == nullptr) {
+    printf("Can not open the file %s\n", TIMING_TEST_BIN);
+    return 1;
+  }
+  size_t size = fread(rom + TIMING_TEST_MEM_LOC, sizeof(uint8_t),
+                      sizeof(rom) - TIMING_TEST_MEM_LOC, file);
+  fclose(file);
+
+  if (size == 0) {
+    printf("Failed read the binary from file\n");
+    return 1;
+  }
+
+  struct {
+    const char *name;
+    runner_t runner;
+    uint64_t cycles;
+  } runners[] = {
+      // The cycle-accurate engine is too slow for the whole run
+      {"clock()", runner_t::CLOCK, cycles / 10},
+      {"run()", runner_t::RUN, cycles},
+      {"recompiled", runner_t::RECOMPILED, cycles},
+      {"recompiled (RamBus)", runner_t::RECOMPILED_RAM, cycles},
+  };
+
+  p_state_t expected = {};
+  bench(runner_t::RUN, cycles, expected);
+
+  for (auto &r : runners) {
+    p_state_t state;
+    double speed = bench(r.runner, r.cycles, state);
+
+    // Same registers of the instruction level engine after the same cycles
+    bool match = r.runner == runner_t::CLOCK ||
+                 (state.A == expected.A && state.X == expected.X &&
+                  state.Y == expected.Y && state.P == expected.P &&
+                  state.PC == expected.PC &&
+                  state.tot_cycles == expected.tot_cycles);
+
+    printf("%-20s %10.1f Mcycles/s%s\n", r.name, speed,
+           match ? "" : "  MISMATCH");
+  }
+
+  return 0;
+}
@@ -6,9 +6,17 @@
 #include <stdlib.h>
 
 #include "common.hpp"
+#include "cow_memory.hpp"
+#include "engine.hpp"
 #include "mos6502.hpp"
+#include "record.hpp"
+#include "rewind.hpp"
 #include "util.hpp"
 
+// Generated by the recompiler at build time, see CMakeLists.txt
+#include "nestest.hpp"
+#include "timingtest.hpp"
+
 #define TEST_CARTRIDGE "../../resources/nestest.nes"
 #define LOG_FILE "../../resources/nestest.log"
 #define TEST_START_LOCATION 0xC000
@@ -18,6 +26,8 @@
 #define LOG_REG_OFFSET 48
 #define LOG_REG_LEN 25
 #define LOG_CYC_OFFSET 87
+// The log ends at cycle 26554 with the RTS out of the tests
+#define NES_TEST_TOT_CYCLES 26300
 
 #define NES_PRG_BANK_SIZE 16384
 #define NES_CHR_BANK_SIZE 8192
@@ -67,10 +77,46 @@ static void log_clb(const std::string &log);
 static void mem_callback(void *usr_data, const uint16_t address,
                          const access_mode_t read_write, uint8_t &data);
 
+static void flat_mem_callback(void *usr_data, const uint16_t address,
+                              const access_mode_t read_write, uint8_t &data);
+
 static bool load_NES_cartridge(const char *file,
                                NES_cartridge_t &cartridge_out);
+static bool load_binary(const char *file, uint8_t *mem, uint16_t address);
+
+// Fill the table at 0300 for ever, adding the counter at $10 to the index
+// 0200: LDX #$00
+// 0202: TXA ; ADC $10 ; STA $0300,X ; INX ; BNE $0202
+// 020B: INC $10 ; JMP $0200
+static const uint8_t table_program[] = {0xA2, 0x00, 0x8A, 0x65, 0x10, 0x9D,
+                                        0x00, 0x03, 0xE8, 0xD0, 0xF7, 0xE6,
+                                        0x10, 0x4C, 0x00, 0x02};
+
+// Clear the 64KB 'mem' and load 'program' at 0200, the reset address
+static void load_program(uint8_t *mem, const uint8_t *program = table_program,
+                         const size_t size = sizeof(table_program)) {
+  memset(mem, 0, 64 * 1024);
+  memcpy(mem + 0x0200, program, size);
+  mem[0xFFFC] = 0x00;
+  mem[0xFFFD] = 0x02;
+}
+
+// Execute one instruction with the cycle-accurate engine
+static void exec_clock(MOS6502 &cpu) {
+  while (!cpu.clock()) {
+  };
+}
+
+// Execute one instruction with the instruction level engine
+static void exec_step(MOS6502 &cpu) { cpu.step(); }
 
-TEST_CASE("NES Test") {
+// Execute one instruction with the instruction level engine from the cache
+static void exec_cached(MOS6502 &cpu) {
+  cpu.set_block_cache(true);
+  cpu.step();
+}
+
+static void nes_test(void (*exec)(MOS6502 &cpu)) {
   char state_log[150];
   p_state_t state;
   p_state_t previous_state;
@@ -106,8 +152,7 @@ TEST_CASE("NES Test") {
       iteration++;
 
       // Exec next instruction
-      while (!cpu.clock()) {
-      };
+      exec(cpu);
 
       p_state_t curr_state = cpu.get_status();
 
@@ -167,7 +212,13 @@ TEST_CASE("NES Test") {
   log_file.close();
 }
 
-TEST_CASE("Cycles Timing Test") {
+TEST_CASE("NES Test") { nes_test(exec_clock); }
+
+TEST_CASE("NES Test (step)") { nes_test(exec_step); }
+
+TEST_CASE("NES Test (block cache)") { nes_test(exec_cached); }
+
+static void timing_test(void (*exec)(MOS6502 &cpu)) {
   uint8_t mem[64 * 1024];
   // Initialize the cpu and set the log callback
   MOS6502 cpu(
@@ -250,8 +301,7 @@ TEST_CASE("Cycles Timing Test") {
     if (log_file) {
       iteration++;
 
-      while (!cpu.clock()) {
-      };
+      exec(cpu);
 
       curr_state = cpu.get_status();
 
@@ -300,7 +350,1444 @@ TEST_CASE("Cycles Timing Test") {
 
   // Compare the cycles number
   curr_state = cpu.get_status();
-  printf("%d\n", curr_state.tot_cycles);
+  printf("%" PRIu64 "\n", curr_state.tot_cycles);
+}
+
+TEST_CASE("Cycles Timing Test") { timing_test(exec_clock); }
+
+TEST_CASE("Cycles Timing Test (step)") { timing_test(exec_step); }
+
+static bool pc_reached(void *usr_data) {
+  MOS6502 *cpu = (MOS6502 *)usr_data;
+  return cpu->PC == TIMING_TEST_PC_END;
+}
+
+TEST_CASE("Run Test") {
+  static uint8_t mem[64 * 1024];
+  MOS6502 cpu(flat_mem_callback, (void *)mem);
+  cpu.set_log_callback(log_clb);
+
+  REQUIRE(load_binary(TIMING_TEST_BIN, mem, TIMING_TEST_MEM_LOC));
+
+  // Run the whole timing test in one call
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+  run_result_t res = cpu.run_until_pc(TIMING_TEST_PC_END);
+
+  REQUIRE(res.reason == stop_reason_t::PC);
+  REQUIRE_EQ(res.cycles, TIMING_TEST_TOT_CYCLES);
+  REQUIRE_EQ(cpu.cycles, TIMING_TEST_TOT_CYCLES);
+  p_state_t expected = cpu.get_status();
+
+  // Same run stopped by the predicate
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+  res = cpu.run_until(pc_reached, (void *)&cpu);
+
+  REQUIRE(res.reason == stop_reason_t::PREDICATE);
+  REQUIRE_EQ(res.cycles, TIMING_TEST_TOT_CYCLES);
+  REQUIRE_EQ(cpu.A, expected.A);
+  REQUIRE_EQ(cpu.X, expected.X);
+  REQUIRE_EQ(cpu.Y, expected.Y);
+  REQUIRE_EQ(cpu.P, expected.P);
+  REQUIRE_EQ(cpu.S, expected.S);
+
+  // Run on a cycle budget. Stop on the first instruction boundary after it
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+  res = cpu.run(500);
+
+  REQUIRE(res.reason == stop_reason_t::CYCLES);
+  REQUIRE_GE(res.cycles, 500);
+  REQUIRE_LT(res.cycles, 500 + 8);
+
+  uint64_t step_cycles = res.cycles;
+  res = cpu.run_until_cycle(TIMING_TEST_TOT_CYCLES);
+
+  REQUIRE(res.reason == stop_reason_t::CYCLES);
+  REQUIRE_EQ(step_cycles + res.cycles, TIMING_TEST_TOT_CYCLES);
+  REQUIRE_EQ(cpu.PC, TIMING_TEST_PC_END);
+}
+
+TEST_CASE("Bus Test") {
+  static uint8_t mem[64 * 1024];
+  RamBus bus(mem);
+  MOS6502 cpu(RamBus::mem_access, (void *)&bus);
+  cpu.set_log_callback(log_clb);
+
+  REQUIRE(load_binary(TIMING_TEST_BIN, mem, TIMING_TEST_MEM_LOC));
+
+  // The engine instantiated on the RamBus runs the whole timing test
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+  run_result_t res = cpu.run_until_pc(bus, TIMING_TEST_PC_END);
+
+  REQUIRE(res.reason == stop_reason_t::PC);
+  REQUIRE_EQ(res.cycles, TIMING_TEST_TOT_CYCLES);
+  p_state_t expected = cpu.get_status();
+
+  // Same run through the mem_access callback of the bus
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+  res = cpu.run_until_pc(TIMING_TEST_PC_END);
+
+  REQUIRE(res.reason == stop_reason_t::PC);
+  REQUIRE_EQ(res.cycles, TIMING_TEST_TOT_CYCLES);
+  REQUIRE_EQ(cpu.A, expected.A);
+  REQUIRE_EQ(cpu.X, expected.X);
+  REQUIRE_EQ(cpu.Y, expected.Y);
+  REQUIRE_EQ(cpu.P, expected.P);
+  REQUIRE_EQ(cpu.S, expected.S);
+
+  // Start with the cycle-accurate engine and finish on the bus one step at
+  // the time, the instruction in flight is completed first
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+  cpu.clock();
+
+  while (cpu.PC != TIMING_TEST_PC_END) {
+    cpu.step(bus);
+  }
+
+  REQUIRE_EQ(cpu.cycles, TIMING_TEST_TOT_CYCLES);
+  REQUIRE_EQ(cpu.A, expected.A);
+  REQUIRE_EQ(cpu.P, expected.P);
+}
+
+// Flat memory that counts the accesses through the callback
+struct counted_mem_t {
+  uint8_t mem[64 * 1024];
+  unsigned int reads;
+  unsigned int writes;
+};
+
+static void counted_mem_callback(void *usr_data, const uint16_t address,
+                                 const access_mode_t read_write,
+                                 uint8_t &data) {
+  counted_mem_t *counted = (counted_mem_t *)usr_data;
+
+  if (read_write == access_mode_t::WRITE) {
+    counted->writes++;
+  } else {
+    counted->reads++;
+  }
+
+  flat_mem_callback(counted->mem, address, read_write, data);
+}
+
+static void page_table_test(void (*exec)(MOS6502 &cpu)) {
+  static counted_mem_t counted;
+  MOS6502 cpu(counted_mem_callback, (void *)&counted);
+  cpu.set_log_callback(log_clb);
+
+  REQUIRE(load_binary(TIMING_TEST_BIN, counted.mem, TIMING_TEST_MEM_LOC));
+
+  // All the memory mapped, the callback is never called
+  cpu.map_memory(0x00, 256, counted.mem);
+  counted.reads = 0;
+  counted.writes = 0;
+
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+
+  while (cpu.PC != TIMING_TEST_PC_END) {
+    exec(cpu);
+  }
+
+  REQUIRE_EQ(cpu.cycles, TIMING_TEST_TOT_CYCLES);
+  REQUIRE_EQ(counted.reads, 0);
+  REQUIRE_EQ(counted.writes, 0);
+  p_state_t expected = cpu.get_status();
+
+  // The program pages read-only and the stack page given back to the
+  // callback. Same result, only those accesses call the callback
+  cpu.map_memory(TIMING_TEST_MEM_LOC >> 8, 2, counted.mem + TIMING_TEST_MEM_LOC,
+                 false);
+  cpu.unmap_memory(STACK_OFFSET >> 8, 1);
+
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+
+  while (cpu.PC != TIMING_TEST_PC_END) {
+    exec(cpu);
+  }
+
+  REQUIRE_EQ(cpu.cycles, TIMING_TEST_TOT_CYCLES);
+  REQUIRE_EQ(cpu.A, expected.A);
+  REQUIRE_EQ(cpu.X, expected.X);
+  REQUIRE_EQ(cpu.Y, expected.Y);
+  REQUIRE_EQ(cpu.P, expected.P);
+  REQUIRE_GT(counted.reads + counted.writes, 0);
+
+  // Not more than 256 pages
+  cpu.map_memory(0xFF, 2, counted.mem);
+  REQUIRE(cpu.page_table[0xFF].write == counted.mem + 0xFF00);
+}
+
+TEST_CASE("Page Table Test") { page_table_test(exec_clock); }
+
+TEST_CASE("Page Table Test (step)") { page_table_test(exec_step); }
+
+TEST_CASE("Block Cache Test") {
+  static uint8_t mem[64 * 1024];
+  MOS6502 cpu(flat_mem_callback, (void *)mem);
+  cpu.set_log_callback(log_clb);
+
+  // Self-modifying code, A doubles at every iteration
+  // 0200: LDY #$05 ; LDA #$01
+  // 0204: STA $0209 ; CLC ; LDX #$00 ; TXA   (patch LDX ahead, same block)
+  // 020B: ADC #$01 ; STA $020C ; DEY ; BNE $0204   (patch ADC behind)
+  // 0213: JMP $0213
+  const uint8_t program[] = {0xA0, 0x05, 0xA9, 0x01, 0x8D, 0x09, 0x02,
+                             0x18, 0xA2, 0x00, 0x8A, 0x69, 0x01, 0x8D,
+                             0x0C, 0x02, 0x88, 0xD0, 0xF1, 0x4C, 0x13,
+                             0x02};
+
+  // Without the cache, then twice with the cache: the second time the
+  // program is loaded again over the cached (and patched) one
+  uint64_t expected_cycles = 0;
+
+  for (int i = 0; i < 3; i++) {
+    memcpy(mem + 0x0200, program, sizeof(program));
+    cpu.invalidate_code(0x02, 1);
+    cpu.set_block_cache(i > 0);
+
+    cpu.set_PC(0x0200);
+    cpu.cycles = 0;
+    run_result_t res = cpu.run_until_pc(0x0213, 1000);
+
+    REQUIRE(res.reason == stop_reason_t::PC);
+    REQUIRE_EQ(cpu.A, 0x20);
+    REQUIRE_EQ(mem[0x020C], 0x20);
+
+    if (i == 0) {
+      expected_cycles = res.cycles;
+    }
+    REQUIRE_EQ(res.cycles, expected_cycles);
+  }
+
+  // The fetches of the operands are replayed on the bus state
+  p_state_t state = cpu.get_status();
+  REQUIRE_EQ(state.PC_executed, 0x0211);
+  REQUIRE_EQ(state.arg1, 0xF1);
+  REQUIRE_EQ(state.address, 0x0212);
+  REQUIRE_EQ(state.data_bus, 0xF1);
+}
+
+TEST_CASE("Superinstruction Test") {
+  static uint8_t mem[64 * 1024];
+  MOS6502 cpu(flat_mem_callback, (void *)mem);
+  cpu.set_log_callback(log_clb);
+
+  // A hot loop made of fused pairs, with page crossings and both outcomes of
+  // the branches
+  // 0200: LDX #$00 ; LDY #$20
+  // 0204: LDA $03F0,X ; STA $0380,X ; CLC ; ADC $10 ; STA $10
+  // 020F: CMP #$80 ; BEQ $0215
+  // 0213: INC $11 ; INX ; DEY ; BNE $0204
+  // 0219: LDA #$55 ; STA $0400
+  // 021E: JMP $021E
+  const uint8_t program[] = {0xA2, 0x00, 0xA0, 0x20, 0xBD, 0xF0, 0x03, 0x9D,
+                             0x80, 0x03, 0x18, 0x65, 0x10, 0x85, 0x10, 0xC9,
+                             0x80, 0xF0, 0x02, 0xE6, 0x11, 0xE8, 0x88, 0xD0,
+                             0xEB, 0xA9, 0x55, 0x8D, 0x00, 0x04, 0x4C, 0x1E,
+                             0x02};
+
+  // Every end cycle, without and with the cache, so the runs also stop
+  // between the two instructions of the pairs
+  static uint8_t expected[64 * 1024];
+
+  for (uint64_t budget = 1; budget < 1100; budget++) {
+    uint64_t expected_cycles = 0;
+    p_state_t expected_state = {};
+
+    for (int i = 0; i < 2; i++) {
+      memset(mem, 0, sizeof(mem));
+      memcpy(mem + 0x0200, program, sizeof(program));
+      for (int j = 0; j < 0x40; j++) {
+        mem[0x03F0 + j] = j * 0x0B;
+      }
+      cpu.set_block_cache(i > 0);
+
+      cpu.set_PC(0x0200);
+      cpu.cycles = 0;
+      run_result_t res = cpu.run(budget);
+      p_state_t state = cpu.get_status();
+
+      if (i == 0) {
+        memcpy(expected, mem, sizeof(mem));
+        expected_cycles = res.cycles;
+        expected_state = state;
+      }
+      REQUIRE_EQ(res.cycles, expected_cycles);
+      REQUIRE_EQ(state.PC, expected_state.PC);
+      REQUIRE_EQ(state.A, expected_state.A);
+      REQUIRE_EQ(state.X, expected_state.X);
+      REQUIRE_EQ(state.Y, expected_state.Y);
+      REQUIRE_EQ(state.P, expected_state.P);
+      REQUIRE_EQ(state.PC_executed, expected_state.PC_executed);
+      REQUIRE_EQ(state.address, expected_state.address);
+      REQUIRE_EQ(state.data_bus, expected_state.data_bus);
+      REQUIRE(memcmp(mem, expected, sizeof(mem)) == 0);
+    }
+  }
+
+  REQUIRE_EQ(cpu.PC, 0x021E);
+  REQUIRE_EQ(mem[0x0400], 0x55);
+}
+
+TEST_CASE("JIT Test") {
+  static uint8_t mem[64 * 1024];
+  MOS6502 cpu(flat_mem_callback, (void *)mem);
+  cpu.set_log_callback(log_clb);
+
+  // A hot loop, with writes to the code page and to an unmapped page
+  // 0200: LDX #$00 ; LDY #$C8
+  // 0204: TXA ; CLC ; ADC $10 ; STA $02F0,X ; ROL A ; EOR #$5A ; INC $11
+  // 0210: CMP #$80 ; INX ; STA $4000,X ; DEY ; BNE $0204
+  // 0219: JMP $0219
+  const uint8_t program[] = {0xA2, 0x00, 0xA0, 0xC8, 0x8A, 0x18, 0x65, 0x10,
+                             0x9D, 0xF0, 0x02, 0x2A, 0x49, 0x5A, 0xE6, 0x11,
+                             0xC9, 0x80, 0xE8, 0x9D, 0x00, 0x40, 0x88, 0xD0,
+                             0xEB, 0x4C, 0x19, 0x02};
+
+  // Without the JIT, then with the JIT if the host supports it
+  static uint8_t expected[64 * 1024];
+  uint64_t expected_cycles = 0;
+  uint8_t expected_A = 0;
+  uint8_t expected_P = 0;
+
+  for (int i = 0; i < 2; i++) {
+    memset(mem, 0, sizeof(mem));
+    memcpy(mem + 0x0200, program, sizeof(program));
+    mem[0x10] = 0x37;
+
+    cpu.map_memory(0x00, 0x40, mem);
+    if (i > 0 && !cpu.set_jit(true)) {
+      break;
+    }
+
+    cpu.set_PC(0x0200);
+    cpu.cycles = 0;
+    run_result_t res = cpu.run(20000);
+
+    REQUIRE(res.cycles >= 20000);
+    REQUIRE_EQ(cpu.PC, 0x0219);
+    REQUIRE_EQ(cpu.X, 0xC8);
+    REQUIRE_EQ(mem[0x11], 0xC8);
+
+    if (i == 0) {
+      memcpy(expected, mem, sizeof(mem));
+      expected_cycles = res.cycles;
+      expected_A = cpu.A;
+      expected_P = cpu.P;
+    }
+    REQUIRE_EQ(res.cycles, expected_cycles);
+    REQUIRE_EQ(cpu.A, expected_A);
+    REQUIRE_EQ(cpu.P, expected_P);
+    REQUIRE(memcmp(mem, expected, sizeof(mem)) == 0);
+  }
+}
+
+// Run the cpus side by side in runs of random length up to the cycle 'end',
+// comparing the registers and the 'size' bytes of their memories
+static void run_side_by_side(MOS6502 &reference, MOS6502 &cpu,
+                             const uint8_t *reference_mem, const uint8_t *mem,
+                             const size_t size, const uint64_t end) {
+  while (reference.cycles < end) {
+    uint64_t budget = 1 + rand() % 200;
+    REQUIRE_EQ(reference.run(budget).cycles, cpu.run(budget).cycles);
+
+    REQUIRE_FALSE(reference.halted);
+    REQUIRE_EQ(reference.cycles, cpu.cycles);
+    REQUIRE_EQ(reference.PC, cpu.PC);
+    REQUIRE_EQ(reference.A, cpu.A);
+    REQUIRE_EQ(reference.X, cpu.X);
+    REQUIRE_EQ(reference.Y, cpu.Y);
+    REQUIRE_EQ(reference.S, cpu.S);
+    REQUIRE_EQ(reference.P, cpu.P);
+    REQUIRE(memcmp(reference_mem, mem, size) == 0);
+  }
+}
+
+// Map the RAM (with its mirrors) and the PRG ROM of nestest, so the native
+// code accesses them without the callback
+static void map_cartridge(MOS6502 &cpu, NES_cartridge_t &cartridge) {
+  for (unsigned int page = 0x00; page < 0x20; page += NES_RAM / 0x0100) {
+    cpu.map_memory(page, NES_RAM / 0x0100, cartridge.RAM);
+  }
+  for (unsigned int page = 0x80; page < 0x0100; page += 0x40) {
+    cpu.map_memory(page, 0x40, cartridge.prg_memory.data(), false);
+  }
+}
+
+TEST_CASE("Block Cache Test (nestest)") {
+  static NES_cartridge_t cartridges[2];
+  MOS6502 interpreted(mem_callback, (void *)&cartridges[0]);
+  MOS6502 cached(mem_callback, (void *)&cartridges[1]);
+
+  for (int i = 0; i < 2; i++) {
+    MOS6502 &cpu = i ? cached : interpreted;
+    REQUIRE(load_NES_cartridge(TEST_CARTRIDGE, cartridges[i]));
+    cpu.set_log_callback(log_clb);
+    map_cartridge(cpu, cartridges[i]);
+  }
+  cached.set_block_cache(true);
+
+  // The runs execute whole blocks from the cache and, after a few passes, the
+  // fused pairs
+  srand(6502);
+  for (int pass = 0; pass < 4; pass++) {
+    for (int i = 0; i < 2; i++) {
+      MOS6502 &cpu = i ? cached : interpreted;
+      memset(cartridges[i].RAM, 0, NES_RAM);
+      cpu.reset();
+      cpu.set_PC(TEST_START_LOCATION);
+    }
+
+    run_side_by_side(interpreted, cached, cartridges[0].RAM,
+                     cartridges[1].RAM, NES_RAM,
+                     interpreted.cycles + NES_TEST_TOT_CYCLES);
+
+    REQUIRE_EQ(cartridges[1].RAM[0x02], 0x00);
+    REQUIRE_EQ(cartridges[1].RAM[0x03], 0x00);
+  }
+}
+
+TEST_CASE("JIT Test (timing test)") {
+  static uint8_t mems[2][64 * 1024];
+  MOS6502 interpreted(flat_mem_callback, (void *)mems[0]);
+  MOS6502 jitted(flat_mem_callback, (void *)mems[1]);
+
+  for (int i = 0; i < 2; i++) {
+    MOS6502 &cpu = i ? jitted : interpreted;
+    memset(mems[i], 0, sizeof(mems[i]));
+    REQUIRE(load_binary(TIMING_TEST_BIN, mems[i], TIMING_TEST_MEM_LOC));
+    cpu.set_log_callback(log_clb);
+    cpu.map_memory(0x00, 0x0100, mems[i]);
+    cpu.set_PC(TIMING_TEST_MEM_LOC);
+    cpu.cycles = 0;
+  }
+  jitted.set_block_cache(true);
+  jitted.set_jit(true);
+
+  // The test jumps back to its start at the end: the passes make its blocks
+  // hot, then they run native
+  srand(6502);
+  run_side_by_side(interpreted, jitted, mems[0], mems[1], sizeof(mems[0]),
+                   2 * JIT_HOT_THRESHOLD * TIMING_TEST_TOT_CYCLES);
+}
+
+TEST_CASE("JIT Test (nestest)") {
+  static NES_cartridge_t cartridges[2];
+  MOS6502 interpreted(mem_callback, (void *)&cartridges[0]);
+  MOS6502 jitted(mem_callback, (void *)&cartridges[1]);
+
+  for (int i = 0; i < 2; i++) {
+    MOS6502 &cpu = i ? jitted : interpreted;
+    REQUIRE(load_NES_cartridge(TEST_CARTRIDGE, cartridges[i]));
+    cpu.set_log_callback(log_clb);
+    map_cartridge(cpu, cartridges[i]);
+  }
+  jitted.set_block_cache(true);
+  jitted.set_jit(true);
+
+  // nestest restarted from its entry on a clean RAM, the passes make its
+  // blocks hot (the reset keeps the cached code)
+  srand(6502);
+  for (int pass = 0; pass < 2 * JIT_HOT_THRESHOLD; pass++) {
+    for (int i = 0; i < 2; i++) {
+      MOS6502 &cpu = i ? jitted : interpreted;
+      memset(cartridges[i].RAM, 0, NES_RAM);
+      cpu.reset();
+      cpu.set_PC(TEST_START_LOCATION);
+    }
+
+    run_side_by_side(interpreted, jitted, cartridges[0].RAM,
+                     cartridges[1].RAM, NES_RAM,
+                     interpreted.cycles + NES_TEST_TOT_CYCLES);
+
+    // The result codes of the official and of the unofficial opcodes tests
+    REQUIRE_EQ(cartridges[1].RAM[0x02], 0x00);
+    REQUIRE_EQ(cartridges[1].RAM[0x03], 0x00);
+  }
+}
+
+TEST_CASE("Recompiler Test") {
+  static uint8_t mem[64 * 1024];
+  MOS6502 cpu(flat_mem_callback, (void *)mem);
+  cpu.set_log_callback(log_clb);
+  RamBus bus(mem);
+
+  // The recompiled timing test stops on the same instruction as the engines
+  REQUIRE(load_binary(TIMING_TEST_BIN, mem, TIMING_TEST_MEM_LOC));
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.cycles = 0;
+  run_result_t res = timingtest_run(cpu, bus, TIMING_TEST_TOT_CYCLES);
+
+  REQUIRE_EQ(res.cycles, TIMING_TEST_TOT_CYCLES);
+  REQUIRE_EQ(cpu.PC, TIMING_TEST_PC_END);
+
+  // nestest, with the unofficial opcodes, JMP ($xxxx), RTI and the returns
+  // through the dispatch, side by side with the instruction level engine in
+  // runs of random length
+  static NES_cartridge_t cartridges[2];
+  REQUIRE(load_NES_cartridge(TEST_CARTRIDGE, cartridges[0]));
+  REQUIRE(load_NES_cartridge(TEST_CARTRIDGE, cartridges[1]));
+
+  MOS6502 interpreted(mem_callback, (void *)&cartridges[0]);
+  MOS6502 recompiled(mem_callback, (void *)&cartridges[1]);
+  CallbackBus cartridge_bus(mem_callback, (void *)&cartridges[1]);
+
+  for (MOS6502 *c : {&interpreted, &recompiled}) {
+    c->set_log_callback(log_clb);
+    c->reset();
+    c->set_PC(TEST_START_LOCATION);
+  }
+
+  srand(6502);
+  while (interpreted.cycles < NES_TEST_TOT_CYCLES) {
+    uint64_t budget = 1 + rand() % 200;
+    REQUIRE_EQ(interpreted.run(budget).cycles,
+               nestest_run(recompiled, cartridge_bus, budget).cycles);
+
+    REQUIRE_EQ(interpreted.cycles, recompiled.cycles);
+    REQUIRE_EQ(interpreted.PC, recompiled.PC);
+    REQUIRE_EQ(interpreted.A, recompiled.A);
+    REQUIRE_EQ(interpreted.X, recompiled.X);
+    REQUIRE_EQ(interpreted.Y, recompiled.Y);
+    REQUIRE_EQ(interpreted.S, recompiled.S);
+    REQUIRE_EQ(interpreted.P, recompiled.P);
+    REQUIRE(memcmp(cartridges[0].RAM, cartridges[1].RAM, NES_RAM) == 0);
+  }
+
+  // The result codes of the official and of the unofficial opcodes tests
+  REQUIRE_EQ(cartridges[1].RAM[0x02], 0x00);
+  REQUIRE_EQ(cartridges[1].RAM[0x03], 0x00);
+}
+
+// Flat memory with a status register at 0x2002 that counts its reads
+struct idle_device_t {
+  uint8_t mem[64 * 1024];
+  uint8_t status;
+  unsigned int reads;
+};
+
+static void idle_device_callback(void *usr_data, const uint16_t address,
+                                 const access_mode_t read_write,
+                                 uint8_t &data) {
+  idle_device_t *device = (idle_device_t *)usr_data;
+
+  if (address == 0x2002 && read_write == access_mode_t::READ) {
+    device->reads++;
+    data = device->status;
+  } else {
+    flat_mem_callback(device->mem, address, read_write, data);
+  }
+}
+
+static bool never_stop(void *) { return false; }
+
+TEST_CASE("Idle Loop Test") {
+  // Poll the device, then the RAM, then stop
+  // 0200: LDA #$00
+  // 0202: BIT $2002 ; BPL $0202
+  // 0207: LDA $10 ; BEQ $0207
+  // 020B: JMP $020B
+  const uint8_t program[] = {0xA9, 0x00, 0x2C, 0x02, 0x20, 0x10, 0xFB,
+                             0xA5, 0x10, 0xF0, 0xFC, 0x4C, 0x0B, 0x02};
+
+  // The same program without fast-forward (run_until() never skips), as
+  // reference
+  static idle_device_t devices[2];
+  std::vector<std::unique_ptr<MOS6502>> cpus;
+
+  for (idle_device_t &device : devices) {
+    memset(device.mem, 0, sizeof(device.mem));
+    memcpy(device.mem + 0x0200, program, sizeof(program));
+    device.status = 0x00;
+    device.reads = 0;
+
+    cpus.push_back(std::make_unique<MOS6502>(idle_device_callback, &device));
+    cpus.back()->set_log_callback(log_clb);
+    cpus.back()->map_memory(0x00, 0x20, device.mem);
+    cpus.back()->set_PC(0x0200);
+  }
+
+  MOS6502 &cpu = *cpus[0];
+  MOS6502 &reference = *cpus[1];
+
+  auto check = [&](const uint64_t budget) {
+    run_result_t res = cpu.run(budget);
+    run_result_t expected = reference.run_until(never_stop, nullptr, budget);
+
+    REQUIRE_EQ(res.cycles, expected.cycles);
+    REQUIRE_EQ(cpu.cycles, reference.cycles);
+    REQUIRE_EQ(cpu.PC, reference.PC);
+
+    p_state_t state = cpu.get_status();
+    p_state_t expected_state = reference.get_status();
+    REQUIRE_EQ(state.A, expected_state.A);
+    REQUIRE_EQ(state.P, expected_state.P);
+    REQUIRE_EQ(state.PC_executed, expected_state.PC_executed);
+    REQUIRE_EQ(state.address, expected_state.address);
+    REQUIRE_EQ(state.data_bus, expected_state.data_bus);
+  };
+
+  // The status does not change until the cycle 5000
+  cpu.set_stable_reads(0x20, 1, 5000);
+  check(5000);
+  REQUIRE(devices[0].reads < 10);
+  REQUIRE(devices[1].reads > 500);
+
+  // The status changes, the RAM loop is idle until the end of the run
+  cpu.set_stable_reads(0x20, 1, 0);
+  devices[0].status = devices[1].status = 0x80;
+  check(20001);
+  REQUIRE(cpu.PC >= 0x0207);
+  REQUIRE_EQ(cpu.A, 0x00);
+
+  // The host writes the RAM between the runs
+  devices[0].mem[0x10] = devices[1].mem[0x10] = 0x01;
+  check(1000003);
+  REQUIRE_EQ(cpu.PC, 0x020B);
+  REQUIRE_EQ(cpu.A, 0x01);
+}
+
+TEST_CASE("JAM Test") {
+  static uint8_t mem[64 * 1024];
+  MOS6502 cpu(flat_mem_callback, (void *)mem);
+  cpu.set_log_callback(log_clb);
+
+  // 0200: LDA #$01 ; INX ; JAM ; INX
+  const uint8_t program[] = {0xA9, 0x01, 0xE8, 0x02, 0xE8};
+  memset(mem, 0, sizeof(mem));
+  memcpy(mem + 0x0200, program, sizeof(program));
+  mem[0xFFFC] = 0x00;
+  mem[0xFFFD] = 0x02;
+
+  // Cycle-accurate, instruction level and from the block cache
+  for (int i = 0; i < 3; i++) {
+    cpu.reset();
+    REQUIRE_FALSE(cpu.halted);
+    cpu.set_block_cache(i == 2);
+
+    if (i == 0) {
+      exec_clock(cpu);
+      exec_clock(cpu);
+      exec_clock(cpu);
+    } else {
+      run_result_t res = cpu.run(1000);
+      REQUIRE(res.reason == stop_reason_t::HALT);
+      REQUIRE_EQ(res.cycles, 5);
+      REQUIRE_EQ(res.PC, 0x0203);
+    }
+
+    REQUIRE(cpu.halted);
+    REQUIRE_EQ(cpu.PC, 0x0203);
+    REQUIRE_EQ(cpu.X, 0x01);
+    REQUIRE_EQ(cpu.cycles, 7 + 5);
+
+    // Nothing runs until the reset, the interrupts are ignored
+    cpu.irq();
+    cpu.nmi();
+    REQUIRE(cpu.clock());
+    REQUIRE_EQ(cpu.step(), 0);
+    run_result_t res = cpu.run_until_pc(0x0204, 1000);
+    REQUIRE(res.reason == stop_reason_t::HALT);
+    REQUIRE_EQ(res.cycles, 0);
+    REQUIRE_EQ(res.PC, 0x0203);
+    REQUIRE_EQ(cpu.PC, 0x0203);
+    REQUIRE_EQ(cpu.S, STACK_POINTER_DEFAULT);
+    REQUIRE_EQ(cpu.cycles, 7 + 5);
+  }
+}
+
+// Flat memory with a timer that activates the IRQ line every
+// EVENT_TIMER_PERIOD cycles, a write to 0xD000 acknowledges it
+#define EVENT_TIMER_PERIOD 100
+struct event_device_t {
+  uint8_t mem[64 * 1024];
+  MOS6502 *cpu;
+  unsigned int timers;   // Timer events dispatched
+  uint64_t late_cycles;  // Sum of the dispatch delays of the timer
+};
+
+static void event_device_callback(void *usr_data, const uint16_t address,
+                                  const access_mode_t read_write,
+                                  uint8_t &data) {
+  event_device_t *device = (event_device_t *)usr_data;
+
+  if (address == 0xD000 && read_write == access_mode_t::WRITE) {
+    device->cpu->set_irq_line(false);
+  } else {
+    flat_mem_callback(device->mem, address, read_write, data);
+  }
+}
+
+static void event_timer(void *usr_data, const uint64_t cycle) {
+  event_device_t *device = (event_device_t *)usr_data;
+
+  REQUIRE(device->cpu->cycles >= cycle);
+  device->timers++;
+  device->late_cycles += device->cpu->cycles - cycle;
+  device->cpu->set_irq_line(true);
+  device->cpu->schedule(cycle + EVENT_TIMER_PERIOD, event_timer, device);
+}
+
+static void event_nmi_on(void *usr_data, const uint64_t) {
+  ((MOS6502 *)usr_data)->set_nmi_line(true);
+}
+
+static void event_nmi_off(void *usr_data, const uint64_t) {
+  ((MOS6502 *)usr_data)->set_nmi_line(false);
+}
+
+TEST_CASE("Event Test") {
+  // 0200: SEI ; INX ; CPX #$20 ; BNE $0201 ; CLI
+  // 0207: INX ; JMP $0207
+  // IRQ: 0300: INY ; STA $D000 ; RTI
+  // NMI: 0400: INC $10 ; RTI
+  const uint8_t program[] = {0x78, 0xE8, 0xE0, 0x20, 0xD0, 0xFB,
+                             0x58, 0xE8, 0x4C, 0x07, 0x02};
+  const uint8_t irq_handler[] = {0xC8, 0x8D, 0x00, 0xD0, 0x40};
+  const uint8_t nmi_handler[] = {0xE6, 0x10, 0x40};
+
+  // Cycle-accurate, instruction level and from the block cache
+  static event_device_t devices[3];
+  std::vector<std::unique_ptr<MOS6502>> cpus;
+
+  for (int i = 0; i < 3; i++) {
+    event_device_t &device = devices[i];
+    memset(device.mem, 0, sizeof(device.mem));
+    memcpy(device.mem + 0x0200, program, sizeof(program));
+    memcpy(device.mem + 0x0300, irq_handler, sizeof(irq_handler));
+    memcpy(device.mem + 0x0400, nmi_handler, sizeof(nmi_handler));
+    device.mem[0xFFFA] = 0x00;
+    device.mem[0xFFFB] = 0x04;
+    device.mem[0xFFFC] = 0x00;
+    device.mem[0xFFFD] = 0x02;
+    device.mem[0xFFFE] = 0x00;
+    device.mem[0xFFFF] = 0x03;
+    device.timers = 0;
+    device.late_cycles = 0;
+
+    cpus.push_back(std::make_unique<MOS6502>(event_device_callback, &device));
+    MOS6502 &cpu = *cpus.back();
+    device.cpu = &cpu;
+    cpu.set_log_callback(log_clb);
+    cpu.set_block_cache(i == 2);
+    cpu.reset();
+
+    // The first timer fires while the IRQ is masked, the CLI takes it. The
+    // NMI line stays active for a while, it is taken once per activation
+    cpu.schedule(20, event_timer, &device);
+    cpu.schedule(555, event_nmi_on, &cpu);
+    cpu.schedule(900, event_nmi_off, &cpu);
+    cpu.schedule(950, event_nmi_on, &cpu);
+    REQUIRE(cpu.cancel_event(cpu.schedule(700, event_nmi_off, &cpu)));
+    REQUIRE_EQ(cpu.next_event(), 20);
+  }
+
+  MOS6502 &reference = *cpus[0];
+  srand(6502);
+  while (reference.cycles < 5000) {
+    uint64_t target =
+        std::min<uint64_t>(reference.cycles + 1 + rand() % 150, 5000);
+
+    while (reference.cycles < target) {
+      exec_clock(reference);
+    }
+
+    for (int i = 1; i < 3; i++) {
+      MOS6502 &cpu = *cpus[i];
+      cpu.run(target - cpu.cycles);
+
+      REQUIRE_EQ(cpu.cycles, reference.cycles);
+      REQUIRE_EQ(cpu.PC, reference.PC);
+      REQUIRE_EQ(cpu.A, reference.A);
+      REQUIRE_EQ(cpu.X, reference.X);
+      REQUIRE_EQ(cpu.Y, reference.Y);
+      REQUIRE_EQ(cpu.S, reference.S);
+      REQUIRE_EQ(cpu.P, reference.P);
+      REQUIRE_EQ(devices[i].mem[0x10], devices[0].mem[0x10]);
+    }
+  }
+
+  // clock() dispatches the events on time, the runs at the next boundary
+  REQUIRE_EQ(devices[0].late_cycles, 0);
+  REQUIRE(devices[1].late_cycles < devices[1].timers * 7);
+  // The line stays active while masked, the timers at the cycles 20, 120 and
+  // 220 take one IRQ at the CLI
+  REQUIRE_EQ(reference.Y, devices[0].timers - 2);
+  REQUIRE_EQ(devices[0].mem[0x10], 2);
+}
+
+TEST_CASE("Interrupt Sequence Test") {
+  static uint8_t mem[64 * 1024];
+  MOS6502 cpu(flat_mem_callback, (void *)mem);
+  cpu.set_log_callback(log_clb);
+
+  // 0200: CLI ; NOP ; JMP $0201
+  // IRQ: 0300: RTI
+  // NMI: 0400: RTI
+  const uint8_t program[] = {0x58, 0xEA, 0x4C, 0x01, 0x02};
+  memset(mem, 0, sizeof(mem));
+  memcpy(mem + 0x0200, program, sizeof(program));
+  mem[0x0300] = 0x40;
+  mem[0x0400] = 0x40;
+  mem[0xFFFA] = 0x00;
+  mem[0xFFFB] = 0x04;
+  mem[0xFFFC] = 0x00;
+  mem[0xFFFD] = 0x02;
+  mem[0xFFFE] = 0x00;
+  mem[0xFFFF] = 0x03;
+
+  // Cycle-accurate, instruction level and from the block cache
+  void (*execs[])(MOS6502 &cpu) = {exec_clock, exec_step, exec_cached};
+  for (auto exec : execs) {
+    cpu.set_block_cache(false);
+    cpu.reset();
+    exec(cpu); // CLI
+    REQUIRE_EQ(cpu.cycles, 7 + 2);
+
+    // The IRQ sequence is an instruction of 7 cycles that pushes the PC of
+    // the next instruction and P without B
+    cpu.irq();
+    exec(cpu);
+    REQUIRE_EQ(cpu.cycles, 9 + 7);
+    REQUIRE_EQ(cpu.PC, 0x0300);
+    REQUIRE_EQ(cpu.S, STACK_POINTER_DEFAULT - 3);
+    REQUIRE_EQ(mem[0x01FD], 0x02);
+    REQUIRE_EQ(mem[0x01FC], 0x01);
+    REQUIRE_EQ(mem[0x01FB], 0x20);
+    REQUIRE(cpu.read_flag(MOS6502::I));
+    REQUIRE_EQ(cpu.get_status().opcode, 0x00);
+
+    // The IRQ requested while masked is dropped
+    cpu.irq();
+    exec(cpu); // RTI
+    REQUIRE_EQ(cpu.cycles, 16 + 6);
+    REQUIRE_EQ(cpu.PC, 0x0201);
+    REQUIRE_FALSE(cpu.read_flag(MOS6502::I));
+    exec(cpu); // NOP
+    REQUIRE_EQ(cpu.cycles, 22 + 2);
+    REQUIRE_EQ(cpu.PC, 0x0202);
+
+    // The NMI is taken at the end of the instruction in flight
+    if (exec == exec_clock) {
+      REQUIRE_FALSE(cpu.clock());
+      cpu.nmi();
+      exec(cpu); // JMP
+    } else {
+      cpu.nmi();
+      exec(cpu); // NMI
+      REQUIRE_EQ(cpu.cycles, 24 + 7);
+      REQUIRE_EQ(cpu.PC, 0x0400);
+      exec(cpu); // RTI
+      exec(cpu); // JMP
+    }
+
+    if (exec == exec_clock) {
+      REQUIRE_EQ(cpu.cycles, 24 + 3);
+      exec(cpu); // NMI
+      REQUIRE_EQ(cpu.cycles, 27 + 7);
+      REQUIRE_EQ(cpu.PC, 0x0400);
+      REQUIRE_EQ(mem[0x01FD], 0x02);
+      REQUIRE_EQ(mem[0x01FC], 0x01);
+      exec(cpu); // RTI
+      REQUIRE_EQ(cpu.cycles, 34 + 6);
+      REQUIRE_EQ(cpu.PC, 0x0201);
+    } else {
+      REQUIRE_EQ(cpu.cycles, 31 + 6 + 3);
+      REQUIRE_EQ(cpu.PC, 0x0201);
+    }
+
+    // A run counts the sequences in its budget
+    cpu.irq();
+    run_result_t res = cpu.run(1);
+    REQUIRE_EQ(res.cycles, 7);
+    REQUIRE_EQ(cpu.PC, 0x0300);
+  }
+}
+
+TEST_CASE("Save State Test") {
+  // The zero page and the stack are mapped, the rest goes to mem_access
+  static uint8_t mems[2][64 * 1024];
+  std::vector<std::unique_ptr<MOS6502>> cpus;
+  for (uint8_t *mem : mems) {
+    memset(mem, 0, 64 * 1024);
+    cpus.push_back(std::make_unique<MOS6502>(flat_mem_callback, mem));
+    cpus.back()->set_log_callback(log_clb);
+    cpus.back()->map_memory(0x00, 2, mem);
+  }
+
+  MOS6502 &cpu = *cpus[0];
+  MOS6502 &restored = *cpus[1];
+  load_program(mems[0]);
+  mems[0][0x0400] = 0x40; // IRQ: 0400: RTI
+  mems[0][0xFFFE] = 0x00;
+  mems[0][0xFFFF] = 0x04;
+
+  cpu.reset();
+  cpu.P &= ~MOS6502::I;
+  for (int i = 0; i < 3000; i++) {
+    cpu.clock();
+  }
+
+  // Saved in the middle of the IRQ sequence
+  cpu.irq();
+  exec_clock(cpu);
+  cpu.clock();
+  cpu.clock();
+  REQUIRE_EQ(cpu.get_status().opcode, 0x00);
+
+  std::vector<uint8_t> state;
+  cpu.save_state(state);
+  REQUIRE(state.size() < 64);
+  cpu.save_state(state, true);
+
+  // The invalid states are refused and change nothing
+  std::vector<uint8_t> bad = state;
+  bad[4]++; // Version
+  REQUIRE_FALSE(restored.load_state(bad.data(), bad.size()));
+  REQUIRE_FALSE(restored.load_state(state.data(), state.size() - 1));
+  REQUIRE_EQ(restored.cycles, 0);
+  REQUIRE_EQ(mems[1][0x0200], 0x00);
+
+  REQUIRE(restored.load_state(state.data(), state.size()));
+  REQUIRE(memcmp(mems[0], mems[1], sizeof(mems[0])) == 0);
+
+  // Both go on the same, the restored one also from the block cache
+  for (int i = 0; i < 5000; i++) {
+    cpu.clock();
+    restored.clock();
+  }
+  restored.set_block_cache(true);
+  cpu.run(10000);
+  restored.run(10000);
+
+  REQUIRE_EQ(restored.cycles, cpu.cycles);
+  REQUIRE_EQ(restored.PC, cpu.PC);
+  REQUIRE_EQ(restored.A, cpu.A);
+  REQUIRE_EQ(restored.X, cpu.X);
+  REQUIRE_EQ(restored.Y, cpu.Y);
+  REQUIRE_EQ(restored.S, cpu.S);
+  REQUIRE_EQ(restored.P, cpu.P);
+  REQUIRE(memcmp(mems[0], mems[1], sizeof(mems[0])) == 0);
+}
+
+TEST_CASE("Fork Test") {
+  const uint8_t reset_vector[] = {0x00, 0x02};
+
+  // Reference on a flat memory, never forked
+  static uint8_t flat[64 * 1024];
+  load_program(flat);
+  MOS6502 reference(flat_mem_callback, flat);
+  reference.reset();
+
+  CowMemory memory;
+  memory.load(0x0200, table_program, sizeof(table_program));
+  memory.load(0xFFFC, reset_vector, sizeof(reset_vector));
+  REQUIRE_EQ(memory.copied_pages(), 2);
+
+  MOS6502 cpu(nullptr, nullptr);
+  cpu.set_log_callback(log_clb);
+  memory.attach(cpu);
+  cpu.reset();
+  REQUIRE(cpu.set_jit(true) == reference.set_jit(true));
+  cpu.set_block_cache(true);
+  reference.set_block_cache(true);
+
+  cpu.run(3000);
+  reference.run(3000);
+
+  // The fork shares all the pages, then every fork copies at most the pages
+  // it writes: the zero page and the page of the table
+  const unsigned int copied = memory.copied_pages();
+  std::unique_ptr<CowMemory> forked = memory.fork();
+  std::unique_ptr<MOS6502> child = cpu.clone();
+  forked->attach(*child);
+  REQUIRE_EQ(child->cycles, cpu.cycles);
+  REQUIRE_EQ(child->PC, cpu.PC);
+
+  // The child goes on differently, also through the Bus API
+  child->X = 0x80;
+  forked->write(0x0010, 0x55);
+  for (int i = 0; i < 100; i++) {
+    exec_clock(*child);
+  }
+  child->run(*forked, 5000);
+  child->run(5000);
+
+  // Stepped on the microcode engine, then run with the JIT
+  for (int i = 0; i < 100; i++) {
+    exec_clock(cpu);
+    exec_clock(reference);
+  }
+  cpu.run(20000);
+  reference.run(20000);
+
+  REQUIRE(memory.copied_pages() <= copied + 2);
+  REQUIRE_EQ(forked->copied_pages(), 2);
+  REQUIRE_EQ(cpu.cycles, reference.cycles);
+  REQUIRE_EQ(cpu.PC, reference.PC);
+  REQUIRE_EQ(cpu.A, reference.A);
+  REQUIRE_EQ(cpu.X, reference.X);
+  REQUIRE_EQ(cpu.P, reference.P);
+
+  bool diverged = false;
+  for (unsigned int address = 0; address < 0x10000; address++) {
+    REQUIRE_EQ(memory.read(address), flat[address]);
+    diverged |= forked->read(address) != flat[address];
+  }
+  REQUIRE(diverged);
+
+  // A state loaded in a fork copies the shared pages before writing them:
+  // the parent and the zero page shared by the new memories are unchanged
+  std::vector<uint8_t> state;
+  cpu.save_state(state, true);
+  uint8_t *image = state.data() + state.size() - sizeof(flat);
+  image[0x0034] = 0xAB;
+  image[0xFF34] = 0xAB;
+
+  std::unique_ptr<CowMemory> loaded = memory.fork();
+  std::unique_ptr<MOS6502> restored = cpu.clone();
+  loaded->attach(*restored);
+  REQUIRE(restored->load_state(state.data(), state.size()));
+  REQUIRE_EQ(loaded->read(0x0034), 0xAB);
+  REQUIRE_EQ(loaded->read(0xFF34), 0xAB);
+  REQUIRE_EQ(memory.read(0x0034), flat[0x0034]);
+  REQUIRE_EQ(memory.read(0xFF34), 0x00);
+  REQUIRE_EQ(CowMemory().read(0x5634), 0x00);
+}
+
+TEST_CASE("Rewind Test") {
+  static counted_mem_t counted;
+  uint8_t *mem = counted.mem;
+  load_program(mem);
+
+  // The table read-only mapped (its writes go to mem_access) and a device
+  // page at D000, the rest of the memory mapped
+  MOS6502 cpu(counted_mem_callback, (void *)&counted);
+  cpu.set_log_callback(log_clb);
+  cpu.map_memory(0x00, 256, mem);
+  cpu.map_memory(0x03, 1, mem + 0x0300, false);
+  cpu.unmap_memory(0xD0, 1);
+  cpu.reset();
+
+  Rewind rewind(cpu, 1000, 16);
+  std::vector<uint8_t> at_5555, at_12345, at_20000, now;
+
+  while (cpu.cycles < 20000) {
+    cpu.clock();
+    rewind.record();
+
+    if (cpu.cycles == 5555) {
+      cpu.save_state(at_5555, true);
+    } else if (cpu.cycles == 12345) {
+      cpu.save_state(at_12345, true);
+    }
+  }
+  cpu.save_state(at_20000, true);
+
+  // The ring keeps the last 16 snapshots, the deltas are few pages
+  REQUIRE_EQ(rewind.size(), 16);
+  REQUIRE(rewind.oldest_cycle() < 5555);
+  REQUIRE(rewind.memory_usage() < 64 * 1024 + 16 * 1024);
+
+  REQUIRE_FALSE(rewind.rewind(20001));
+  REQUIRE_FALSE(rewind.rewind(rewind.oldest_cycle() - 1));
+
+  // Back in the middle of the instructions, then forward again
+  REQUIRE(rewind.rewind(12345));
+  cpu.save_state(now, true);
+  REQUIRE(now == at_12345);
+
+  while (cpu.cycles < 20000) {
+    cpu.clock();
+    rewind.record();
+  }
+  cpu.save_state(now, true);
+  REQUIRE(now == at_20000);
+
+  REQUIRE(rewind.rewind(5555));
+  cpu.save_state(now, true);
+  REQUIRE(now == at_5555);
+  REQUIRE(rewind.size() < 16);
+
+  // Back to a snapshot: only the changed pages are written, the table through
+  // mem_access, the device is not written
+  mem[0xD000] = 0x55;
+  counted.writes = 0;
+  REQUIRE(rewind.rewind(rewind.oldest_cycle()));
+  REQUIRE_EQ(counted.writes, 0x0100);
+  REQUIRE_EQ(mem[0xD000], 0x55);
+}
+
+TEST_CASE("Dirty Pages Test") {
+  // The table program across two pages, the zero page written every
+  // iteration too
+  // 0200: LDX #$00
+  // 0202: TXA ; ADC $10 ; STA $0340,X ; STA $11 ; INX ; BNE $0202
+  // 020D: INC $10 ; JMP $0200
+  const uint8_t program[] = {0xA2, 0x00, 0x8A, 0x65, 0x10, 0x9D,
+                             0x40, 0x03, 0x85, 0x11, 0xE8, 0xD0,
+                             0xF5, 0xE6, 0x10, 0x4C, 0x00, 0x02};
+  // Only the zero page and the two pages of the table are written
+  const std::array<uint64_t, 4> written = {(1ull << 0x00) | (1ull << 0x03) |
+                                           (1ull << 0x04)};
+  const std::array<uint64_t, 4> clean = {};
+  const std::array<uint64_t, 4> last_pages = {0, 0, 0, 3ull << 62};
+
+  static uint8_t mem[64 * 1024];
+  load_program(mem, program, sizeof(program));
+
+  MOS6502 cpu(flat_mem_callback, mem);
+  cpu.set_log_callback(log_clb);
+  cpu.map_memory(0x00, 0x80, mem);
+  cpu.reset();
+
+  // The native code translated before the tracking is dropped
+  const bool jit = cpu.set_jit(true);
+  cpu.run(20000);
+  cpu.set_dirty_tracking(true);
+  REQUIRE(cpu.get_dirty_pages() == clean);
+
+  // The microcode, the instruction level engine, the cache and the JIT
+  for (int i = 0; i < 3000; i++) {
+    exec_clock(cpu);
+  }
+  REQUIRE(cpu.get_dirty_pages() == written);
+  cpu.clear_dirty_pages();
+  REQUIRE_FALSE(cpu.is_page_dirty(0x03));
+
+  cpu.set_jit(false);
+  cpu.set_block_cache(false);
+  for (int i = 0; i < 3000; i++) {
+    cpu.step();
+  }
+  REQUIRE(cpu.get_dirty_pages() == written);
+  cpu.clear_dirty_pages();
+
+  // Once the loop is native only the first and the last iterations of a run
+  // are interpreted: from the end of a loop to the next one, X stops around
+  // $50, the page 4 is written only by the native code
+  cpu.set_block_cache(true);
+  REQUIRE_EQ(cpu.set_jit(true), jit);
+  cpu.run(20000);
+  cpu.run_until_pc(0x020D);
+  cpu.clear_dirty_pages();
+  cpu.run(6000);
+  REQUIRE(cpu.get_dirty_pages() == written);
+  REQUIRE(cpu.is_page_dirty(0x00));
+  REQUIRE(cpu.is_page_dirty(0x03));
+  REQUIRE_FALSE(cpu.is_page_dirty(0x02));
+  cpu.clear_dirty_pages();
+
+  RamBus bus(mem);
+  cpu.run(bus, 20000);
+  REQUIRE(cpu.get_dirty_pages() == written);
+
+  // The pages written by the host through the cpu
+  cpu.clear_dirty_pages();
+  cpu.write_pages(0xFE, 2, mem + 0xFE00);
+  REQUIRE(cpu.get_dirty_pages() == last_pages);
+}
+
+// Device on the page $D0: $D000 counts its reads, $D001 is a random number
+// generator. Both change at every read
+struct record_device_t {
+  MOS6502 *cpu;
+  uint8_t counter;
+  uint32_t seed;
+};
+
+static void record_device_callback(void *usr_data, const uint16_t address,
+                                   const access_mode_t read_write,
+                                   uint8_t &data) {
+  record_device_t *device = (record_device_t *)usr_data;
+
+  if (read_write == access_mode_t::WRITE) {
+    return;
+  }
+
+  data = (address == 0xD000) ? device->counter : (device->seed >> 24);
+  if (read_write == access_mode_t::READ) {
+    device->counter++;
+    device->seed = device->seed * 1103515245 + 12345;
+  }
+}
+
+static void record_timer(void *usr_data, const uint64_t cycle) {
+  record_device_t *device = (record_device_t *)usr_data;
+
+  device->cpu->irq();
+  device->cpu->schedule(cycle + 3001, record_timer, device);
+}
+
+static void record_line_on(void *usr_data, const uint64_t) {
+  ((MOS6502 *)usr_data)->set_irq_line(true);
+}
+
+static void record_line_off(void *usr_data, const uint64_t) {
+  ((MOS6502 *)usr_data)->set_irq_line(false);
+}
+
+TEST_CASE("Record Replay Test") {
+  // 0200: CLI
+  // 0201: LDA $D000 ; CLC ; ADC $10 ; STA $10 ; LDX $D001 ; STA $0300,X
+  // 020F: JMP $0201
+  // IRQ: 0400: PHA ; LDA $D001 ; EOR $11 ; STA $11 ; INC $12 ; PLA ; RTI
+  // NMI: 0420: INC $13 ; RTI
+  const uint8_t program[] = {0x58, 0xAD, 0x00, 0xD0, 0x18, 0x65,
+                             0x10, 0x85, 0x10, 0xAE, 0x01, 0xD0,
+                             0x9D, 0x00, 0x03, 0x4C, 0x01, 0x02};
+  const uint8_t irq_handler[] = {0x48, 0xAD, 0x01, 0xD0, 0x45, 0x11, 0x85,
+                                 0x11, 0xE6, 0x12, 0x68, 0x40};
+  const uint8_t nmi_handler[] = {0xE6, 0x13, 0x40};
+
+  static uint8_t mem[64 * 1024];
+  static uint8_t replayed_mem[0xD0 * 0x0100];
+  memset(mem, 0, sizeof(mem));
+  memcpy(mem + 0x0200, program, sizeof(program));
+  memcpy(mem + 0x0400, irq_handler, sizeof(irq_handler));
+  memcpy(mem + 0x0420, nmi_handler, sizeof(nmi_handler));
+  mem[0xFFFA] = 0x20;
+  mem[0xFFFB] = 0x04;
+  mem[0xFFFC] = 0x00;
+  mem[0xFFFD] = 0x02;
+  mem[0xFFFE] = 0x00;
+  mem[0xFFFF] = 0x04;
+
+  // A session with the runs (on the block cache and the JIT) and a clocked
+  // one, both with an NMI and a reset from the host in the middle
+  for (const bool clocked : {false, true}) {
+    record_device_t device = {nullptr, 0, 6502};
+    MOS6502 cpu(record_device_callback, &device);
+    device.cpu = &cpu;
+    cpu.set_log_callback(log_clb);
+    cpu.map_memory(0x00, 0xD0, mem);
+    cpu.map_memory(0xD1, 0x2F, mem + 0xD100);
+    cpu.set_block_cache(!clocked);
+    cpu.set_jit(!clocked);
+    cpu.reset();
+
+    Recorder recorder(cpu);
+    cpu.schedule(3001, record_timer, &device);
+    cpu.schedule(20000, record_line_on, &cpu);
+    cpu.schedule(20300, record_line_off, &cpu);
+
+    for (int i = 0; i < 40; i++) {
+      if (clocked) {
+        for (int j = 0; j < 1000; j++) {
+          cpu.clock();
+        }
+      } else {
+        cpu.run(1000);
+      }
+
+      if (i == 10) {
+        cpu.nmi();
+      } else if (i == 25) {
+        cpu.reset();
+      }
+    }
+    recorder.stop();
+    REQUIRE(mem[0x12] > 0);
+    REQUIRE(mem[0x13] > 0);
+
+    // Without the device and the events, with the plain engines
+    MOS6502 replayed(flat_mem_callback, nullptr);
+    replayed.set_log_callback(log_clb);
+    Replayer replayer(recorder.get_stream());
+    REQUIRE(replayer.attach(replayed));
+
+    if (clocked) {
+      for (int i = 0; i < 40000; i++) {
+        replayed.clock();
+      }
+      REQUIRE_EQ(replayed.cycles, replayer.next_cycle());
+    } else {
+      replayer.run();
+      REQUIRE(replayer.finished());
+    }
+
+    REQUIRE_FALSE(replayer.diverged());
+    REQUIRE_EQ(replayed.cycles, cpu.cycles);
+    REQUIRE_EQ(replayed.PC, cpu.PC);
+    REQUIRE_EQ(replayed.A, cpu.A);
+    REQUIRE_EQ(replayed.X, cpu.X);
+    REQUIRE_EQ(replayed.S, cpu.S);
+    REQUIRE_EQ(replayed.P, cpu.P);
+    replayed.read_pages(0x00, 0xD0, replayed_mem);
+    REQUIRE(memcmp(replayed_mem, mem, sizeof(replayed_mem)) == 0);
+
+    // Beyond the recording
+    replayed.run(100);
+    REQUIRE(replayer.diverged());
+  }
+
+  // The stream of a session not stopped is valid up to its last record
+  record_device_t device = {nullptr, 0, 6502};
+  MOS6502 cpu(record_device_callback, &device);
+  cpu.set_log_callback(log_clb);
+  Recorder recorder(cpu);
+  cpu.irq();
+  const std::vector<uint8_t> &stream = recorder.get_stream();
+
+  MOS6502 replayed(flat_mem_callback, nullptr);
+  replayed.set_log_callback(log_clb);
+  Replayer truncated(std::vector<uint8_t>(stream.begin(), stream.end() - 1));
+  REQUIRE_FALSE(truncated.attach(replayed));
+  Replayer unstopped(stream);
+  REQUIRE(unstopped.attach(replayed));
+  REQUIRE_EQ(unstopped.next_cycle(), cpu.cycles);
+}
+
+TEST_CASE("Bus Cycles Test") {
+  static counted_mem_t counted;
+  MOS6502 cpu(counted_mem_callback, (void *)&counted);
+  cpu.set_log_callback(log_clb);
+
+  // 0200: LDA #$01 ; LDX $10 ; STA $11 ; JMP $0200
+  const uint8_t program[] = {0xA9, 0x01, 0xA6, 0x10, 0x85,
+                             0x11, 0x4C, 0x00, 0x02};
+  memcpy(counted.mem + 0x0200, program, sizeof(program));
+  counted.reads = 0;
+  counted.writes = 0;
+
+  // One bus access per cycle, no extra reads of the operands for the trace
+  cpu.set_PC(0x0200);
+  cpu.cycles = 0;
+
+  for (int i = 0; i < 4; i++) {
+    exec_clock(cpu);
+  }
+
+  REQUIRE_EQ(cpu.cycles, 2 + 3 + 3 + 3);
+  REQUIRE_EQ(counted.reads, 2 + 3 + 2 + 3);
+  REQUIRE_EQ(counted.writes, 1);
+
+  // The operands of the last instruction are still traced
+  p_state_t state = cpu.get_status();
+  REQUIRE_EQ(state.PC_executed, 0x0206);
+  REQUIRE_EQ(state.arg1, 0x00);
+  REQUIRE_EQ(state.arg2, 0x02);
+}
+
+TEST_CASE("Lazy Flags Test") {
+  static uint8_t mem[64 * 1024];
+  MOS6502 cpu(flat_mem_callback, (void *)mem);
+  cpu.set_log_callback(log_clb);
+
+  // 0200: LDA #$C3 ; PHA ; PLP ; PHP ; PLA  (N, O, Z and C set together)
+  // 0205: LDA #$80 ; STA $10 ; LDA #$00 ; BIT $10 ; PHP ; PLA
+  const uint8_t program[] = {0xA9, 0xC3, 0x48, 0x28, 0x08, 0x68, 0xA9,
+                             0x80, 0x85, 0x10, 0xA9, 0x00, 0x24, 0x10,
+                             0x08, 0x68};
+  memcpy(mem + 0x0200, program, sizeof(program));
+
+  cpu.set_PC(0x0200);
+  for (int i = 0; i < 5; i++) {
+    cpu.step();
+  }
+
+  REQUIRE_EQ(cpu.A, 0xC3 | MOS6502::B | MOS6502::U);
+  REQUIRE_EQ(cpu.P, (0xC3 & ~MOS6502::Z) | MOS6502::U); // PLA cleared Z
+
+  // BIT sets Z from A & M and N from M
+  for (int i = 0; i < 6; i++) {
+    cpu.step();
+  }
+
+  REQUIRE_EQ(cpu.A & (MOS6502::N | MOS6502::O | MOS6502::Z),
+             MOS6502::N | MOS6502::Z);
+}
+
+static uint64_t profiled_instructions(const profile_t &profile) {
+  uint64_t count = 0;
+
+  for (const opcode_profile_t &op : profile.opcodes) {
+    count += op.count;
+  }
+
+  return count;
+}
+
+TEST_CASE("Profiling Test") {
+  static uint8_t mem[64 * 1024];
+  MOS6502 cpu(flat_mem_callback, (void *)mem);
+  cpu.set_log_callback(log_clb);
+
+  REQUIRE(load_binary(TIMING_TEST_BIN, mem, TIMING_TEST_MEM_LOC));
+
+  // Disabled by default
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  cpu.run_until_pc(TIMING_TEST_PC_END);
+  REQUIRE_EQ(cpu.get_profile().runs, 0);
+  REQUIRE_EQ(profiled_instructions(cpu.get_profile()), 0);
+
+  // Count the instructions with step(), every step is a run
+  cpu.set_profiling(true);
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  uint64_t instructions = 0;
+
+  while (cpu.PC != TIMING_TEST_PC_END) {
+    cpu.step();
+    instructions++;
+  }
+
+  REQUIRE_EQ(cpu.get_profile().runs, instructions);
+  REQUIRE_EQ(profiled_instructions(cpu.get_profile()), instructions);
+
+  // Same program in one run
+  cpu.clear_profile();
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+  run_result_t res = cpu.run_until_pc(TIMING_TEST_PC_END);
+
+  REQUIRE_EQ(cpu.get_profile().runs, 1);
+  REQUIRE_EQ(cpu.get_profile().run_cycles, res.cycles);
+  REQUIRE_EQ(profiled_instructions(cpu.get_profile()), instructions);
+
+  // Same program on the cycle-accurate engine
+  cpu.clear_profile();
+  cpu.set_PC(TIMING_TEST_MEM_LOC);
+
+  while (cpu.PC != TIMING_TEST_PC_END) {
+    exec_clock(cpu);
+  }
+
+  REQUIRE_EQ(cpu.get_profile().runs, 0);
+  REQUIRE_EQ(profiled_instructions(cpu.get_profile()), instructions);
+}
+
+// The read instructions that skip the address fix when the indexed addressing
+// does not cross the page
+static bool is_read_operation(const MOS6502::operation_t op) {
+  return op == &MOS6502::LDA || op == &MOS6502::LDX || op == &MOS6502::LDY ||
+         op == &MOS6502::EOR || op == &MOS6502::AND || op == &MOS6502::ORA ||
+         op == &MOS6502::ADC || op == &MOS6502::SBC || op == &MOS6502::CMP ||
+         op == &MOS6502::BIT || op == &MOS6502::LAX || op == &MOS6502::NOP;
+}
+
+TEST_CASE("Opcode Class Test") {
+  for (unsigned int op = 0; op < opcode_table.size(); op++) {
+    const opcode_t &info = opcode_table[op];
+    const MOS6502::instruction_t &instruction = MOS6502::instruction_table[op];
+
+    bool indexed = instruction.addrmode == &MOS6502::ABX ||
+                   instruction.addrmode == &MOS6502::ABY ||
+                   instruction.addrmode == &MOS6502::IIY;
+
+    CAPTURE(op);
+    REQUIRE_EQ(info.page_penalty,
+               indexed && is_read_operation(instruction.operation));
+
+    if (info.page_penalty) {
+      REQUIRE(info.access == access_t::READ);
+    }
+  }
 }
 
 TEST_CASE("Queue Test") {
@@ -554,4 +2041,43 @@ static bool load_NES_cartridge(const char *file,
   fclose(fp);
 
   return true;
+}
+
+static void flat_mem_callback(void *usr_data, const uint16_t address,
+                              const access_mode_t read_write, uint8_t &data) {
+  uint8_t *mem = (uint8_t *)usr_data;
+
+  switch (read_write) {
+  case access_mode_t::READ:
+  case access_mode_t::READ_ONLY:
+    data = mem[address];
+    break;
+
+  case access_mode_t::WRITE:
+    mem[address] = data;
+    break;
+
+  default:
+    log_clb("Unexpected mem access type");
+    break;
+  }
+}
+
+static bool load_binary(const char *file, uint8_t *mem, uint16_t address) {
+  FILE *fp = fopen(file, "rb");
+
+  if (fp == nullptr) {
+    log_clb("Can not open the file " + std::string(file));
+    return false;
+  }
+
+  // get the file size
+  fseek(fp, 0, SEEK_END);
+  size_t size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  size_t read = fread(mem + address, sizeof(uint8_t), size, fp);
+  fclose(fp);
+
+  return read == size;
 }
\ No newline at end of file